@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+// Timing helpers shared by the benchmarks. They use the standard library
+// only, so a benchmark also builds against older revisions of src/core
+// (see compare.sh) as long as it keeps to the API those have.
+namespace Bench {
+
+// Least time in seconds of 'runs' calls f(run); the least disturbed run is
+// the one closest to the cost of the work itself
+template <typename F>
+double best(size_t runs, F&& f) {
+    double result = std::numeric_limits<double>::infinity();
+    for (size_t run = 0; run < runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        f(run);
+        const auto stop = std::chrono::steady_clock::now();
+        result = std::min(result, std::chrono::duration<double>(stop - start).count());
+    }
+    return result;
+}
+
+// Written by keep(); at namespace scope, where a store nobody reads does
+// not warn
+inline volatile double sink = 0.0;
+
+// Keeps a result alive, so the compiler cannot drop the work behind it
+inline void keep(double value) { sink = value; }
+
+// Value of the option "--name N" in argv, or 'fallback'
+inline size_t option(int argc, char** argv, const char* name, size_t fallback) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) return std::strtoull(argv[i + 1], nullptr, 10);
+    }
+    return fallback;
+}
+
+} // namespace Bench
@@ -0,0 +1,62 @@
+#include "core/MathEngine.hpp"
+#include "Bench.hpp"
+#include <cstdio>
+#include <vector>
+
+// Cost of failing evaluations: expressions whose domain errors hit a large
+// part of a 1001 point graph, in batch and point by point, and compiling or
+// evaluating expressions with a syntax error.
+//
+//   ErrorBench [--repeats N]
+//
+// repeats every measurement N times per run. Errors became MathError ids
+// instead of exceptions and message strings in 28159f2:
+//
+//   bench/compare.sh bench/ErrorBench.cpp 3b219fb 28159f2
+
+namespace {
+
+constexpr size_t Runs = 5;
+constexpr size_t Points = 1001;
+
+void graph(MathEngine& engine, const char* expression, size_t repeats) {
+    const CompiledExpression compiled = engine.compile(expression);
+    std::vector<double> xs(Points), out(Points);
+    for (size_t i = 0; i < Points; ++i) xs[i] = -10.0 + 20.0 * static_cast<double>(i) / (Points - 1);
+    ErrorMask errors;
+    const double batch = Bench::best(Runs, [&](size_t) {
+        for (size_t repeat = 0; repeat < repeats; ++repeat) engine.evaluateBatch(compiled, xs.data(), out.data(), Points, errors);
+    });
+    double sum = 0.0;
+    const double scalar = Bench::best(Runs, [&](size_t) {
+        for (size_t repeat = 0; repeat < repeats; ++repeat) {
+            for (double x : xs) sum += engine.evaluate(compiled, x);
+        }
+    });
+    Bench::keep(sum + out[0]);
+    const double points = static_cast<double>(repeats * Points);
+    std::printf("%-20s batch %7.2f   scalar %7.2f ns/point\n", expression, batch * 1e9 / points, scalar * 1e9 / points);
+}
+
+void syntaxError(MathEngine& engine, size_t repeats) {
+    size_t valid = 0;
+    const double compile = Bench::best(Runs, [&](size_t) {
+        for (size_t repeat = 0; repeat < repeats; ++repeat) valid += engine.compile("2+3*(4-").isValid();
+    });
+    double sum = 0.0;
+    const double cached = Bench::best(Runs, [&](size_t) {
+        for (size_t repeat = 0; repeat < repeats; ++repeat) sum += engine.evaluate("2+*3");
+    });
+    Bench::keep(sum + static_cast<double>(valid));
+    std::printf("compile \"2+3*(4-\"    %7.1f ns/call\n", compile * 1e9 / static_cast<double>(repeats));
+    std::printf("evaluate \"2+*3\"      %7.1f ns/call (cached parse error)\n", cached * 1e9 / static_cast<double>(repeats));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t repeats = Bench::option(argc, argv, "--repeats", 200);
+    MathEngine engine;
+    for (const char* expression : { "ln(x)", "1/x + sqrt(x)", "asin(x/10) + ln(x)" }) graph(engine, expression, repeats);
+    syntaxError(engine, repeats * 100);
+}
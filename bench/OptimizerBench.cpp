@@ -0,0 +1,64 @@
+#include "core/MathEngine.hpp"
+#include "Bench.hpp"
+#include <cstdio>
+#include <string>
+
+// Cost of compiled expressions on the two paths that evaluate one program
+// many times: graph sampling (evaluate(compiled, x) over a grid) and
+// integral(compiled, a, b). Each expression is compiled once, outside the
+// timing, and its node count is printed next to the time.
+//
+//   OptimizerBench [--frames N]
+//
+// samples N frames of 1001 points each. Constant folding and power reduction
+// came with the optimizer in 26a0d6b:
+//
+//   bench/compare.sh bench/OptimizerBench.cpp c0baa31 26a0d6b
+//
+// integral() was composite Simpson with n = 1000 in both; later revisions
+// integrate adaptively, so their integral times are not comparable.
+
+namespace {
+
+constexpr size_t Runs = 5;
+constexpr size_t Samples = 1001;
+
+void graph(MathEngine& engine, const char* expression, size_t frames) {
+    const CompiledExpression compiled = engine.compile(expression);
+    double sum = 0.0;
+    const double seconds = Bench::best(Runs, [&](size_t) {
+        for (size_t frame = 0; frame < frames; ++frame) {
+            for (size_t i = 0; i < Samples; ++i) {
+                sum += engine.evaluate(compiled, 0.5 + 10.0 * static_cast<double>(i) / (Samples - 1));
+            }
+        }
+    });
+    Bench::keep(sum);
+    std::printf("graph     %-28s %3zu nodes %9.2f ns/sample\n", expression, compiled.size(),
+                seconds * 1e9 / static_cast<double>(frames * Samples));
+}
+
+void integral(MathEngine& engine, const char* expression, double lower, double upper, size_t calls) {
+    const CompiledExpression compiled = engine.compile(expression);
+    double sum = 0.0;
+    const double seconds = Bench::best(Runs, [&](size_t) {
+        for (size_t call = 0; call < calls; ++call) sum += engine.integral(compiled, lower, upper);
+    });
+    Bench::keep(sum);
+    char label[64];
+    std::snprintf(label, sizeof label, "%s, %g, %g", expression, lower, upper);
+    std::printf("integral  %-28s %3zu nodes %9.2f us/call\n", label, compiled.size(),
+                seconds * 1e6 / static_cast<double>(calls));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t frames = Bench::option(argc, argv, "--frames", 2000);
+    MathEngine engine;
+    for (const char* expression : { "sin(x)*2*pi/180", "x^2+x^3", "x^-1+x/4", "x^0.5*3/2" }) {
+        graph(engine, expression, frames);
+    }
+    integral(engine, "x^2*2/4", 0.0, 3.0, 2000);
+    integral(engine, "sin(x)*2*pi/180", 0.0, 90.0, 2000);
+}
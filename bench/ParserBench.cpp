@@ -0,0 +1,61 @@
+#include "core/MathEngine.hpp"
+#include "Bench.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Parsing cost of deeply nested and very long expressions, through
+// evaluate(expression, x), which parses the whole string. Every run gets its
+// own innermost constant, so the expression cache cannot answer it.
+//
+//   ParserBench [--depth N] [--bytes N]
+//
+// skips nesting deeper than N and inputs longer than N bytes. The original
+// recursive parser (f18ac01, before CompiledExpression) parses every
+// parenthesised group twice, so it doubles its work per nesting level and
+// needs about --depth 22 --bytes 600000 to finish:
+//
+//   bench/compare.sh bench/ParserBench.cpp f18ac01 e555876 -- --depth 22 --bytes 600000
+
+namespace {
+
+constexpr size_t Runs = 3;
+
+// ((..(k+x)..)) with 'depth' parentheses
+std::string nested(size_t depth, size_t k) {
+    std::string result(depth, '(');
+    result += std::to_string(k) + "+x";
+    result.append(depth, ')');
+    return result;
+}
+
+// k+2*(x)+2*(x)+... of about 'bytes' characters
+std::string flat(size_t bytes, size_t k) {
+    std::string result = std::to_string(k);
+    while (result.size() < bytes) result += "+2*(x)";
+    return result;
+}
+
+void run(MathEngine& engine, const char* shape, size_t size, std::string (*make)(size_t, size_t)) {
+    std::vector<std::string> inputs;
+    for (size_t k = 0; k < Runs; ++k) inputs.push_back(make(size, k + 1));
+    double value = 0.0;
+    const double seconds = Bench::best(Runs, [&](size_t k) { value = engine.evaluate(inputs[k], 1.0); });
+    Bench::keep(value);
+    std::printf("%-8s %9zu %11zu bytes %11.3f ms %9.2f ns/byte   = %g\n", shape, size, inputs[0].size(),
+                seconds * 1e3, seconds * 1e9 / static_cast<double>(inputs[0].size()), value);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t maxDepth = Bench::option(argc, argv, "--depth", 100000);
+    const size_t maxBytes = Bench::option(argc, argv, "--bytes", 1500000);
+    MathEngine engine;
+    for (size_t depth : { 10, 16, 20, 22, 1000, 100000 }) {
+        if (depth <= maxDepth) run(engine, "nested", depth, nested);
+    }
+    for (size_t bytes : { 10000, 100000, 600000, 1500000 }) {
+        if (bytes <= maxBytes) run(engine, "flat", bytes, flat);
+    }
+}
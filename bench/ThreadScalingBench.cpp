@@ -0,0 +1,56 @@
+#include "core/MathEngine.hpp"
+#include "Bench.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Speedup of int() and sum() on the thread pool: each expression at 1, 2,
+// 4, ... threads up to the core count (or --threads N), through
+// MathEngine::setThreadCount. Results must have the same bits at every
+// thread count; the value is printed in hex to show it.
+//
+//   ThreadScalingBench [--threads N] [--runs N]
+//
+// sum() cuts its range into fixed chunks; int() spreads the nodes of each
+// round over the pool when the round is large enough (a long integrand, or
+// calculus inside it).
+
+namespace {
+
+const char* const Expressions[] = {
+    "sum(sin(x)/x, 1, 10000000)",
+    "sum(1/x^2, 1, 10000000)",
+    "sum(int(sin(x)^2, 0, 1/x), 1, 100000)",
+    "int(diff(sin(x)^3*exp(-x/50), x), 0, 1000)",
+    "int(sin(x)+sin(2*x)/2+sin(3*x)/3+sin(4*x)/4+sin(5*x)/5+sin(6*x)/6+sin(7*x)/7+sin(8*x)/8"
+    "+sin(9*x)/9+sin(10*x)/10+sin(11*x)/11+sin(12*x)/12+sin(13*x)/13+sin(14*x)/14+sin(15*x)/15"
+    "+sin(16*x)/16+sin(17*x)/17+sin(18*x)/18+sin(19*x)/19+sin(20*x)/20, 0, 100)",
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t maxThreads = Bench::option(argc, argv, "--threads", std::max(1u, std::thread::hardware_concurrency()));
+    const size_t runs = Bench::option(argc, argv, "--runs", 3);
+    std::vector<size_t> counts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) counts.push_back(threads);
+    counts.push_back(maxThreads);
+
+    MathEngine engine;
+    engine.setAngleMode(AngleMode::Radians);
+    for (const char* expression : Expressions) {
+        const CompiledExpression compiled = engine.compile(expression);
+        std::printf("%.72s%s\n", expression, std::strlen(expression) > 72 ? "..." : "");
+        double serial = 0.0;
+        for (size_t threads : counts) {
+            engine.setThreadCount(threads);
+            double value = 0.0;
+            const double seconds = Bench::best(runs, [&](size_t) { value = engine.evaluate(compiled, 0.0); });
+            if (threads == 1) serial = seconds;
+            std::printf("  %3zu threads %10.2f ms  speedup %5.2f  = %.17g (%a)%s\n", threads, seconds * 1e3,
+                        serial / seconds, value, value, engine.hasError() ? "  error" : "");
+        }
+    }
+}
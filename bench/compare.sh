@@ -0,0 +1,52 @@
+#!/bin/sh
+# Builds a benchmark against src/core of two revisions and runs both, for
+# before/after numbers of changes that replaced the code they measure:
+#
+#   bench/compare.sh bench/ParserBench.cpp <before> [<after>] [-- arguments]
+#
+# <after> defaults to the working tree; the arguments go to both runs. The
+# benchmark must keep to the API of both revisions. CXX picks the compiler.
+set -e
+if [ $# -lt 2 ]; then
+    echo "usage: $0 <benchmark.cpp> <before> [<after>] [-- arguments]" >&2
+    exit 2
+fi
+benchmark=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+before=$2
+shift 2
+after=
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    after=$1
+    shift
+fi
+[ "${1:-}" = "--" ] && shift
+
+root=$(git -C "$(dirname "$benchmark")" rev-parse --show-toplevel)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# build <name> <revision or empty for the working tree>
+build() {
+    src=$root/src
+    if [ -n "$2" ]; then
+        mkdir -p "$work/$1-tree"
+        git -C "$root" archive "$2" src | tar -x -C "$work/$1-tree"
+        src=$work/$1-tree/src
+    fi
+    objects=
+    for file in "$src"/core/*.cpp; do
+        flags=
+        case $file in *Avx2.cpp) flags="-mavx2 -mfma";; esac
+        object=$work/$1-$(basename "$file" .cpp).o
+        ${CXX:-c++} -std=c++17 -O2 $flags -I"$src" -c "$file" -o "$object"
+        objects="$objects $object"
+    done
+    ${CXX:-c++} -std=c++17 -O2 -I"$src" "$benchmark" $objects -o "$work/$1" -pthread
+}
+
+build before "$before"
+build after "$after"
+echo "== before: $before"
+"$work/before" "$@"
+echo "== after: ${after:-working tree}"
+"$work/after" "$@"
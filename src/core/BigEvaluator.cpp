@@ -0,0 +1,214 @@
+#include "BigEvaluator.hpp"
+#include "Combinatorics.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Exact quotients are looked for up to this many limbs; long division is
+// quadratic, so beyond it division rounds to the working precision
+constexpr size_t MaxExactDivisionLimbs = size_t(1) << 14;
+
+bool hasBigVersion(FunctionId function) {
+    return function == FunctionId::Sqrt || function == FunctionId::Abs || function == FunctionId::Fact ||
+           function == FunctionId::Ncr || function == FunctionId::Npr;
+}
+
+} // namespace
+
+BigEvaluator::BigEvaluator(std::string_view source, size_t digits,
+                           const std::map<std::string, double>* definitions)
+    : source(source), digits(std::max<size_t>(digits, 1)), limbs(BigFloat::limbsFor(this->digits)) {
+    this->definitions = definitions;
+}
+
+bool BigEvaluator::evaluate(std::string& result) {
+    Value value;
+    if (!run(source, value)) return false;
+    result = value.number.toString(value.exact ? 0 : digits);
+    return true;
+}
+
+bool BigEvaluator::number(std::string_view literal, Value& out) {
+    if (!BigFloat::parse(literal, out.number)) return fail(MathError::InvalidNumber);
+    out.exact = true;
+    return true;
+}
+
+bool BigEvaluator::constant(Constant constant, size_t at, Value& out) {
+    if (constant == Constant::Infinity) return fail(MathError::NotInBigMode, at);
+    out.number = constant == Constant::Pi ? BigFloat::pi(limbs) : BigFloat::e(limbs);
+    out.exact = false;
+    return true;
+}
+
+bool BigEvaluator::definition(double value, size_t at, Value& out) {
+    if (!std::isfinite(value)) return fail(MathError::NotInBigMode, at);
+    out.number = BigFloat::fromDouble(value);
+    out.exact = false;
+    return true;
+}
+
+bool BigEvaluator::variable(size_t at, Value&) {
+    return fail(MathError::NotInBigMode, at);
+}
+
+bool BigEvaluator::function(const Builtins::Info& builtin, size_t at) {
+    return hasBigVersion(builtin.id) || fail(MathError::NotInBigMode, at);
+}
+
+bool BigEvaluator::negate(Value& value) {
+    value.number = -value.number;
+    return true;
+}
+
+bool BigEvaluator::binary(Operator op, Value& a, Value& b, Value& out) {
+    switch (op) {
+        case Operator::Add:      return add(a, b, out);
+        case Operator::Subtract: return add(a, { -b.number, b.exact }, out);
+        case Operator::Multiply: return multiply(a, b, out);
+        case Operator::Divide:   return divide(a, b, out);
+        case Operator::Modulo:   return modulo(a, b, out);
+        default:                 return power(a, b, out);
+    }
+}
+
+bool BigEvaluator::add(const Value& a, const Value& b, Value& out) {
+    out.exact = a.exact && b.exact;
+    if (out.exact && !a.number.isZero() && !b.number.isZero()) {
+        // The exact sum spans both operands, however far apart they are
+        long long span = std::max(a.number.topExponent(), b.number.topExponent()) -
+                         std::min(a.number.lowExponent(), b.number.lowExponent());
+        out.exact = span <= static_cast<long long>(MaxExactLimbs);
+    }
+    out.number = out.exact ? a.number + b.number : BigFloat::add(a.number, b.number, limbs);
+    return true;
+}
+
+bool BigEvaluator::multiply(const Value& a, const Value& b, Value& out) {
+    out.exact = a.exact && b.exact && a.number.limbCount() + b.number.limbCount() <= MaxExactLimbs;
+    out.number = out.exact ? a.number * b.number
+                           : (a.number.rounded(limbs) * b.number.rounded(limbs)).rounded(limbs);
+    return true;
+}
+
+bool BigEvaluator::divide(const Value& a, const Value& b, Value& out) {
+    if (b.number.isZero()) return fail(MathError::DivisionByZero);
+
+    // Enough limbs for an exact quotient of integers, e.g. fact(n) / fact(k)
+    const size_t operandLimbs = a.number.limbCount() + b.number.limbCount();
+    const bool tryExact = a.exact && b.exact && operandLimbs <= MaxExactDivisionLimbs;
+    bool exactQuotient = false;
+    out.number = BigFloat::divide(a.number, b.number, tryExact ? std::max(limbs, operandLimbs + 1) : limbs, &exactQuotient);
+    out.exact = tryExact && exactQuotient;
+    if (!out.exact) out.number = out.number.rounded(limbs);
+    return true;
+}
+
+bool BigEvaluator::modulo(const Value& a, const Value& b, Value& out) {
+    if (b.number.isZero()) return fail(MathError::ModuloByZero);
+    const long long lowest = std::min(a.number.lowExponent(), b.number.lowExponent());
+    if (a.number.topExponent() - lowest > static_cast<long long>(MaxExactLimbs) ||
+        b.number.topExponent() - lowest > static_cast<long long>(MaxExactLimbs)) {
+        return fail(MathError::ResultTooLarge);
+    }
+    out.number = BigFloat::remainder(a.number, b.number);
+    out.exact = a.exact && b.exact;
+    if (!out.exact) out.number = out.number.rounded(limbs);
+    return true;
+}
+
+bool BigEvaluator::power(const Value& base, const Value& exponent, Value& out) {
+    // Only integer exponents; fractional ones would need exp and log
+    if (!exponent.number.isInteger()) return fail(MathError::NotInBigMode);
+
+    long long n = 0;
+    if (!exponent.number.toInteger().toInt64(n) || n == (-0x7fffffffffffffffll - 1)) {
+        return fail(MathError::ResultTooLarge);
+    }
+    out.exact = true;
+    if (n == 0) {
+        out.number = BigFloat(1);
+        return true;
+    }
+    if (base.number.isZero()) {
+        if (n < 0) return fail(MathError::DivisionByZero);
+        out.number = BigFloat();
+        return true;
+    }
+
+    const std::uint64_t magnitude = static_cast<std::uint64_t>(n < 0 ? -n : n);
+    // Keep the limb exponent of the result representable
+    const std::uint64_t reach = static_cast<std::uint64_t>(
+        std::max(std::abs(base.number.topExponent()), std::abs(base.number.lowExponent())) + 1);
+    if (magnitude > (std::uint64_t(1) << 60) / reach) return fail(MathError::ResultTooLarge);
+
+    Value raised;
+    raised.exact = base.exact && magnitude <= MaxExactLimbs / base.number.limbCount();
+    raised.number = raised.exact ? base.number.pow(magnitude) : base.number.pow(magnitude, limbs);
+    if (n > 0) {
+        out = std::move(raised);
+        return true;
+    }
+    return divide({ BigFloat(1), true }, raised, out);
+}
+
+bool BigEvaluator::call(FunctionId function, Value* args, std::uint32_t count, Value& out) {
+    const Value& a = args[0];
+    switch (function) {
+        case FunctionId::Abs:
+            out = { a.number.isNegative() ? -a.number : a.number, a.exact };
+            return true;
+
+        case FunctionId::Sqrt:
+            if (a.number.isNegative()) return fail(MathError::SqrtDomain);
+            out = { BigFloat::sqrt(a.number, limbs), false };
+            return true;
+
+        case FunctionId::Fact: {
+            // Truncated to an integer, like the double version
+            long long n = 0;
+            if (!a.number.toInteger().toInt64(n)) {
+                return fail(a.number.isNegative() ? MathError::FactorialNegative : MathError::FactorialOverflow);
+            }
+            if (n < 0) return fail(MathError::FactorialNegative);
+            const double limbsNeeded = std::lgamma(static_cast<double>(n) + 1.0) / std::log(10.0) / BigInt::BaseDigits;
+            if (limbsNeeded > static_cast<double>(MaxExactLimbs)) return fail(MathError::FactorialOverflow);
+            out = { BigFloat(BigInt::factorial(static_cast<std::uint32_t>(n))), true };
+            return true;
+        }
+
+        case FunctionId::Ncr:
+        case FunctionId::Npr: {
+            const bool combination = function == FunctionId::Ncr;
+            const MathError invalid = combination ? MathError::InvalidCombination : MathError::InvalidPermutation;
+            long long n = 0, r = 0;
+            if (!args[0].number.toInteger().toInt64(n) || !args[1].number.toInteger().toInt64(r)) {
+                return fail(MathError::ResultTooLarge);
+            }
+            if (n < 0 || r < 0 || r > n) return fail(invalid);
+
+            if (count > 2 && !args[2].number.isZero()) {
+                // Residues are small; the double kernel is exact for them
+                const double p = args[2].number.toDouble();
+                if (n >= (1ll << 53)) return fail(MathError::ResultTooLarge);
+                MathError error = Combinatorics::checkCombinationModulo(double(n), double(r), p);
+                if (error != MathError::None) return fail(error);
+                out = { BigFloat::fromDouble(Combinatorics::combinationModulo(double(n), double(r), p)), true };
+                return true;
+            }
+
+            const double digits = (std::lgamma(double(n) + 1.0) - std::lgamma(double(n - r) + 1.0) -
+                                   (combination ? std::lgamma(double(r) + 1.0) : 0.0)) / std::log(10.0);
+            if (n > 0xffffffffll || digits / BigInt::BaseDigits > static_cast<double>(MaxExactLimbs)) {
+                return fail(MathError::ResultTooLarge);
+            }
+            const std::uint32_t top = static_cast<std::uint32_t>(n), bottom = static_cast<std::uint32_t>(r);
+            out = { BigFloat(combination ? BigInt::combination(top, bottom) : BigInt::permutation(top, bottom)), true };
+            return true;
+        }
+
+        default:
+            return fail(MathError::NotInBigMode);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <cstdint>
+#include "BigFloat.hpp"
+#include "TokenEvaluator.hpp"
+
+// Big-number mode: evaluates an expression with BigFloat instead of double.
+// Works on the lexer's tokens (see TokenEvaluator), so literals keep every
+// digit they were written with.
+//
+// +, -, *, %, integer powers, abs, fact, nCr and nPr of exact operands stay
+// exact (up to MaxExactLimbs); division, sqrt, pi, e and user definitions
+// are computed to the requested number of digits and make results inexact.
+// Functions without an arbitrary-precision version (trigonometry,
+// logarithms, calculus) and x report MathError::NotInBigMode.
+struct BigValue {
+    BigFloat number;
+    bool exact = true;
+};
+
+class BigEvaluator : public TokenEvaluator<BigEvaluator, BigValue> {
+public:
+    // Exact results larger than this are rounded to the working precision
+    static constexpr size_t MaxExactLimbs = size_t(1) << 18;
+
+    // 'digits' is the number of significant digits of inexact results;
+    // 'definitions' maps lower-case names to values and may be null
+    BigEvaluator(std::string_view source, size_t digits,
+                 const std::map<std::string, double>* definitions = nullptr);
+
+    // Decimal text of the result: exact values in full, others rounded to
+    // 'digits' significant digits. Returns false on error.
+    bool evaluate(std::string& result);
+
+private:
+    friend class TokenEvaluator<BigEvaluator, BigValue>;
+    using Value = BigValue;
+
+    std::string_view source;
+    size_t digits;
+    size_t limbs;               // working precision
+
+    // TokenEvaluator hooks
+    bool number(std::string_view literal, Value& out);
+    bool constant(Constant constant, size_t at, Value& out);
+    bool definition(double value, size_t at, Value& out);
+    bool variable(size_t at, Value& out);
+    bool function(const Builtins::Info& builtin, size_t at);
+    bool negate(Value& value);
+    bool binary(Operator op, Value& a, Value& b, Value& out);
+    bool call(FunctionId function, Value* args, std::uint32_t count, Value& out);
+
+    bool add(const Value& a, const Value& b, Value& out);
+    bool multiply(const Value& a, const Value& b, Value& out);
+    bool divide(const Value& a, const Value& b, Value& out);
+    bool modulo(const Value& a, const Value& b, Value& out);
+    bool power(const Value& base, const Value& exponent, Value& out);
+};
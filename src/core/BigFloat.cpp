@@ -0,0 +1,353 @@
+#include "BigFloat.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+// Floor of the square root by Newton's iteration from above, which
+// decreases monotonically onto the result. The start comes from the square
+// root of the top half of the limbs, so each level needs only a couple of
+// steps and the full-size divisions stay few.
+BigInt isqrt(const BigInt& n) {
+    const size_t count = n.limbCount();
+    BigInt x;
+    if (count <= 3) {
+        // Below 10^27 the double root is off by much less than 1
+        x = BigInt(static_cast<long long>(std::sqrt(n.toDouble())) + 2);
+    } else {
+        // (isqrt(n / Base^2k) + 1) * Base^k >= sqrt(n)
+        const size_t k = count / 4;
+        BigInt top = n;
+        top.shiftLimbsRight(2 * k);
+        x = isqrt(top) + BigInt(1);
+        x.shiftLimbsLeft(k);
+    }
+
+    while (true) {
+        BigInt quotient, remainder;
+        BigInt::divMod(n, x, quotient, remainder);
+        BigInt next = x + quotient;
+        next.divide(2);
+        if (!(next < x)) return x;
+        x = std::move(next);
+    }
+}
+
+// Chudnovsky series terms [a, b): pi = 426880 sqrt(10005) Q / T
+void chudnovsky(long long a, long long b, BigInt& p, BigInt& q, BigInt& t) {
+    if (b - a == 1) {
+        if (a == 0) {
+            p = q = 1;
+        } else {
+            p = BigInt((6 * a - 5) * (2 * a - 1));
+            p *= static_cast<std::uint32_t>(6 * a - 1);
+            q = BigInt(a * a);
+            q *= static_cast<std::uint32_t>(a);
+            q *= BigInt(10939058860032000LL);     // 640320^3 / 24
+        }
+        t = p * BigInt(13591409 + 545140134 * a);
+        if (a & 1) t = -t;
+        return;
+    }
+
+    const long long middle = a + (b - a) / 2;
+    BigInt p2, q2, t2;
+    chudnovsky(a, middle, p, q, t);
+    chudnovsky(middle, b, p2, q2, t2);
+    t = t * q2 + p * t2;
+    p *= p2;
+    q *= q2;
+}
+
+// Sum of a! / k! for k in (a, b] as p / q
+void factorialSeries(long long a, long long b, BigInt& p, BigInt& q) {
+    if (b - a == 1) {
+        p = 1;
+        q = BigInt(b);
+        return;
+    }
+    const long long middle = a + (b - a) / 2;
+    BigInt p2, q2;
+    factorialSeries(a, middle, p, q);
+    factorialSeries(middle, b, p2, q2);
+    p = p * q2 + p2;
+    q *= q2;
+}
+
+} // namespace
+
+BigFloat::BigFloat(BigInt mantissa, long long exponent) : mantissa(std::move(mantissa)), exponent(exponent) {
+    normalize();
+}
+
+bool BigFloat::parse(std::string_view literal, BigFloat& out) {
+    size_t end = literal.find_first_of("eE");
+    std::string_view number = literal.substr(0, end);
+
+    long long decimalExponent = 0;
+    if (end != std::string_view::npos) {
+        std::string_view text = literal.substr(end + 1);
+        if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+        auto [stop, status] = std::from_chars(text.data(), text.data() + text.size(), decimalExponent);
+        if (status != std::errc() || stop != text.data() + text.size()) return false;
+        // Beyond this the limb exponent could overflow
+        if (decimalExponent > (1ll << 60) || decimalExponent < -(1ll << 60)) return false;
+    }
+
+    std::string digits;
+    digits.reserve(number.size());
+    size_t dot = number.find('.');
+    if (dot != std::string_view::npos) {
+        if (number.find('.', dot + 1) != std::string_view::npos) return false;
+        digits.append(number.substr(0, dot));
+        digits.append(number.substr(dot + 1));
+        decimalExponent -= static_cast<long long>(number.size() - dot - 1);
+    } else {
+        digits.append(number);
+    }
+
+    BigInt mantissa;
+    if (!BigInt::parse(digits, mantissa)) return false;
+
+    // Base^exponent * 10^shift with 0 <= shift < 9
+    long long limbExponent = decimalExponent / BigInt::BaseDigits;
+    long long shift = decimalExponent % BigInt::BaseDigits;
+    if (shift < 0) {
+        shift += BigInt::BaseDigits;
+        --limbExponent;
+    }
+    mantissa.shiftDigitsLeft(static_cast<size_t>(shift));
+    out = BigFloat(std::move(mantissa), limbExponent);
+    return true;
+}
+
+BigFloat BigFloat::fromDouble(double value) {
+    if (!std::isfinite(value) || value == 0.0) return BigFloat();
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), std::fabs(value));
+    BigFloat parsed;
+    parse(std::string_view(buffer, static_cast<size_t>(result.ptr - buffer)), parsed);
+    return value < 0 ? -parsed : parsed;
+}
+
+BigInt BigFloat::toInteger() const {
+    BigInt integer = mantissa;
+    if (exponent >= 0) integer.shiftLimbsLeft(static_cast<size_t>(exponent));
+    else integer.shiftLimbsRight(static_cast<size_t>(-exponent));
+    return integer;
+}
+
+double BigFloat::toDouble() const {
+    // Three limbs are more than double precision
+    BigInt top = mantissa;
+    size_t dropped = top.limbCount() > 3 ? top.limbCount() - 3 : 0;
+    top.shiftLimbsRight(dropped);
+    double scale = static_cast<double>(exponent + static_cast<long long>(dropped)) * BigInt::BaseDigits;
+    return top.toDouble() * std::pow(10.0, scale);
+}
+
+BigFloat operator+(const BigFloat& a, const BigFloat& b) {
+    if (a.isZero()) return b;
+    if (b.isZero()) return a;
+    const long long lowest = std::min(a.exponent, b.exponent);
+    BigInt sum = a.mantissa;
+    sum.shiftLimbsLeft(static_cast<size_t>(a.exponent - lowest));
+    BigInt other = b.mantissa;
+    other.shiftLimbsLeft(static_cast<size_t>(b.exponent - lowest));
+    sum += other;
+    return BigFloat(std::move(sum), lowest);
+}
+
+BigFloat operator*(const BigFloat& a, const BigFloat& b) {
+    return BigFloat(a.mantissa * b.mantissa, a.exponent + b.exponent);
+}
+
+int BigFloat::compare(const BigFloat& a, const BigFloat& b) {
+    const int signA = a.isZero() ? 0 : a.isNegative() ? -1 : 1;
+    const int signB = b.isZero() ? 0 : b.isNegative() ? -1 : 1;
+    if (signA != signB || signA == 0) return signA < signB ? -1 : signA > signB ? 1 : 0;
+
+    int magnitude;
+    if (a.topExponent() != b.topExponent()) {
+        magnitude = a.topExponent() < b.topExponent() ? -1 : 1;
+    } else {
+        // Same top limb position, so the shift is below either length
+        const long long lowest = std::min(a.exponent, b.exponent);
+        BigInt left = a.mantissa, right = b.mantissa;
+        left.shiftLimbsLeft(static_cast<size_t>(a.exponent - lowest));
+        right.shiftLimbsLeft(static_cast<size_t>(b.exponent - lowest));
+        magnitude = BigInt::compareMagnitude(left, right);
+    }
+    return signA * magnitude;
+}
+
+BigFloat BigFloat::add(const BigFloat& a, const BigFloat& b, size_t limbs) {
+    if (a.isZero()) return b.rounded(limbs);
+    if (b.isZero()) return a.rounded(limbs);
+
+    const long long cut = std::max(a.topExponent(), b.topExponent()) - static_cast<long long>(limbs) - 1;
+    auto truncate = [cut](const BigFloat& value) {
+        if (value.exponent >= cut) return value;
+        if (value.topExponent() <= cut) return BigFloat();
+        BigInt kept = value.mantissa;
+        kept.shiftLimbsRight(static_cast<size_t>(cut - value.exponent));
+        return BigFloat(std::move(kept), cut);
+    };
+    return (truncate(a) + truncate(b)).rounded(limbs);
+}
+
+BigFloat BigFloat::divide(const BigFloat& a, const BigFloat& b, size_t limbs, bool* exact) {
+    if (a.isZero()) {
+        if (exact) *exact = true;
+        return BigFloat();
+    }
+
+    // Scale the dividend so the quotient has more than 'limbs' limbs
+    const long long wanted = static_cast<long long>(limbs + 1 + b.limbCount()) - static_cast<long long>(a.limbCount());
+    const size_t shift = static_cast<size_t>(std::max(0ll, wanted));
+    BigInt numerator = a.mantissa;
+    numerator.shiftLimbsLeft(shift);
+
+    BigInt quotient, remainder;
+    BigInt::divMod(numerator, b.mantissa, quotient, remainder);
+    BigFloat result(std::move(quotient), a.exponent - b.exponent - static_cast<long long>(shift));
+    // Normalized, so a result longer than 'limbs' loses a non-zero limb
+    if (exact) *exact = remainder.isZero() && result.limbCount() <= limbs;
+    return result.rounded(limbs);
+}
+
+BigFloat BigFloat::remainder(const BigFloat& a, const BigFloat& b) {
+    const long long lowest = std::min(a.exponent, b.exponent);
+    BigInt dividend = a.mantissa, divisor = b.mantissa;
+    dividend.shiftLimbsLeft(static_cast<size_t>(a.exponent - lowest));
+    divisor.shiftLimbsLeft(static_cast<size_t>(b.exponent - lowest));
+    BigInt quotient, remainder;
+    BigInt::divMod(dividend, divisor, quotient, remainder);
+    return BigFloat(std::move(remainder), lowest);
+}
+
+BigFloat BigFloat::sqrt(const BigFloat& a, size_t limbs) {
+    if (a.isZero()) return BigFloat();
+
+    // Integer square root of a mantissa with 2 (limbs + 1) limbs and an even exponent
+    const long long wanted = 2 * static_cast<long long>(limbs + 1) - static_cast<long long>(a.limbCount());
+    long long shift = std::max(0ll, wanted);
+    if ((a.exponent - shift) % 2 != 0) ++shift;
+    BigInt scaled = a.mantissa;
+    scaled.shiftLimbsLeft(static_cast<size_t>(shift));
+    return BigFloat(isqrt(scaled), (a.exponent - shift) / 2).rounded(limbs);
+}
+
+BigFloat BigFloat::rounded(size_t limbs) const {
+    if (mantissa.limbCount() <= limbs) return *this;
+    const size_t dropped = mantissa.limbCount() - limbs;
+    BigInt kept = mantissa;
+    kept.shiftLimbsRight(dropped);
+    return BigFloat(std::move(kept), exponent + static_cast<long long>(dropped));
+}
+
+BigFloat BigFloat::pow(std::uint64_t power) const {
+    return BigFloat(mantissa.pow(power), exponent * static_cast<long long>(power));
+}
+
+BigFloat BigFloat::pow(std::uint64_t power, size_t limbs) const {
+    BigFloat result = BigFloat(1), base = rounded(limbs);
+    while (power) {
+        if (power & 1) result = (result * base).rounded(limbs);
+        power >>= 1;
+        if (power) base = (base * base).rounded(limbs);
+    }
+    return result;
+}
+
+BigFloat BigFloat::pi(size_t limbs) {
+    // Each term adds log10(640320^3 / 1728) ~ 14.18 digits
+    const long long terms = static_cast<long long>(limbs * BigInt::BaseDigits / 14.18) + 2;
+    BigInt p, q, t;
+    chudnovsky(0, terms, p, q, t);
+    q *= 426880u;
+    BigFloat numerator = BigFloat(std::move(q)) * sqrt(BigFloat(10005), limbs + 1);
+    return divide(numerator, BigFloat(std::move(t)), limbs);
+}
+
+BigFloat BigFloat::e(size_t limbs) {
+    // Enough terms that terms! exceeds 10^digits
+    const double digits = static_cast<double>(limbs * BigInt::BaseDigits) + 10.0;
+    long long terms = 2;
+    while (std::lgamma(static_cast<double>(terms) + 1.0) / std::log(10.0) < digits) terms *= 2;
+    BigInt p, q;
+    factorialSeries(0, terms, p, q);
+    BigInt numerator = p + q;
+    return divide(BigFloat(std::move(numerator)), BigFloat(std::move(q)), limbs);
+}
+
+std::string BigFloat::toString(size_t digits) const {
+    if (isZero()) return "0";
+
+    BigInt magnitude = mantissa;
+    if (magnitude.isNegative()) magnitude = -magnitude;
+    std::string text = magnitude.toString();
+    long long decimalExponent = exponent * BigInt::BaseDigits;   // value = text * 10^decimalExponent
+
+    if (digits > 0 && text.size() > digits) {
+        const bool roundUp = text[digits] >= '5';
+        decimalExponent += static_cast<long long>(text.size() - digits);
+        text.resize(digits);
+        if (roundUp) {
+            size_t i = text.size();
+            while (i > 0 && text[i - 1] == '9') text[--i] = '0';
+            if (i == 0) {
+                text.insert(text.begin(), '1');
+                text.pop_back();
+                ++decimalExponent;
+            } else {
+                ++text[i - 1];
+            }
+        }
+    }
+    while (text.size() > 1 && text.back() == '0') {
+        text.pop_back();
+        ++decimalExponent;
+    }
+
+    // Digits before the decimal point
+    const long long point = static_cast<long long>(text.size()) + decimalExponent;
+    std::string result = isNegative() ? "-" : "";
+
+    // Exact values keep every digit, but not long runs of zeros around them
+    const long long length = static_cast<long long>(text.size());
+    const bool scientific = digits > 0 ? point > static_cast<long long>(digits) || point < -4
+                                       : point < -20 || point - length > std::max(length, 20ll);
+    if (scientific) {
+        result += text[0];
+        if (text.size() > 1) {
+            result += '.';
+            result.append(text, 1, std::string::npos);
+        }
+        result += point - 1 >= 0 ? "e+" : "e-";
+        result += std::to_string(point - 1 >= 0 ? point - 1 : 1 - point);
+    } else if (point <= 0) {
+        result += "0.";
+        result.append(static_cast<size_t>(-point), '0');
+        result += text;
+    } else if (point >= static_cast<long long>(text.size())) {
+        result += text;
+        result.append(static_cast<size_t>(point) - text.size(), '0');
+    } else {
+        result.append(text, 0, static_cast<size_t>(point));
+        result += '.';
+        result.append(text, static_cast<size_t>(point), std::string::npos);
+    }
+    return result;
+}
+
+void BigFloat::normalize() {
+    const size_t zeros = mantissa.trailingZeroLimbs();
+    if (zeros == 0 || mantissa.isZero()) {
+        if (mantissa.isZero()) exponent = 0;
+        return;
+    }
+    mantissa.shiftLimbsRight(zeros);
+    exponent += static_cast<long long>(zeros);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "BigInt.hpp"
+
+// Arbitrary-precision decimal floating point number: mantissa * Base^exponent
+// with BigInt::Base = 10^9, so every decimal literal is represented exactly.
+// +, - and * are exact; division, square roots and the constants are
+// computed to a requested number of limbs and truncated toward zero.
+class BigFloat {
+public:
+    BigFloat() = default;
+    BigFloat(BigInt integer) : BigFloat(std::move(integer), 0) {}
+    BigFloat(BigInt mantissa, long long exponent);
+
+    // Digits with an optional '.' and exponent, no sign ("12", ".5", "1.5e-9")
+    static bool parse(std::string_view literal, BigFloat& out);
+    // The shortest decimal that round-trips, as printf's %.17g does
+    static BigFloat fromDouble(double value);
+
+    // Limbs that hold 'digits' significant decimal digits, with guard limbs
+    static size_t limbsFor(size_t digits) { return digits / BigInt::BaseDigits + 2; }
+
+    bool isZero() const { return mantissa.isZero(); }
+    bool isNegative() const { return mantissa.isNegative(); }
+    bool isInteger() const { return exponent >= 0; }
+    // Integer part, truncated toward zero
+    BigInt toInteger() const;
+    double toDouble() const;
+    size_t limbCount() const { return mantissa.limbCount(); }
+    // The value's limbs sit at Base^lowExponent() .. Base^(topExponent() - 1)
+    long long topExponent() const { return exponent + static_cast<long long>(mantissa.limbCount()); }
+    long long lowExponent() const { return exponent; }
+
+    BigFloat operator-() const { return BigFloat(-mantissa, exponent); }
+    friend BigFloat operator+(const BigFloat& a, const BigFloat& b);
+    friend BigFloat operator-(const BigFloat& a, const BigFloat& b) { return a + -b; }
+    friend BigFloat operator*(const BigFloat& a, const BigFloat& b);
+    friend bool operator==(const BigFloat& a, const BigFloat& b) { return a.exponent == b.exponent && a.mantissa == b.mantissa; }
+    static int compare(const BigFloat& a, const BigFloat& b);
+
+    // Sum truncated to 'limbs'; operands far below the result's precision
+    // are not shifted into place, so huge exponent gaps stay cheap
+    static BigFloat add(const BigFloat& a, const BigFloat& b, size_t limbs);
+    // Quotient with 'limbs' significant limbs; 'exact' tells whether nothing
+    // was dropped. b must not be zero.
+    static BigFloat divide(const BigFloat& a, const BigFloat& b, size_t limbs, bool* exact = nullptr);
+    // a - trunc(a / b) * b, exact, like fmod. b must not be zero.
+    static BigFloat remainder(const BigFloat& a, const BigFloat& b);
+    // a must not be negative
+    static BigFloat sqrt(const BigFloat& a, size_t limbs);
+
+    // At most 'limbs' significant limbs
+    BigFloat rounded(size_t limbs) const;
+
+    // Integer powers by squaring: exact, or truncated to 'limbs' at each step
+    BigFloat pow(std::uint64_t exponent) const;
+    BigFloat pow(std::uint64_t exponent, size_t limbs) const;
+
+    // Constants by binary splitting: Chudnovsky's series for pi, sum 1/k! for e
+    static BigFloat pi(size_t limbs);
+    static BigFloat e(size_t limbs);
+
+    // Decimal text rounded half up to 'digits' significant digits, or every
+    // digit when 'digits' is 0. Values far from 1 use scientific notation
+    // (1.5e+30), like %g; exact ones only when they would mostly be zeros.
+    std::string toString(size_t digits) const;
+
+private:
+    BigInt mantissa;
+    long long exponent = 0;     // in limbs
+
+    // Moves trailing zero limbs into the exponent
+    void normalize();
+};
@@ -0,0 +1,634 @@
+#include "BigInt.hpp"
+#include <algorithm>
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+using Limbs = std::vector<std::uint32_t>;
+
+constexpr std::uint64_t Base = BigInt::Base;
+
+// Operand sizes in limbs at which multiplication changes algorithm
+constexpr size_t KaratsubaThreshold = 32;
+constexpr size_t NttThreshold = 800;
+
+// value must not be zero
+int countTrailingZeros(std::uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+size_t trimmedSize(const std::uint32_t* a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) --n;
+    return n;
+}
+
+// out[offset..] += a, growing out as needed
+void addAt(Limbs& out, const std::uint32_t* a, size_t n, size_t offset) {
+    if (out.size() < offset + n) out.resize(offset + n, 0);
+    std::uint32_t carry = 0;
+    size_t i = 0;
+    for (; i < n; ++i) {
+        std::uint32_t sum = out[offset + i] + a[i] + carry;
+        carry = sum >= Base;
+        out[offset + i] = carry ? sum - static_cast<std::uint32_t>(Base) : sum;
+    }
+    for (size_t k = offset + i; carry; ++k) {
+        if (k == out.size()) {
+            out.push_back(carry);
+            break;
+        }
+        std::uint32_t sum = out[k] + carry;
+        carry = sum >= Base;
+        out[k] = carry ? 0 : sum;
+    }
+}
+
+// out -= a, requires out >= a
+void subtractFrom(Limbs& out, const std::uint32_t* a, size_t n) {
+    std::uint32_t borrow = 0;
+    for (size_t i = 0; i < out.size() && (i < n || borrow); ++i) {
+        std::int64_t diff = static_cast<std::int64_t>(out[i]) - (i < n ? a[i] : 0) - borrow;
+        borrow = diff < 0;
+        out[i] = static_cast<std::uint32_t>(borrow ? diff + static_cast<std::int64_t>(Base) : diff);
+    }
+}
+
+// out[0 .. na+nb) = a * b; out must be zeroed
+void multiplySchoolbook(const std::uint32_t* a, size_t na, const std::uint32_t* b, size_t nb, std::uint32_t* out) {
+    for (size_t i = 0; i < na; ++i) {
+        std::uint64_t carry = 0;
+        const std::uint64_t ai = a[i];
+        if (ai == 0) continue;
+        for (size_t j = 0; j < nb; ++j) {
+            std::uint64_t cur = out[i + j] + ai * b[j] + carry;
+            out[i + j] = static_cast<std::uint32_t>(cur % Base);
+            carry = cur / Base;
+        }
+        for (size_t k = i + nb; carry; ++k) {
+            std::uint64_t cur = out[k] + carry;
+            out[k] = static_cast<std::uint32_t>(cur % Base);
+            carry = cur / Base;
+        }
+    }
+}
+
+// Number theoretic transform modulo three primes below 2^30; the products
+// of base 10^9 limbs are rebuilt from the residues by Garner's algorithm.
+// p1 * p2 * p3 ~ 2^86 bounds the convolution terms (n * 10^18), and p1
+// bounds the transform length to 2^23. 3 is a primitive root of all three.
+// The moduli are template arguments so every reduction compiles to
+// multiplications instead of divisions.
+constexpr std::uint32_t P1 = 998244353, P2 = 167772161, P3 = 469762049;
+constexpr std::uint32_t PrimitiveRoot = 3;
+constexpr size_t MaxNttLength = size_t(1) << 23;
+
+template <std::uint32_t Mod>
+std::uint32_t powMod(std::uint64_t base, std::uint64_t exponent) {
+    std::uint64_t result = 1;
+    base %= Mod;
+    while (exponent) {
+        if (exponent & 1) result = result * base % Mod;
+        base = base * base % Mod;
+        exponent >>= 1;
+    }
+    return static_cast<std::uint32_t>(result);
+}
+
+template <std::uint32_t Mod>
+void ntt(std::vector<std::uint32_t>& a, bool inverse) {
+    const size_t n = a.size();
+
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+
+    // Shoup's trick: with w' = floor(w * 2^32 / Mod) precomputed, a * w mod
+    // Mod needs two multiplications and no division
+    std::vector<std::uint32_t> roots(n / 2), rootsShoup(n / 2);
+    for (size_t length = 2; length <= n; length <<= 1) {
+        std::uint32_t step = powMod<Mod>(PrimitiveRoot, (Mod - 1) / length);
+        if (inverse) step = powMod<Mod>(step, Mod - 2);
+        const size_t half = length / 2;
+        roots[0] = 1;
+        for (size_t k = 1; k < half; ++k) roots[k] = static_cast<std::uint32_t>(std::uint64_t(roots[k - 1]) * step % Mod);
+        for (size_t k = 0; k < half; ++k) rootsShoup[k] = static_cast<std::uint32_t>((std::uint64_t(roots[k]) << 32) / Mod);
+
+        for (size_t i = 0; i < n; i += length) {
+            std::uint32_t* lower = &a[i];
+            std::uint32_t* upper = &a[i + half];
+            for (size_t k = 0; k < half; ++k) {
+                std::uint32_t u = lower[k];
+                std::uint32_t quotient = static_cast<std::uint32_t>((std::uint64_t(upper[k]) * rootsShoup[k]) >> 32);
+                std::uint32_t v = upper[k] * roots[k] - quotient * Mod;   // in [0, 2 Mod), wraps mod 2^32
+                if (v >= Mod) v -= Mod;
+                lower[k] = u + v >= Mod ? u + v - Mod : u + v;
+                upper[k] = u >= v ? u - v : u + Mod - v;
+            }
+        }
+    }
+
+    if (inverse) {
+        const std::uint64_t scale = powMod<Mod>(n, Mod - 2);
+        for (std::uint32_t& value : a) value = static_cast<std::uint32_t>(value * scale % Mod);
+    }
+}
+
+// Cyclic convolution of a and b modulo Mod, 'length' coefficients
+template <std::uint32_t Mod>
+std::vector<std::uint32_t> convolve(const std::uint32_t* a, size_t na, const std::uint32_t* b, size_t nb, size_t length) {
+    std::vector<std::uint32_t> fa(length, 0), fb(length, 0);
+    for (size_t i = 0; i < na; ++i) fa[i] = a[i] % Mod;
+    for (size_t i = 0; i < nb; ++i) fb[i] = b[i] % Mod;
+    ntt<Mod>(fa, false);
+    ntt<Mod>(fb, false);
+    for (size_t i = 0; i < length; ++i) fa[i] = static_cast<std::uint32_t>(std::uint64_t(fa[i]) * fb[i] % Mod);
+    ntt<Mod>(fa, true);
+    return fa;
+}
+
+void multiplyNtt(const std::uint32_t* a, size_t na, const std::uint32_t* b, size_t nb, std::uint32_t* out) {
+    size_t length = 1;
+    while (length < na + nb - 1) length <<= 1;
+
+    const std::vector<std::uint32_t> residues[3] = {
+        convolve<P1>(a, na, b, nb, length),
+        convolve<P2>(a, na, b, nb, length),
+        convolve<P3>(a, na, b, nb, length),
+    };
+
+    constexpr std::uint64_t p1 = P1, p2 = P2, p3 = P3;
+    const std::uint64_t inverseP1 = powMod<P2>(p1, p2 - 2);
+    const std::uint64_t inverseP1P2 = powMod<P3>(p1 * p2 % p3, p3 - 2);
+    constexpr std::uint64_t p1p2Low = (p1 * p2) % Base, p1p2High = (p1 * p2) / Base;
+
+    // Each term is low + p1p2 * t3, spread over three limbs; sums stay far below 2^64
+    std::vector<std::uint64_t> sums(na + nb + 2, 0);
+    for (size_t k = 0; k < na + nb - 1; ++k) {
+        const std::uint64_t r1 = residues[0][k], r2 = residues[1][k], r3 = residues[2][k];
+        const std::uint64_t t2 = (r2 + p2 - r1 % p2) % p2 * inverseP1 % p2;
+        const std::uint64_t low = r1 + p1 * t2;
+        const std::uint64_t t3 = (r3 + p3 - low % p3) % p3 * inverseP1P2 % p3;
+
+        const std::uint64_t first = low + t3 * p1p2Low;
+        const std::uint64_t second = t3 * p1p2High;
+        sums[k] += first % Base;
+        sums[k + 1] += first / Base + second % Base;
+        sums[k + 2] += second / Base;
+    }
+
+    std::uint64_t carry = 0;
+    for (size_t k = 0; k < na + nb; ++k) {
+        std::uint64_t value = sums[k] + carry;
+        out[k] = static_cast<std::uint32_t>(value % Base);
+        carry = value / Base;
+    }
+}
+
+Limbs multiply(const std::uint32_t* a, size_t na, const std::uint32_t* b, size_t nb);
+
+// out[0 .. na+nb) = a * b for na >= nb >= KaratsubaThreshold
+void multiplyKaratsuba(const std::uint32_t* a, size_t na, const std::uint32_t* b, size_t nb, Limbs& out) {
+    const size_t half = (na + 1) / 2;
+    if (nb <= half) {
+        // Unbalanced: a0 * b + (a1 * b) << half
+        Limbs low = multiply(a, half, b, nb);
+        Limbs high = multiply(a + half, na - half, b, nb);
+        out.assign(na + nb, 0);
+        addAt(out, low.data(), low.size(), 0);
+        addAt(out, high.data(), high.size(), half);
+        out.resize(na + nb);
+        return;
+    }
+
+    const std::uint32_t* a0 = a;
+    const std::uint32_t* a1 = a + half;
+    const std::uint32_t* b0 = b;
+    const std::uint32_t* b1 = b + half;
+    const size_t na0 = trimmedSize(a0, half), nb0 = trimmedSize(b0, half);
+    const size_t na1 = na - half, nb1 = nb - half;
+
+    Limbs z0 = multiply(a0, na0, b0, nb0);
+    Limbs z2 = multiply(a1, na1, b1, nb1);
+
+    Limbs sumA(a0, a0 + na0), sumB(b0, b0 + nb0);
+    addAt(sumA, a1, na1, 0);
+    addAt(sumB, b1, nb1, 0);
+    Limbs z1 = multiply(sumA.data(), sumA.size(), sumB.data(), sumB.size());
+    subtractFrom(z1, z0.data(), z0.size());
+    subtractFrom(z1, z2.data(), z2.size());
+
+    out.assign(na + nb, 0);
+    addAt(out, z0.data(), trimmedSize(z0.data(), z0.size()), 0);
+    addAt(out, z1.data(), trimmedSize(z1.data(), z1.size()), half);
+    addAt(out, z2.data(), trimmedSize(z2.data(), z2.size()), 2 * half);
+    out.resize(na + nb);
+}
+
+// Product of two magnitudes, na + nb limbs (possibly with leading zeros)
+Limbs multiply(const std::uint32_t* a, size_t na, const std::uint32_t* b, size_t nb) {
+    if (na < nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    Limbs out;
+    if (nb == 0) return out;
+
+    if (nb < KaratsubaThreshold) {
+        out.assign(na + nb, 0);
+        multiplySchoolbook(a, na, b, nb, out.data());
+    } else if (nb >= NttThreshold && na + nb <= MaxNttLength) {
+        out.assign(na + nb, 0);
+        multiplyNtt(a, na, b, nb, out.data());
+    } else {
+        multiplyKaratsuba(a, na, b, nb, out);
+    }
+    return out;
+}
+
+} // namespace
+
+BigInt::BigInt(long long value) {
+    negative = value < 0;
+    // Negating through unsigned keeps LLONG_MIN defined
+    unsigned long long magnitude = negative ? 0ull - static_cast<unsigned long long>(value)
+                                            : static_cast<unsigned long long>(value);
+    while (magnitude) {
+        limbs.push_back(static_cast<std::uint32_t>(magnitude % Base));
+        magnitude /= Base;
+    }
+}
+
+bool BigInt::parse(std::string_view digits, BigInt& out) {
+    if (digits.empty()) return false;
+    out.limbs.clear();
+    out.negative = false;
+    for (size_t end = digits.size(); end > 0;) {
+        size_t start = end >= BaseDigits ? end - BaseDigits : 0;
+        std::uint32_t limb = 0;
+        for (size_t i = start; i < end; ++i) {
+            if (digits[i] < '0' || digits[i] > '9') return false;
+            limb = limb * 10 + static_cast<std::uint32_t>(digits[i] - '0');
+        }
+        out.limbs.push_back(limb);
+        end = start;
+    }
+    out.trim();
+    return true;
+}
+
+size_t BigInt::digitCount() const {
+    if (limbs.empty()) return 1;
+    size_t count = (limbs.size() - 1) * BaseDigits;
+    for (std::uint32_t top = limbs.back(); top; top /= 10) ++count;
+    return count;
+}
+
+size_t BigInt::trailingZeroLimbs() const {
+    size_t count = 0;
+    while (count < limbs.size() && limbs[count] == 0) ++count;
+    return count;
+}
+
+bool BigInt::toInt64(long long& out) const {
+    if (limbs.size() > 3) return false;
+    unsigned long long magnitude = 0;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        if (magnitude > (~0ull - limbs[i]) / Base) return false;
+        magnitude = magnitude * Base + limbs[i];
+    }
+    const unsigned long long limit = negative ? (1ull << 63) : (1ull << 63) - 1;
+    if (magnitude > limit) return false;
+    out = negative ? static_cast<long long>(0ull - magnitude) : static_cast<long long>(magnitude);
+    return true;
+}
+
+double BigInt::toDouble() const {
+    // The top three limbs carry more than double precision
+    double result = 0.0;
+    size_t used = std::min<size_t>(limbs.size(), 3);
+    for (size_t i = 0; i < used; ++i) result = result * Base + limbs[limbs.size() - 1 - i];
+    if (limbs.size() > used) result *= std::pow(10.0, static_cast<double>((limbs.size() - used) * BaseDigits));
+    return negative ? -result : result;
+}
+
+std::string BigInt::toString() const {
+    if (limbs.empty()) return "0";
+    std::string text = negative ? "-" : "";
+    text += std::to_string(limbs.back());
+    char buffer[BaseDigits];
+    for (size_t i = limbs.size() - 1; i-- > 0;) {
+        std::uint32_t limb = limbs[i];
+        for (int d = BaseDigits - 1; d >= 0; --d) {
+            buffer[d] = static_cast<char>('0' + limb % 10);
+            limb /= 10;
+        }
+        text.append(buffer, BaseDigits);
+    }
+    return text;
+}
+
+BigInt BigInt::operator-() const {
+    BigInt result = *this;
+    if (!result.isZero()) result.negative = !result.negative;
+    return result;
+}
+
+BigInt& BigInt::operator+=(const BigInt& other) {
+    if (negative == other.negative) {
+        addMagnitude(other);
+    } else if (compareMagnitude(*this, other) >= 0) {
+        subtractMagnitude(other);
+    } else {
+        BigInt result = other;
+        result.subtractMagnitude(*this);
+        *this = std::move(result);
+    }
+    return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& other) {
+    return *this += -other;
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs = multiply(a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size());
+    result.negative = a.negative != b.negative;
+    result.trim();
+    return result;
+}
+
+BigInt& BigInt::operator*=(const BigInt& other) {
+    return *this = *this * other;
+}
+
+BigInt& BigInt::operator*=(std::uint32_t factor) {
+    std::uint64_t carry = 0;
+    for (std::uint32_t& limb : limbs) {
+        std::uint64_t cur = std::uint64_t(limb) * factor + carry;
+        limb = static_cast<std::uint32_t>(cur % Base);
+        carry = cur / Base;
+    }
+    while (carry) {
+        limbs.push_back(static_cast<std::uint32_t>(carry % Base));
+        carry /= Base;
+    }
+    trim();
+    return *this;
+}
+
+std::uint32_t BigInt::divide(std::uint32_t divisor) {
+    std::uint64_t remainder = 0;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        std::uint64_t cur = limbs[i] + remainder * Base;
+        limbs[i] = static_cast<std::uint32_t>(cur / divisor);
+        remainder = cur % divisor;
+    }
+    trim();
+    return static_cast<std::uint32_t>(remainder);
+}
+
+void BigInt::divMod(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder) {
+    const bool quotientNegative = a.negative != b.negative;
+    const bool remainderNegative = a.negative;
+
+    if (compareMagnitude(a, b) < 0) {
+        remainder = a;
+        quotient = BigInt();
+        return;
+    }
+
+    const size_t n = b.limbs.size();
+    if (n == 1) {
+        quotient = a;
+        quotient.negative = false;
+        remainder = BigInt(quotient.divide(b.limbs[0]));
+    } else {
+        // Knuth, TAOCP vol. 2, 4.3.1, algorithm D
+        const std::uint64_t scale = Base / (std::uint64_t(b.limbs.back()) + 1);
+        BigInt u = a, v = b;
+        u.negative = v.negative = false;
+        u *= static_cast<std::uint32_t>(scale);
+        v *= static_cast<std::uint32_t>(scale);
+        u.limbs.resize(a.limbs.size() + 1, 0);
+
+        const size_t m = a.limbs.size() - n;
+        Limbs q(m + 1, 0);
+        const std::uint64_t top = v.limbs[n - 1], next = v.limbs[n - 2];
+        for (size_t j = m + 1; j-- > 0;) {
+            std::uint64_t numerator = std::uint64_t(u.limbs[j + n]) * Base + u.limbs[j + n - 1];
+            std::uint64_t qhat = numerator / top;
+            std::uint64_t rhat = numerator % top;
+            while (qhat >= Base || qhat * next > rhat * Base + u.limbs[j + n - 2]) {
+                --qhat;
+                rhat += top;
+                if (rhat >= Base) break;
+            }
+
+            std::int64_t borrow = 0;
+            std::uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                std::uint64_t product = qhat * v.limbs[i] + carry;
+                carry = product / Base;
+                std::int64_t diff = static_cast<std::int64_t>(u.limbs[i + j]) - static_cast<std::int64_t>(product % Base) - borrow;
+                borrow = diff < 0;
+                u.limbs[i + j] = static_cast<std::uint32_t>(borrow ? diff + static_cast<std::int64_t>(Base) : diff);
+            }
+            std::int64_t diff = static_cast<std::int64_t>(u.limbs[j + n]) - static_cast<std::int64_t>(carry) - borrow;
+            if (diff < 0) {
+                // qhat was one too large: add v back
+                --qhat;
+                std::uint32_t addCarry = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    std::uint32_t sum = u.limbs[i + j] + v.limbs[i] + addCarry;
+                    addCarry = sum >= Base;
+                    u.limbs[i + j] = addCarry ? sum - static_cast<std::uint32_t>(Base) : sum;
+                }
+                diff += addCarry;
+            }
+            u.limbs[j + n] = static_cast<std::uint32_t>(diff);
+            q[j] = static_cast<std::uint32_t>(qhat);
+        }
+
+        quotient.limbs = std::move(q);
+        quotient.negative = false;
+        quotient.trim();
+        u.limbs.resize(n);
+        u.trim();
+        u.divide(static_cast<std::uint32_t>(scale));
+        remainder = std::move(u);
+    }
+
+    if (!quotient.isZero()) quotient.negative = quotientNegative;
+    if (!remainder.isZero()) remainder.negative = remainderNegative;
+}
+
+BigInt& BigInt::shiftLimbsLeft(size_t count) {
+    if (!limbs.empty()) limbs.insert(limbs.begin(), count, 0);
+    return *this;
+}
+
+BigInt& BigInt::shiftLimbsRight(size_t count) {
+    limbs.erase(limbs.begin(), limbs.begin() + static_cast<std::ptrdiff_t>(std::min(count, limbs.size())));
+    trim();
+    return *this;
+}
+
+BigInt& BigInt::shiftDigitsLeft(size_t count) {
+    shiftLimbsLeft(count / BaseDigits);
+    static constexpr std::uint32_t Powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+    if (count % BaseDigits) *this *= Powers[count % BaseDigits];
+    return *this;
+}
+
+int BigInt::compareMagnitude(const BigInt& a, const BigInt& b) {
+    if (a.limbs.size() != b.limbs.size()) return a.limbs.size() < b.limbs.size() ? -1 : 1;
+    for (size_t i = a.limbs.size(); i-- > 0;) {
+        if (a.limbs[i] != b.limbs[i]) return a.limbs[i] < b.limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+int BigInt::compare(const BigInt& a, const BigInt& b) {
+    if (a.negative != b.negative) return a.negative ? -1 : 1;
+    int magnitude = compareMagnitude(a, b);
+    return a.negative ? -magnitude : magnitude;
+}
+
+BigInt BigInt::pow(std::uint64_t exponent) const {
+    BigInt result = 1, base = *this;
+    while (exponent) {
+        if (exponent & 1) result *= base;
+        exponent >>= 1;
+        if (exponent) base *= base;
+    }
+    return result;
+}
+
+BigInt BigInt::gcd(BigInt a, BigInt b) {
+    a.negative = false;
+    b.negative = false;
+    BigInt quotient, remainder;
+    while (!b.isZero()) {
+        if (a.limbs.size() <= 2 && b.limbs.size() <= 2) {
+            // Below Base^2 < 2^64
+            auto value = [](const BigInt& x) {
+                return x.limbs.size() == 2 ? std::uint64_t(x.limbs[1]) * Base + x.limbs[0] : std::uint64_t(x.limbs[0]);
+            };
+            const std::uint64_t result = gcd(a.isZero() ? 0 : value(a), value(b));
+            BigInt out;
+            for (std::uint64_t rest = result; rest > 0; rest /= Base) out.limbs.push_back(static_cast<std::uint32_t>(rest % Base));
+            return out;
+        }
+        divMod(a, b, quotient, remainder);
+        a = std::move(b);
+        b = std::move(remainder);
+        b.negative = false;
+    }
+    return a;
+}
+
+std::uint64_t BigInt::gcd(std::uint64_t a, std::uint64_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    // Stein's algorithm: shifts and subtractions, no division
+    const int shift = countTrailingZeros(a | b);
+    a >>= countTrailingZeros(a);
+    do {
+        b >>= countTrailingZeros(b);
+        if (a > b) std::swap(a, b);
+        b -= a;
+    } while (b != 0);
+    return a << shift;
+}
+
+BigInt BigInt::rangeProduct(std::uint64_t first, std::uint64_t last) {
+    if (first > last) return 1;
+    if (last - first < 16) {
+        BigInt result = 1;
+        for (std::uint64_t i = first; i <= last; ++i) {
+            // Factors above 2^32 are split; the combinatorics only pass 32-bit ones
+            if (i > 0xffffffffull) result *= BigInt(static_cast<long long>(i));
+            else result *= static_cast<std::uint32_t>(i);
+        }
+        return result;
+    }
+    std::uint64_t middle = first + (last - first) / 2;
+    return rangeProduct(first, middle) * rangeProduct(middle + 1, last);
+}
+
+BigInt BigInt::factorial(std::uint32_t n) {
+    return rangeProduct(2, n);
+}
+
+BigInt BigInt::permutation(std::uint32_t n, std::uint32_t r) {
+    return rangeProduct(std::uint64_t(n) - r + 1, n);
+}
+
+namespace {
+
+BigInt product(const std::uint32_t* factors, size_t count) {
+    if (count <= 16) {
+        BigInt result = 1;
+        for (size_t i = 0; i < count; ++i) result *= factors[i];
+        return result;
+    }
+    return product(factors, count / 2) * product(factors + count / 2, count - count / 2);
+}
+
+} // namespace
+
+BigInt BigInt::combination(std::uint32_t n, std::uint32_t r) {
+    r = std::min(r, n - r);
+    if (r == 0) return 1;
+
+    if (n > (1u << 26)) {
+        // Too large to sieve; the quotient is exact
+        BigInt quotient, remainder;
+        divMod(permutation(n, r), factorial(r), quotient, remainder);
+        return quotient;
+    }
+
+    // Legendre's formula gives the exponent of each prime; by Kummer's
+    // theorem every prime power that occurs is at most n
+    std::vector<bool> composite(size_t(n) + 1, false);
+    std::vector<std::uint32_t> factors;
+    for (std::uint64_t p = 2; p <= n; ++p) {
+        if (composite[p]) continue;
+        for (std::uint64_t multiple = p * p; multiple <= n; multiple += p) composite[multiple] = true;
+
+        std::uint64_t power = 1;
+        for (std::uint64_t q = p; q <= n; q *= p) {
+            std::uint64_t exponent = n / q - r / q - (n - r) / q;
+            for (std::uint64_t k = 0; k < exponent; ++k) power *= p;
+        }
+        if (power > 1) factors.push_back(static_cast<std::uint32_t>(power));
+    }
+    return product(factors.data(), factors.size());
+}
+
+void BigInt::trim() {
+    while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    if (limbs.empty()) negative = false;
+}
+
+void BigInt::addMagnitude(const BigInt& other) {
+    addAt(limbs, other.limbs.data(), other.limbs.size(), 0);
+}
+
+void BigInt::subtractMagnitude(const BigInt& other) {
+    subtractFrom(limbs, other.limbs.data(), other.limbs.size());
+    trim();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Arbitrary-precision signed integer, stored as base 10^9 limbs so decimal
+// input and output are linear. Multiplication picks schoolbook, Karatsuba or
+// a three-prime number theoretic transform by operand size; division is
+// schoolbook long division (Knuth D).
+class BigInt {
+public:
+    static constexpr std::uint32_t Base = 1000000000;
+    static constexpr int BaseDigits = 9;
+
+    BigInt() = default;
+    BigInt(long long value);
+
+    // Decimal digits only, no sign; false for empty or non-digit input
+    static bool parse(std::string_view digits, BigInt& out);
+
+    bool isZero() const { return limbs.empty(); }
+    bool isNegative() const { return negative; }
+    size_t limbCount() const { return limbs.size(); }
+    size_t trailingZeroLimbs() const;
+    size_t digitCount() const;
+    // Whether the value fits a long long; 'out' is only written if it does
+    bool toInt64(long long& out) const;
+    double toDouble() const;
+    std::string toString() const;
+
+    BigInt operator-() const;
+    BigInt& operator+=(const BigInt& other);
+    BigInt& operator-=(const BigInt& other);
+    BigInt& operator*=(const BigInt& other);
+    BigInt& operator*=(std::uint32_t factor);
+    friend BigInt operator+(BigInt a, const BigInt& b) { return a += b; }
+    friend BigInt operator-(BigInt a, const BigInt& b) { return a -= b; }
+    friend BigInt operator*(const BigInt& a, const BigInt& b);
+
+    // Truncating division: a = quotient * b + remainder, remainder has the
+    // sign of a. b must not be zero.
+    static void divMod(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder);
+    // In-place division by a small divisor; returns the remainder magnitude
+    std::uint32_t divide(std::uint32_t divisor);
+
+    // Multiplies or divides (truncating) by Base^count
+    BigInt& shiftLimbsLeft(size_t count);
+    BigInt& shiftLimbsRight(size_t count);
+    // Multiplies by 10^count
+    BigInt& shiftDigitsLeft(size_t count);
+
+    static int compare(const BigInt& a, const BigInt& b);
+    static int compareMagnitude(const BigInt& a, const BigInt& b);
+    friend bool operator==(const BigInt& a, const BigInt& b) { return compare(a, b) == 0; }
+    friend bool operator!=(const BigInt& a, const BigInt& b) { return compare(a, b) != 0; }
+    friend bool operator<(const BigInt& a, const BigInt& b) { return compare(a, b) < 0; }
+
+    BigInt pow(std::uint64_t exponent) const;
+
+    // Greatest common divisor of the magnitudes; Euclid's algorithm until
+    // both fit 64 bits, then binary GCD
+    static BigInt gcd(BigInt a, BigInt b);
+    static std::uint64_t gcd(std::uint64_t a, std::uint64_t b);
+
+    // Exact combinatorics, by binary splitting (balanced product trees), so
+    // the large multiplications are the fast ones
+    static BigInt factorial(std::uint32_t n);
+    static BigInt permutation(std::uint32_t n, std::uint32_t r);  // n! / (n-r)!, r <= n
+    static BigInt combination(std::uint32_t n, std::uint32_t r);  // from the prime factorization, r <= n
+
+    // Product of the integers in [first, last]
+    static BigInt rangeProduct(std::uint64_t first, std::uint64_t last);
+
+private:
+    std::vector<std::uint32_t> limbs;   // least significant first, no leading zero limbs
+    bool negative = false;              // never set for zero
+
+    void trim();
+    void addMagnitude(const BigInt& other);
+    void subtractMagnitude(const BigInt& other);    // requires |this| >= |other|
+};
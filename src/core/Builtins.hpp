@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include "CompiledExpression.hpp"
+#include "Combinatorics.hpp"
+
+// Registry of the built-in functions understood by the expression compiler.
+// The table is indexed by FunctionId and looked up by name through a perfect
+// hash computed at compile time, so resolving a name costs one hash and one
+// string comparison, and evaluating a call is a single indirect call.
+namespace Builtins {
+
+enum Flags : std::uint8_t {
+    Pure            = 1 << 0,   // result depends only on the arguments
+    AngleArgument   = 1 << 1,   // argument is an angle in the current AngleMode unit
+    AngleResult     = 1 << 2,   // result is an angle in the current AngleMode unit
+    IntegerArgument = 1 << 3,   // argument is truncated to an integer
+    Calculus        = 1 << 4,   // first argument is an expression body, not a value
+    OptionalLast    = 1 << 5    // the last argument may be left out and is then 0
+};
+
+// Math kernels work in radians; the compiler inserts degree conversions
+// around them as the angle flags require
+// Arguments past the function's arity are unspecified
+using Function = double (*)(double a, double b, double c);
+
+// Returns the error for arguments outside the domain, MathError::None otherwise
+using DomainCheck = MathError (*)(double a, double b, double c);
+
+struct Info {
+    std::string_view name;      // lower case
+    FunctionId id;
+    OpCode op;                  // OpCode::Function, or the calculus operator
+    std::uint8_t arity;
+    std::uint8_t flags;
+    Function function;
+    DomainCheck domain;
+};
+
+namespace detail {
+
+// Truncates its argument. Evaluators check it with factorialRange first, but
+// Taylor coefficients call kernels unchecked, so NaN and huge values must not
+// reach the int cast
+inline double factorial(double a, double, double) {
+    if (std::isnan(a)) return a;
+    if (a >= 171.0) return std::numeric_limits<double>::infinity();
+    const int n = a < 0.0 ? 0 : static_cast<int>(a);
+    double result = 1.0;
+    for (int i = 2; i <= n; ++i) {
+        result *= i;
+    }
+    return result;
+}
+
+inline MathError unitInterval(double a, double, double) { return (a < -1.0 || a > 1.0) ? MathError::AsinDomain : MathError::None; }
+inline MathError unitIntervalCos(double a, double, double) { return (a < -1.0 || a > 1.0) ? MathError::AcosDomain : MathError::None; }
+inline MathError positiveLog(double a, double, double) { return a <= 0.0 ? MathError::LogDomain : MathError::None; }
+inline MathError positiveLn(double a, double, double) { return a <= 0.0 ? MathError::LnDomain : MathError::None; }
+inline MathError nonNegativeSqrt(double a, double, double) { return a < 0.0 ? MathError::SqrtDomain : MathError::None; }
+inline MathError atLeastOne(double a, double, double) { return a < 1.0 ? MathError::AcoshDomain : MathError::None; }
+inline MathError openUnitInterval(double a, double, double) { return (a <= -1.0 || a >= 1.0) ? MathError::AtanhDomain : MathError::None; }
+inline MathError factorialRange(double a, double, double) {
+    if (std::isnan(a)) return MathError::FactorialDomain;
+    const double n = std::trunc(a);
+    if (n < 0.0) return MathError::FactorialNegative;
+    if (n > 170.0) return MathError::FactorialOverflow;
+    return MathError::None;
+}
+
+} // namespace detail
+
+inline constexpr std::array<Info, 27> table = {{
+    { "sin",   FunctionId::Sin,   OpCode::Function, 1, Pure | AngleArgument, [](double a, double, double) { return std::sin(a); }, nullptr },
+    { "cos",   FunctionId::Cos,   OpCode::Function, 1, Pure | AngleArgument, [](double a, double, double) { return std::cos(a); }, nullptr },
+    { "tan",   FunctionId::Tan,   OpCode::Function, 1, Pure | AngleArgument, [](double a, double, double) { return std::tan(a); }, nullptr },
+    { "asin",  FunctionId::Asin,  OpCode::Function, 1, Pure | AngleResult,   [](double a, double, double) { return std::asin(a); }, detail::unitInterval },
+    { "acos",  FunctionId::Acos,  OpCode::Function, 1, Pure | AngleResult,   [](double a, double, double) { return std::acos(a); }, detail::unitIntervalCos },
+    { "atan",  FunctionId::Atan,  OpCode::Function, 1, Pure | AngleResult,   [](double a, double, double) { return std::atan(a); }, nullptr },
+    { "log",   FunctionId::Log,   OpCode::Function, 1, Pure, [](double a, double, double) { return std::log10(a); }, detail::positiveLog },
+    { "ln",    FunctionId::Ln,    OpCode::Function, 1, Pure, [](double a, double, double) { return std::log(a); }, detail::positiveLn },
+    { "sqrt",  FunctionId::Sqrt,  OpCode::Function, 1, Pure, [](double a, double, double) { return std::sqrt(a); }, detail::nonNegativeSqrt },
+    { "cbrt",  FunctionId::Cbrt,  OpCode::Function, 1, Pure, [](double a, double, double) { return std::cbrt(a); }, nullptr },
+    { "exp",   FunctionId::Exp,   OpCode::Function, 1, Pure, [](double a, double, double) { return std::exp(a); }, nullptr },
+    { "abs",   FunctionId::Abs,   OpCode::Function, 1, Pure, [](double a, double, double) { return std::abs(a); }, nullptr },
+    { "fact",  FunctionId::Fact,  OpCode::Function, 1, Pure | IntegerArgument, detail::factorial, detail::factorialRange },
+    // nCr(n, r, p) is nCr(n, r) mod the prime p, plain nCr(n, r) for p = 0
+    { "ncr",   FunctionId::Ncr,   OpCode::Function, 3, Pure | IntegerArgument | OptionalLast, Combinatorics::combinationModulo, Combinatorics::checkCombinationModulo },
+    { "npr",   FunctionId::Npr,   OpCode::Function, 2, Pure | IntegerArgument,
+      [](double a, double b, double) { return Combinatorics::permutation(a, b); },
+      [](double a, double b, double) { return Combinatorics::checkPermutation(a, b); } },
+    { "sinh",  FunctionId::Sinh,  OpCode::Function, 1, Pure, [](double a, double, double) { return std::sinh(a); }, nullptr },
+    { "cosh",  FunctionId::Cosh,  OpCode::Function, 1, Pure, [](double a, double, double) { return std::cosh(a); }, nullptr },
+    { "tanh",  FunctionId::Tanh,  OpCode::Function, 1, Pure, [](double a, double, double) { return std::tanh(a); }, nullptr },
+    { "asinh", FunctionId::Asinh, OpCode::Function, 1, Pure, [](double a, double, double) { return std::asinh(a); }, nullptr },
+    { "acosh", FunctionId::Acosh, OpCode::Function, 1, Pure, [](double a, double, double) { return std::acosh(a); }, detail::atLeastOne },
+    { "atanh", FunctionId::Atanh, OpCode::Function, 1, Pure, [](double a, double, double) { return std::atanh(a); }, detail::openUnitInterval },
+
+    // Calculus operators take their first argument as an expression body
+    { "diff",  FunctionId::Diff,  OpCode::Derivative, 2, Pure | Calculus, nullptr, nullptr },
+    { "int",   FunctionId::Int,   OpCode::Integral,   3, Pure | Calculus, nullptr, nullptr },
+    { "sum",   FunctionId::Sum,   OpCode::Summation,  3, Pure | Calculus, nullptr, nullptr },
+    { "lim",   FunctionId::Lim,   OpCode::Limit,      2, Pure | Calculus, nullptr, nullptr },
+    { "solve", FunctionId::Solve, OpCode::Solve,      3, Pure | Calculus, nullptr, nullptr },
+    { "ode",   FunctionId::Ode,   OpCode::Ode,        4, Pure | Calculus, nullptr, nullptr },
+}};
+
+constexpr const Info& get(FunctionId id) {
+    return table[static_cast<size_t>(id)];
+}
+
+constexpr bool isIndexedById() {
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (static_cast<size_t>(table[i].id) != i) return false;
+    }
+    return true;
+}
+static_assert(isIndexedById(), "Builtins::table must be ordered by FunctionId");
+
+// Perfect hash over the lower-cased names
+
+constexpr size_t HashSlots = 64;
+static_assert((HashSlots & (HashSlots - 1)) == 0 && HashSlots > table.size(), "HashSlots must be a power of two");
+
+constexpr char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr std::uint32_t hash(std::string_view name, std::uint32_t seed) {
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(foldCase(c));
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    return h;
+}
+
+struct PerfectHash {
+    std::uint32_t seed;
+    std::array<std::uint8_t, HashSlots> slots;  // table index + 1, 0 when empty
+};
+
+constexpr PerfectHash buildPerfectHash() {
+    for (std::uint32_t seed = 1; seed < 100000; ++seed) {
+        PerfectHash result{ seed, {} };
+        bool collision = false;
+        for (size_t i = 0; i < table.size() && !collision; ++i) {
+            size_t slot = hash(table[i].name, seed) & (HashSlots - 1);
+            if (result.slots[slot] != 0) collision = true;
+            else result.slots[slot] = static_cast<std::uint8_t>(i + 1);
+        }
+        if (!collision) return result;
+    }
+    return PerfectHash{ 0, {} };
+}
+
+inline constexpr PerfectHash perfectHash = buildPerfectHash();
+static_assert(perfectHash.seed != 0, "No perfect hash seed found for Builtins::table");
+
+// Case-insensitive lookup; returns nullptr for unknown names
+constexpr const Info* find(std::string_view name) {
+    std::uint8_t slot = perfectHash.slots[hash(name, perfectHash.seed) & (HashSlots - 1)];
+    if (slot == 0) return nullptr;
+
+    const Info& entry = table[slot - 1];
+    if (entry.name.size() != name.size()) return nullptr;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (foldCase(name[i]) != entry.name[i]) return nullptr;
+    }
+    return &entry;
+}
+
+} // namespace Builtins
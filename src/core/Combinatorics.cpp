@@ -0,0 +1,234 @@
+#include "Combinatorics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+constexpr double TwoPow64 = 18446744073709551616.0;
+constexpr std::uint64_t MaxUint64 = std::numeric_limits<std::uint64_t>::max();
+
+// Arguments are below MaxModulus, so the product fits 64 bits
+std::uint64_t mulMod(std::uint64_t a, std::uint64_t b, std::uint64_t modulus) {
+    return a * b % modulus;
+}
+
+std::uint64_t powMod(std::uint64_t base, std::uint64_t exponent, std::uint64_t modulus) {
+    std::uint64_t result = 1 % modulus;
+    base %= modulus;
+    while (exponent > 0) {
+        if (exponent & 1) result = mulMod(result, base, modulus);
+        base = mulMod(base, base, modulus);
+        exponent >>= 1;
+    }
+    return result;
+}
+
+// Larger n are computed directly instead of growing the tables further
+constexpr std::uint64_t MaxTableSize = std::uint64_t(1) << 22;
+
+// k! and 1/k! mod one prime, for k below the table size
+struct FactorialTable {
+    std::uint64_t modulus = 0;
+    std::vector<std::uint32_t> factorials;
+    std::vector<std::uint32_t> inverses;
+
+    void reset(std::uint64_t prime) {
+        modulus = prime;
+        factorials.clear();
+        inverses.clear();
+    }
+
+    // Makes the entries up to n available; n < modulus
+    void reserve(std::uint64_t n) {
+        if (n < factorials.size()) return;
+
+        // Geometric growth keeps a run of increasing arguments linear overall
+        const size_t size = static_cast<size_t>(std::min<std::uint64_t>(
+            std::max<std::uint64_t>(n + 1, factorials.size() * 2), std::min(modulus, MaxTableSize)));
+        size_t first = factorials.size();
+        factorials.resize(size);
+        if (first == 0) factorials[first++] = 1;
+        for (size_t i = first; i < size; ++i) {
+            factorials[i] = static_cast<std::uint32_t>(mulMod(factorials[i - 1], i, modulus));
+        }
+
+        // One modular inverse at the top, then 1/(k-1)! = k * 1/k! downwards
+        inverses.resize(size);
+        inverses[size - 1] = static_cast<std::uint32_t>(powMod(factorials[size - 1], modulus - 2, modulus));
+        for (size_t i = size - 1; i > 0; --i) {
+            inverses[i - 1] = static_cast<std::uint32_t>(mulMod(inverses[i], i, modulus));
+        }
+    }
+};
+
+// Per thread, so evaluation stays reentrant without locking
+thread_local FactorialTable table;
+thread_local std::uint64_t lastPrime = 0;
+
+// C(n, r) mod p for n < p
+std::uint64_t residueCombination(std::uint64_t n, std::uint64_t r, std::uint64_t p) {
+    if (r > n) return 0;
+    if (n < MaxTableSize) {
+        if (table.modulus != p) table.reset(p);
+        table.reserve(n);
+        return mulMod(mulMod(table.factorials[n], table.inverses[r], p), table.inverses[n - r], p);
+    }
+
+    // One pass over min(r, n - r) factors and a single inverse
+    r = std::min(r, n - r);
+    std::uint64_t numerator = 1;
+    std::uint64_t denominator = 1;
+    for (std::uint64_t i = 1; i <= r; ++i) {
+        numerator = mulMod(numerator, n - r + i, p);
+        denominator = mulMod(denominator, i, p);
+    }
+    return mulMod(numerator, powMod(denominator, p - 2, p), p);
+}
+
+} // namespace
+
+namespace Combinatorics {
+
+double combination(double n, double r) {
+    n = std::trunc(n);
+    r = std::trunc(r);
+    const double k = std::min(r, n - r);
+    if (k <= 0.0) return 1.0;
+
+    // C(n, i) = C(n, i-1) * (n - k + i) / i is an integer at every step.
+    // Once the product would overflow, dividing by gcd(C, i) first keeps it
+    // small enough for a few more steps.
+    std::uint64_t exact = 1;
+    std::uint64_t i = 1;
+    if (n < TwoPow64) {
+        const std::uint64_t count = static_cast<std::uint64_t>(k);
+        const std::uint64_t top = static_cast<std::uint64_t>(n) - count;
+        for (; i <= count; ++i) {
+            if (exact <= MaxUint64 / (top + i)) {
+                exact = exact * (top + i) / i;
+                continue;
+            }
+            const std::uint64_t g = std::gcd(exact, i);
+            const std::uint64_t factor = (top + i) / (i / g);
+            const std::uint64_t reduced = exact / g;
+            if (reduced > MaxUint64 / factor) break;
+            exact = reduced * factor;
+        }
+        if (i > count) return static_cast<double>(exact);
+    }
+
+    if (k - static_cast<double>(i) < static_cast<double>(LongProductSteps)) {
+        const double top = n - k;
+        double value = static_cast<double>(exact);
+        for (double j = static_cast<double>(i); j <= k && std::isfinite(value); ++j) {
+            value *= (top + j) / j;
+        }
+        return value;
+    }
+    return std::exp(std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0));
+}
+
+double permutation(double n, double r) {
+    n = std::trunc(n);
+    r = std::trunc(r);
+    if (r <= 0.0) return 1.0;
+
+    // n * (n-1) * ... * (n-r+1)
+    std::uint64_t exact = 1;
+    std::uint64_t i = 0;
+    if (n < TwoPow64) {
+        const std::uint64_t count = static_cast<std::uint64_t>(r);
+        const std::uint64_t top = static_cast<std::uint64_t>(n);
+        for (; i < count; ++i) {
+            if (exact > MaxUint64 / (top - i)) break;
+            exact *= top - i;
+        }
+        if (i == count) return static_cast<double>(exact);
+    }
+
+    if (r - static_cast<double>(i) <= static_cast<double>(LongProductSteps)) {
+        double value = static_cast<double>(exact);
+        for (double j = static_cast<double>(i); j < r && std::isfinite(value); ++j) {
+            value *= n - j;
+        }
+        return value;
+    }
+    return std::exp(std::lgamma(n + 1.0) - std::lgamma(n - r + 1.0));
+}
+
+double combinationModulo(double n, double r, double p) {
+    p = std::trunc(p);
+    if (p == 0.0) return combination(n, r);
+
+    std::uint64_t top = static_cast<std::uint64_t>(std::trunc(n));
+    std::uint64_t bottom = static_cast<std::uint64_t>(std::trunc(r));
+    const std::uint64_t modulus = static_cast<std::uint64_t>(p);
+
+    // Lucas' theorem: the product of C(n_i, r_i) over the base-p digits
+    std::uint64_t result = 1 % modulus;
+    while (bottom > 0 && result != 0) {
+        result = mulMod(result, residueCombination(top % modulus, bottom % modulus, modulus), modulus);
+        top /= modulus;
+        bottom /= modulus;
+    }
+    return static_cast<double>(result);
+}
+
+MathError checkCombination(double n, double r) {
+    n = std::trunc(n);
+    r = std::trunc(r);
+    if (!(r >= 0.0 && r <= n) || std::isinf(n)) return MathError::InvalidCombination;
+    return MathError::None;
+}
+
+MathError checkPermutation(double n, double r) {
+    n = std::trunc(n);
+    r = std::trunc(r);
+    if (!(r >= 0.0 && r <= n) || std::isinf(n)) return MathError::InvalidPermutation;
+    return MathError::None;
+}
+
+MathError checkCombinationModulo(double n, double r, double p) {
+    MathError error = checkCombination(n, r);
+    p = std::trunc(p);
+    if (error != MathError::None || p == 0.0) return error;
+    if (n >= TwoPow64) return MathError::InvalidCombination;
+
+    if (!(p >= 2.0 && p < static_cast<double>(MaxModulus))) return MathError::InvalidModulus;
+    const std::uint64_t modulus = static_cast<std::uint64_t>(p);
+    if (modulus == lastPrime) return MathError::None;
+    if (!isPrime(modulus)) return MathError::InvalidModulus;
+    lastPrime = modulus;
+    return MathError::None;
+}
+
+bool isPrime(std::uint64_t value) {
+    if (value < 2) return false;
+    for (std::uint64_t small : { 2, 3, 5, 7 }) {
+        if (value % small == 0) return value == small;
+    }
+
+    // value - 1 = d * 2^s; bases 2, 3, 5 and 7 decide every value below 3.2e9
+    std::uint64_t d = value - 1;
+    int s = 0;
+    while ((d & 1) == 0) {
+        d >>= 1;
+        ++s;
+    }
+    for (std::uint64_t base : { 2, 3, 5, 7 }) {
+        std::uint64_t x = powMod(base, d, value);
+        if (x == 1 || x == value - 1) continue;
+        bool composite = true;
+        for (int i = 1; i < s && composite; ++i) {
+            x = mulMod(x, x, value);
+            if (x == value - 1) composite = false;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+} // namespace Combinatorics
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include "MathError.hpp"
+
+// Kernels of the nCr and nPr built-ins. Arguments are truncated to integers.
+//
+// Results are exact while they fit 64 bits: the multiplicative formula runs
+// in integers with an overflow check. Past that the product continues in
+// double for up to LongProductSteps factors, and larger arguments go
+// through lgamma. Results beyond the double range are +inf.
+namespace Combinatorics {
+
+constexpr std::uint64_t LongProductSteps = 1 << 16;
+
+// Largest modulus of combinationModulo, so products of residues fit 64 bits
+constexpr std::uint64_t MaxModulus = std::uint64_t(1) << 31;
+
+// n! / (r! (n-r)!) and n! / (n-r)!
+double combination(double n, double r);
+double permutation(double n, double r);
+
+// nCr mod p for a prime p < MaxModulus. Uses factorial and inverse
+// factorial tables mod p that are built on first use and grown as needed,
+// one set per thread, and Lucas' theorem for n >= p.
+double combinationModulo(double n, double r, double p);
+
+MathError checkCombination(double n, double r);
+MathError checkPermutation(double n, double r);
+// Also checks that a modulus other than 0 is a prime below MaxModulus
+MathError checkCombinationModulo(double n, double r, double p);
+
+// Deterministic Miller-Rabin for 32-bit values
+bool isPrime(std::uint64_t value);
+
+} // namespace Combinatorics
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// Running sum with Neumaier's variant of Kahan compensation: the rounding
+// error of every addition is kept aside and added back at the end, so the
+// total is off by a few ulps however many terms there are, where plain
+// summation of n terms drifts by up to n ulps.
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double value) {
+        const double total = sum + value;
+        if (std::abs(sum) >= std::abs(value)) compensation += (sum - total) + value;
+        else compensation += (value - total) + sum;
+        sum = total;
+    }
+    void add(const CompensatedSum& other) {
+        add(other.sum);
+        compensation += other.compensation;
+    }
+    // Infinities and NaN make the compensation meaningless
+    double value() const { return std::isfinite(sum) ? sum + compensation : sum; }
+};
+
+// Adds up partial sums pairwise, in an order that depends only on 'count'
+inline CompensatedSum reducePairwise(CompensatedSum* sums, size_t count) {
+    if (count == 0) return CompensatedSum();
+    for (size_t width = 1; width < count; width *= 2) {
+        for (size_t i = 0; i + width < count; i += 2 * width) sums[i].add(sums[i + width]);
+    }
+    return sums[0];
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "MathError.hpp"
+
+class JitFunction;
+
+// Operation performed by one node of a compiled expression
+enum class OpCode : std::uint8_t {
+    Constant,
+    VariableX,
+    Variable,       // named variable of MathEngine::compile(expression, variables), also read by bodies
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Power,
+    Negate,
+    Reciprocal,     // 1 / x without a division by zero error, like x^-1
+    Function,
+
+    // Calculus operators; the first argument is compiled into a separate body
+    Derivative,
+    Integral,
+    Limit,
+    Summation,
+    Solve,
+    Ode             // also binds y, as the variable in slot 'variable'
+};
+
+// Built-in functions, resolved from their name at compile time (see Builtins.hpp)
+enum class FunctionId : std::uint8_t {
+    Sin, Cos, Tan, Asin, Acos, Atan,
+    Log, Ln, Sqrt, Cbrt, Exp, Abs, Fact, Ncr, Npr,
+    Sinh, Cosh, Tanh, Asinh, Acosh, Atanh,
+    Diff, Int, Sum, Lim, Solve, Ode
+};
+
+// Unit of angles taken by trigonometric functions and returned by their inverses
+enum class AngleMode : std::uint8_t { Degrees, Radians };
+
+// One instruction of a compiled expression.
+// Operands always refer to nodes with a smaller index, so the whole program
+// is executed by a single forward pass and the last node holds the result.
+struct ExpressionNode {
+    OpCode op;
+    FunctionId function;    // OpCode::Function
+    bool invariant;         // does not depend on x: the same for every point of a batch
+    std::uint16_t variable; // OpCode::Variable: index into the top-level program's variables,
+                            // or the slot of an ode() body's y past them
+    std::uint32_t lhs;      // first operand (or the only one)
+    std::uint32_t rhs;      // second operand, if any
+    std::uint32_t body;     // index into the body table for calculus operators
+    std::uint32_t third;    // third operand of three-argument functions
+    double value;           // OpCode::Constant
+};
+
+// Native code of a compiled expression, filled in by MathEngine once the
+// program gets hot. Evaluations on several threads may update it at once:
+// exactly one of them compiles, the others keep interpreting until the code
+// is published. A copy starts over without native code.
+class NativeCode {
+public:
+    NativeCode() = default;
+    NativeCode(const NativeCode&) {}
+    NativeCode& operator=(const NativeCode&) {
+        owner.reset();
+        function.store(nullptr);
+        evaluations.store(0);
+        unavailable.store(false);
+        return *this;
+    }
+
+    const JitFunction* get() const { return function.load(std::memory_order_acquire); }
+
+    // Counts one interpreted evaluation; true for the single call that
+    // takes the count past 'threshold' and should compile the program
+    bool countEvaluation(size_t threshold) {
+        if (unavailable.load(std::memory_order_relaxed)) return false;
+        return evaluations.fetch_add(1, std::memory_order_relaxed) == threshold;
+    }
+
+    // Called once by the thread countEvaluation() picked; nullptr means the
+    // program cannot be compiled
+    void publish(std::shared_ptr<const JitFunction> code) {
+        if (!code) {
+            unavailable.store(true, std::memory_order_relaxed);
+            return;
+        }
+        owner = std::move(code);
+        function.store(owner.get(), std::memory_order_release);
+    }
+
+private:
+    std::shared_ptr<const JitFunction> owner;
+    std::atomic<const JitFunction*> function{ nullptr };
+    std::atomic<size_t> evaluations{ 0 };
+    std::atomic<bool> unavailable{ false };
+};
+
+// Immutable, parsed form of an expression string.
+// Produced by MathEngine::compile() and executed by MathEngine::evaluate()
+// any number of times without touching the original text again; one program
+// can be evaluated from several threads at once.
+class CompiledExpression {
+public:
+    CompiledExpression() = default;
+
+    const std::string& getSource() const { return source; }
+    // Parse error, if any; the message is only formatted when asked for
+    MathError getErrorCode() const { return error; }
+    std::string getError() const { return formatError(error, source, errorPosition); }
+    bool isValid() const { return error == MathError::None && !nodes.empty(); }
+
+    size_t size() const { return nodes.size(); }
+    const std::vector<ExpressionNode>& getNodes() const { return nodes; }
+
+    // Operations shared with an identical earlier subexpression at compile
+    // time, i.e. evaluations saved per sample (bodies included)
+    size_t getDeduplicatedNodes() const { return deduplicated; }
+
+    // False when the program uses calculus operators, which interval
+    // evaluation cannot bound, or named variables
+    bool hasIntervalForm() const {
+        for (const ExpressionNode& node : nodes) {
+            if (node.op >= OpCode::Derivative || node.op == OpCode::Variable) return false;
+        }
+        return true;
+    }
+
+    // True when the program uses calculus operators, each evaluation of
+    // which runs a numerical method over its body
+    bool hasCalculus() const {
+        for (const ExpressionNode& node : nodes) {
+            if (node.op >= OpCode::Derivative) return true;
+        }
+        return false;
+    }
+
+    // Lower-case names of the variables the program was compiled with, in
+    // order; empty for the usual programs of x alone
+    const std::vector<std::string>& getVariables() const { return variables; }
+    // Values taken by the multi-variable evaluate() and gradient(): one per
+    // variable, or x
+    size_t getVariableCount() const { return variables.empty() ? 1 : variables.size(); }
+    // True when the program or one of its calculus bodies reads named
+    // variables; bodies read those of the top-level program
+    bool readsVariables() const { return usesVariables; }
+    
+    // True once the program runs as native code (see MathEngine::setJitThreshold)
+    bool isNative() const { return native.get() != nullptr; }
+
+    // Compile-time settings baked into the program
+    bool dependsOnAngleMode() const { return usesAngles; }
+    bool dependsOnDefinitions() const { return usesDefinitions; }
+
+private:
+    friend class MathEngine;
+    friend class ExpressionParser;
+    friend class ExpressionOptimizer;
+
+    std::string source;
+    MathError error = MathError::None;
+    std::uint32_t errorPosition = 0;        // offset into source
+    std::vector<ExpressionNode> nodes;
+    std::vector<CompiledExpression> bodies; // f in diff(f, a), int(f, a, b), ...
+    std::vector<std::string> variables;
+    bool usesAngles = false;
+    bool usesDefinitions = false;
+    bool usesVariables = false;
+    size_t deduplicated = 0;
+
+    mutable NativeCode native;
+
+    std::uint32_t emit(const ExpressionNode& node) {
+        nodes.push_back(node);
+        return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+};
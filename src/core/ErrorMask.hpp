@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+// Per-lane error state of a batch evaluation (MathEngine::evaluateBatch).
+// A failed lane keeps its first error, like EvalContext; the other lanes are
+// not affected. Lanes only store a one-byte MathError, messages are formatted
+// when asked for.
+class ErrorMask {
+public:
+    // Clears every flag and sizes the mask for 'lanes' lanes
+    void reset(size_t lanes) {
+        codes.assign(lanes, MathError::None);
+        failures = 0;
+        parseError.clear();
+    }
+
+    size_t size() const { return codes.size(); }
+    bool any() const { return failures != 0; }
+    size_t count() const { return failures; }
+    bool test(size_t lane) const { return codes[lane] != MathError::None; }
+    MathError error(size_t lane) const { return codes[lane]; }
+
+    // Lowest failed lane, size() if none
+    size_t first() const {
+        size_t lane = 0;
+        while (lane < codes.size() && codes[lane] == MathError::None) ++lane;
+        return lane;
+    }
+
+    // Error message of a failed lane, empty for a lane without error
+    std::string message(size_t lane) const {
+        return isParseError(codes[lane]) ? parseError : formatError(codes[lane]);
+    }
+
+    // Marks a lane as failed unless it already is
+    void set(size_t lane, MathError error) {
+        if (test(lane)) return;
+        codes[lane] = error;
+        ++failures;
+    }
+
+    // Fails every lane with the parse error of a program that did not compile
+    void setAll(const CompiledExpression& invalid) {
+        codes.assign(codes.size(), invalid.getErrorCode());
+        failures = codes.size();
+        parseError = invalid.getError();
+    }
+
+private:
+    std::vector<MathError> codes;
+    size_t failures = 0;
+    std::string parseError; // message shared by all lanes after setAll()
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include "CompiledExpression.hpp"
+
+// State of one evaluation (MathEngine::evaluate and the calculus operators).
+// It lives on the caller's stack, so nested evaluations and evaluations on
+// other threads never see each other's state. Failing only stores an error
+// id: nothing is allocated until the message is asked for.
+class EvalContext {
+public:
+    bool failed() const { return error != MathError::None; }
+    MathError getErrorCode() const { return error; }
+
+    // A parse error is formatted from its program, which has to outlive this call
+    std::string getError() const { return program ? program->getError() : formatError(error); }
+
+    // Record an error unless one is already set; evaluation stops at the
+    // first failing node, so that is the one reported
+    void fail(MathError code) {
+        if (error == MathError::None) error = code;
+    }
+    // Evaluation of a program that did not compile
+    void fail(const CompiledExpression& invalid) {
+        if (error != MathError::None) return;
+        error = invalid.getErrorCode();
+        program = &invalid;
+    }
+
+private:
+    MathError error = MathError::None;
+    const CompiledExpression* program = nullptr;
+};
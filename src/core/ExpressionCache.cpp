@@ -0,0 +1,71 @@
+#include "ExpressionCache.hpp"
+#include <cctype>
+
+namespace {
+
+bool isWordCharacter(unsigned char c) {
+    return std::isalnum(c) || c == '.';
+}
+
+} // namespace
+
+ExpressionCache::ExpressionCache(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+const CompiledExpression* ExpressionCache::find(const std::string& key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++misses;
+        return nullptr;
+    }
+    ++hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+}
+
+const CompiledExpression& ExpressionCache::insert(const std::string& key, CompiledExpression expression) {
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->second = std::move(expression);
+        entries.splice(entries.begin(), entries, it->second);
+        return entries.front().second;
+    }
+
+    entries.emplace_front(key, std::move(expression));
+    index.emplace(entries.front().first, entries.begin());
+    evictToCapacity();
+    return entries.front().second;
+}
+
+void ExpressionCache::clear() {
+    index.clear();
+    entries.clear();
+}
+
+void ExpressionCache::setCapacity(size_t newCapacity) {
+    capacity = newCapacity > 0 ? newCapacity : 1;
+    evictToCapacity();
+}
+
+void ExpressionCache::evictToCapacity() {
+    while (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void ExpressionCache::normalize(const std::string& expression, std::string& key) {
+    key.clear();
+    bool pendingSpace = false;
+    for (char c : expression) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (std::isspace(u)) {
+            pendingSpace = !key.empty();
+            continue;
+        }
+        if (pendingSpace && isWordCharacter(u) && isWordCharacter(static_cast<unsigned char>(key.back()))) {
+            key += ' ';
+        }
+        pendingSpace = false;
+        key += static_cast<char>(std::tolower(u));
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "CompiledExpression.hpp"
+
+// Bounded least-recently-used cache of compiled expressions.
+// Keys are normalized source strings (see normalize()), so expressions that
+// only differ in spacing or letter case share one entry.
+class ExpressionCache {
+public:
+    explicit ExpressionCache(size_t capacity = 64);
+
+    // Returns the cached program and marks it most recently used, or nullptr
+    const CompiledExpression* find(const std::string& key);
+    // Stores a program, evicting the least recently used entry when full
+    const CompiledExpression& insert(const std::string& key, CompiledExpression expression);
+
+    // Drops every entry for which predicate(const CompiledExpression&) is true
+    template <typename Predicate>
+    void invalidateIf(Predicate predicate) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (predicate(it->second)) {
+                index.erase(it->first);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    void clear();
+
+    void setCapacity(size_t capacity);
+    size_t getCapacity() const { return capacity; }
+    size_t size() const { return entries.size(); }
+
+    size_t getHits() const { return hits; }
+    size_t getMisses() const { return misses; }
+    void resetStatistics() { hits = misses = 0; }
+
+    // Removes insignificant whitespace and folds case into 'key'.
+    // A single space is kept between two characters of a number or name
+    // ("1 2" stays distinct from "12").
+    static void normalize(const std::string& expression, std::string& key);
+
+private:
+    using Entry = std::pair<std::string, CompiledExpression>;
+
+    size_t capacity;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // keys point into 'entries'
+
+    void evictToCapacity();
+};
@@ -0,0 +1,152 @@
+#include "ExpressionLexer.hpp"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+enum CharClass : std::uint8_t { Other, Space, Digit, Dot, Letter, Single };
+
+struct CharTable {
+    std::array<CharClass, 256> classes{};
+    std::array<TokenKind, 256> singles{}; // kind of one-character tokens
+};
+
+constexpr CharTable makeTable() {
+    CharTable table{};
+    for (int c = 0; c < 256; ++c) table.singles[c] = TokenKind::Unknown;
+    for (char c : {' ', '\t', '\n', '\v', '\f', '\r'}) table.classes[static_cast<unsigned char>(c)] = Space;
+    for (int c = '0'; c <= '9'; ++c) table.classes[c] = Digit;
+    for (int c = 'a'; c <= 'z'; ++c) table.classes[c] = Letter;
+    for (int c = 'A'; c <= 'Z'; ++c) table.classes[c] = Letter;
+    table.classes['.'] = Dot;
+
+    const std::pair<char, TokenKind> singles[] = {
+        {'+', TokenKind::Plus}, {'-', TokenKind::Minus}, {'*', TokenKind::Star},
+        {'/', TokenKind::Slash}, {'%', TokenKind::Percent}, {'^', TokenKind::Caret},
+        {',', TokenKind::Comma}, {'(', TokenKind::OpenParen}, {')', TokenKind::CloseParen},
+    };
+    for (const auto& single : singles) {
+        table.classes[static_cast<unsigned char>(single.first)] = Single;
+        table.singles[static_cast<unsigned char>(single.first)] = single.second;
+    }
+    return table;
+}
+
+constexpr CharTable Table = makeTable();
+
+CharClass classOf(char c) {
+    return Table.classes[static_cast<unsigned char>(c)];
+}
+
+// Integer literals up to this many digits are below 2^53
+constexpr size_t MaxShortInteger = 15;
+
+bool isDigits(const char* begin, const char* end) {
+    for (const char* p = begin; p < end; ++p) {
+        if (classOf(*p) != Digit) return false;
+    }
+    return true;
+}
+
+// Length of the number literal at 'begin': digits and dots, then an optional
+// exponent. 'e' only starts an exponent when digits follow, so "2e" stays
+// the number 2 followed by the name e.
+size_t scanNumber(const char* begin, const char* end, bool& negativeExponent) {
+    const char* p = begin;
+    while (p < end && (classOf(*p) == Digit || *p == '.')) ++p;
+
+    negativeExponent = false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* digits = p + 1;
+        if (digits < end && (*digits == '+' || *digits == '-')) ++digits;
+        if (digits < end && classOf(*digits) == Digit) {
+            negativeExponent = p[1] == '-';
+            p = digits;
+            while (p < end && classOf(*p) == Digit) ++p;
+        }
+    }
+    return static_cast<size_t>(p - begin);
+}
+
+} // namespace
+
+namespace ExpressionLexer {
+
+void tokenize(std::string_view source, TokenList& out) {
+    out.tokens.clear();
+    out.numbers.clear();
+
+    const char* const begin = source.data();
+    const char* const end = begin + source.size();
+    const char* p = begin;
+
+    while (p < end) {
+        Token token{};
+        token.start = static_cast<std::uint32_t>(p - begin);
+        token.length = 1;
+
+        switch (classOf(*p)) {
+            case Space:
+                ++p;
+                continue;
+
+            case Digit:
+            case Dot: {
+                bool negativeExponent = false;
+                size_t length = scanNumber(p, end, negativeExponent);
+                double value = 0.0;
+                if (length <= MaxShortInteger && isDigits(p, p + length)) {
+                    // Keypad integers are exact in a double; no need for from_chars
+                    for (const char* q = p; q < p + length; ++q) value = value * 10.0 + (*q - '0');
+                    token.kind = TokenKind::Number;
+                    token.length = static_cast<std::uint32_t>(length);
+                    token.number = static_cast<std::uint32_t>(out.numbers.size());
+                    out.numbers.push_back(value);
+                    break;
+                }
+                auto [stop, status] = std::from_chars(p, p + length, value);
+                if (status == std::errc::result_out_of_range) {
+                    // from_chars leaves the value alone; saturate like strtod
+                    value = negativeExponent ? 0.0 : HUGE_VAL;
+                    status = std::errc();
+                }
+                token.length = static_cast<std::uint32_t>(length);
+                if (status == std::errc() && stop == p + length) {
+                    token.kind = TokenKind::Number;
+                    token.number = static_cast<std::uint32_t>(out.numbers.size());
+                    out.numbers.push_back(value);
+                } else {
+                    token.kind = TokenKind::BadNumber;
+                }
+                break;
+            }
+
+            case Letter: {
+                const char* q = p + 1;
+                while (q < end && classOf(*q) == Letter) ++q;
+                token.kind = TokenKind::Identifier;
+                token.length = static_cast<std::uint32_t>(q - p);
+                break;
+            }
+
+            case Single:
+                token.kind = Table.singles[static_cast<unsigned char>(*p)];
+                break;
+
+            default:
+                token.kind = TokenKind::Unknown;
+                break;
+        }
+        out.tokens.push_back(token);
+        p += token.length;
+    }
+
+    Token endToken{};
+    endToken.kind = TokenKind::End;
+    endToken.start = static_cast<std::uint32_t>(source.size());
+    out.tokens.push_back(endToken);
+}
+
+} // namespace ExpressionLexer
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Splits an expression into tokens in a single pass. Characters are
+// classified through a lookup table and numbers are converted with
+// std::from_chars, so the result does not depend on the C locale.
+//
+// Every character of the source ends up in some token (whitespace aside):
+// characters outside the grammar become Unknown tokens and literals that are
+// not valid numbers become BadNumber tokens, leaving the decision of how to
+// report them to the consumer. The list always ends with an End token.
+enum class TokenKind : std::uint8_t {
+    Number,         // 12, .5, 3., 1e-9
+    Identifier,     // run of letters: function, constant, definition or x
+    Plus,
+    Minus,
+    Star,
+    Slash,
+    Percent,
+    Caret,
+    Comma,
+    OpenParen,
+    CloseParen,
+    Unknown,        // a single character outside the grammar
+    BadNumber,      // digits and dots that do not form a number, e.g. 1.2.3
+    End             // zero length, at the end of the source
+};
+
+struct Token {
+    TokenKind kind;
+    std::uint32_t start;    // offset into the source
+    std::uint32_t length;
+    std::uint32_t number;   // Number: index into TokenList::numbers
+};
+
+// Reusable output of ExpressionLexer::tokenize(); keeps its capacity
+struct TokenList {
+    std::vector<Token> tokens;
+    std::vector<double> numbers;
+
+    double value(const Token& token) const { return numbers[token.number]; }
+};
+
+namespace ExpressionLexer {
+
+// Replaces the contents of 'out' with the tokens of 'source'
+void tokenize(std::string_view source, TokenList& out);
+
+} // namespace ExpressionLexer
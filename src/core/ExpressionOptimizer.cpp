@@ -0,0 +1,347 @@
+#include "ExpressionOptimizer.hpp"
+#include "Builtins.hpp"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// True if 1/value is exactly representable, i.e. value is a power of two
+// whose reciprocal is a normal number
+bool hasExactReciprocal(double value) {
+    int exponent = 0;
+    double mantissa = std::frexp(value, &exponent);
+    if (mantissa != 0.5 && mantissa != -0.5) return false;
+    double reciprocal = 1.0 / value;
+    return std::isnormal(reciprocal);
+}
+
+} // namespace
+
+void ExpressionOptimizer::optimize(CompiledExpression& program) {
+    // Calculus nodes with identical bodies refer to the first one, so they can be shared too
+    program.deduplicated = 0;
+    std::vector<std::uint32_t> bodyRemap(program.bodies.size());
+    for (std::uint32_t i = 0; i < program.bodies.size(); ++i) {
+        optimize(program.bodies[i]);
+        bodyRemap[i] = i;
+        for (std::uint32_t j = 0; j < i; ++j) {
+            if (bodyRemap[j] == j && sameProgram(program.bodies[i], program.bodies[j])) {
+                bodyRemap[i] = j;
+                break;
+            }
+        }
+        if (bodyRemap[i] == i) program.deduplicated += program.bodies[i].deduplicated;
+    }
+    if (program.nodes.empty()) return;
+
+    ExpressionOptimizer optimizer(program.nodes.size());
+    std::vector<std::uint32_t> remap(program.nodes.size());
+    for (size_t i = 0; i < program.nodes.size(); ++i) {
+        ExpressionNode node = program.nodes[i];
+        node.lhs = remap[node.lhs];
+        node.rhs = remap[node.rhs];
+        node.third = remap[node.third];
+        if (node.op >= OpCode::Derivative) node.body = bodyRemap[node.body];
+        remap[i] = optimizer.emit(node);
+    }
+    optimizer.removeDeadNodes(remap.back());
+    program.nodes = std::move(optimizer.output);
+    program.deduplicated += optimizer.deduplicated;
+    markInvariant(program.nodes);
+}
+
+void ExpressionOptimizer::markInvariant(std::vector<ExpressionNode>& nodes) {
+    // Operands come first, and calculus nodes see x only through theirs;
+    // named variables are fixed for a batch
+    for (ExpressionNode& node : nodes) {
+        const int operands = operandCount(node);
+        node.invariant = node.op != OpCode::VariableX &&
+                         (operands < 1 || nodes[node.lhs].invariant) &&
+                         (operands < 2 || nodes[node.rhs].invariant) &&
+                         (operands < 3 || nodes[node.third].invariant);
+    }
+}
+
+ExpressionOptimizer::ExpressionOptimizer(size_t capacity) {
+    output.reserve(capacity);
+    shared.reserve(capacity);
+}
+
+int ExpressionOptimizer::operandCount(const ExpressionNode& node) {
+    switch (node.op) {
+        case OpCode::Constant:
+        case OpCode::VariableX:
+        case OpCode::Variable:
+            return 0;
+        case OpCode::Negate:
+        case OpCode::Reciprocal:
+        case OpCode::Derivative:
+        case OpCode::Limit:
+            return 1;
+        case OpCode::Ode:
+            return 3;
+        case OpCode::Function:
+            return Builtins::get(node.function).arity;
+        default:
+            return 2;
+    }
+}
+
+size_t ExpressionOptimizer::NodeHash::operator()(const ExpressionNode& node) const {
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &node.value, sizeof(bits));
+    std::uint64_t h = static_cast<std::uint64_t>(node.op) | static_cast<std::uint64_t>(node.function) << 8 |
+                      static_cast<std::uint64_t>(node.variable) << 16;
+    for (std::uint64_t field : { std::uint64_t(node.lhs), std::uint64_t(node.rhs),
+                                 std::uint64_t(node.body) | std::uint64_t(node.third) << 32, bits }) {
+        h = (h ^ field) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 29;
+    }
+    return static_cast<size_t>(h);
+}
+
+bool ExpressionOptimizer::NodeEqual::operator()(const ExpressionNode& a, const ExpressionNode& b) const {
+    // Constants compare by bit pattern, so 0 and -0 stay distinct
+    return a.op == b.op && a.function == b.function && a.variable == b.variable && a.lhs == b.lhs &&
+           a.rhs == b.rhs && a.body == b.body && a.third == b.third &&
+           std::memcmp(&a.value, &b.value, sizeof(double)) == 0;
+}
+
+bool ExpressionOptimizer::sameProgram(const CompiledExpression& a, const CompiledExpression& b) {
+    if (a.nodes.size() != b.nodes.size() || a.bodies.size() != b.bodies.size()) return false;
+    NodeEqual equal;
+    for (size_t i = 0; i < a.nodes.size(); ++i) {
+        if (!equal(a.nodes[i], b.nodes[i])) return false;
+    }
+    for (size_t i = 0; i < a.bodies.size(); ++i) {
+        if (!sameProgram(a.bodies[i], b.bodies[i])) return false;
+    }
+    return true;
+}
+
+std::uint32_t ExpressionOptimizer::emitRaw(ExpressionNode node) {
+    // Clear the fields the operation does not use, so equal nodes hash alike
+    int operands = operandCount(node);
+    if (operands < 1) node.lhs = 0;
+    if (operands < 2) node.rhs = 0;
+    if (operands < 3) node.third = 0;
+    if (node.op != OpCode::Constant) node.value = 0.0;
+    if (node.op != OpCode::Function) node.function = FunctionId{};
+    if (node.op != OpCode::Variable && node.op != OpCode::Ode) node.variable = 0;
+    if (node.op < OpCode::Derivative) node.body = 0;
+
+    bool pure = node.op != OpCode::Function || (Builtins::get(node.function).flags & Builtins::Pure);
+    if (pure) {
+        auto found = shared.find(node);
+        if (found != shared.end()) {
+            if (operandCount(node) > 0) ++deduplicated;
+            return found->second;
+        }
+    }
+
+    output.push_back(node);
+    std::uint32_t index = static_cast<std::uint32_t>(output.size() - 1);
+    if (pure) shared.emplace(node, index);
+    return index;
+}
+
+std::uint32_t ExpressionOptimizer::emitConstant(double value) {
+    ExpressionNode node{};
+    node.op = OpCode::Constant;
+    node.value = value;
+    return emitRaw(node);
+}
+
+std::uint32_t ExpressionOptimizer::emitBinary(OpCode op, std::uint32_t lhs, std::uint32_t rhs) {
+    ExpressionNode node{};
+    node.op = op;
+    node.lhs = lhs;
+    node.rhs = rhs;
+    return emit(node);
+}
+
+bool ExpressionOptimizer::fold(const ExpressionNode& node, double& result) const {
+    double a = output[node.lhs].value;
+    double b = output[node.rhs].value;
+    double c = output[node.third].value;
+    switch (node.op) {
+        case OpCode::Add:        result = a + b; return true;
+        case OpCode::Subtract:   result = a - b; return true;
+        case OpCode::Multiply:   result = a * b; return true;
+        case OpCode::Negate:     result = -a; return true;
+        case OpCode::Reciprocal: result = 1.0 / a; return true;
+        case OpCode::Power:      result = std::pow(a, b); return true;
+        case OpCode::Divide:
+            if (b == 0.0) return false;
+            result = a / b;
+            return true;
+        case OpCode::Modulo:
+            if (b == 0.0) return false;
+            result = std::fmod(a, b);
+            return true;
+        case OpCode::Function: {
+            const Builtins::Info& builtin = Builtins::get(node.function);
+            if (!(builtin.flags & Builtins::Pure)) return false;
+            if (builtin.domain && builtin.domain(a, b, c) != MathError::None) return false; // keep the error for run time
+            result = builtin.function(a, b, c);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+std::uint32_t ExpressionOptimizer::emit(ExpressionNode node) {
+    switch (node.op) {
+        case OpCode::Constant:
+        case OpCode::VariableX:
+        case OpCode::Variable:
+        case OpCode::Derivative:
+        case OpCode::Integral:
+        case OpCode::Limit:
+        case OpCode::Summation:
+        case OpCode::Solve:
+        case OpCode::Ode:
+            return emitRaw(node);
+        default:
+            break;
+    }
+
+    const int operands = operandCount(node);
+    if (isConstant(node.lhs) && (operands < 2 || isConstant(node.rhs)) && (operands < 3 || isConstant(node.third))) {
+        double value = 0.0;
+        if (fold(node, value)) return emitConstant(value);
+        return emitRaw(node);
+    }
+
+    // Commutative operands in a canonical order (constants last), so a*b and b*a are shared
+    if (node.op == OpCode::Add || node.op == OpCode::Multiply) {
+        if (isConstant(node.lhs) || (!isConstant(node.rhs) && node.lhs > node.rhs)) {
+            std::swap(node.lhs, node.rhs);
+        }
+    }
+
+    switch (node.op) {
+        case OpCode::Negate:
+            if (output[node.lhs].op == OpCode::Negate) return output[node.lhs].lhs;
+            break;
+
+        case OpCode::Multiply: {
+            // Merge constant factors: (y*c1)*c2 -> y*(c1*c2)
+            if (!isConstant(node.rhs)) break;
+            double factor = output[node.rhs].value;
+            if (factor == 1.0) return node.lhs;
+
+            ExpressionNode inner = output[node.lhs]; // copy, emitting may reallocate
+            if (inner.op == OpCode::Multiply && isConstant(inner.rhs)) {
+                const double merged = output[inner.rhs].value * factor;
+                if (std::isnormal(merged)) return emitBinary(OpCode::Multiply, inner.lhs, emitConstant(merged));
+            }
+            break;
+        }
+
+        case OpCode::Divide: {
+            if (!isConstant(node.rhs)) break;
+            double divisor = output[node.rhs].value;
+            if (divisor == 0.0) break; // leave the division by zero error to run time
+            if (divisor == 1.0) return node.lhs;
+
+            // Merge into a constant factor like Multiply does: (y*c1)/c2 ->
+            // y*(c1/c2), unless c1/c2 overflows or underflows where the
+            // original need not
+            ExpressionNode inner = output[node.lhs]; // copy, emitting may reallocate
+            if (inner.op == OpCode::Multiply && isConstant(inner.rhs)) {
+                const double factor = output[inner.rhs].value / divisor;
+                if (std::isnormal(factor)) return emitBinary(OpCode::Multiply, inner.lhs, emitConstant(factor));
+            }
+            if (hasExactReciprocal(divisor)) {
+                return emitBinary(OpCode::Multiply, node.lhs, emitConstant(1.0 / divisor));
+            }
+            break;
+        }
+
+        case OpCode::Power:
+            if (isConstant(node.rhs)) return reducePower(node.lhs, output[node.rhs].value);
+            break;
+
+        default:
+            break;
+    }
+    return emitRaw(node);
+}
+
+std::uint32_t ExpressionOptimizer::reducePower(std::uint32_t base, double exponent) {
+    ExpressionNode node{};
+    // pow(x, 0) is 1 even for NaN, but a base that can fail must still run
+    if (exponent == 0.0 && cannotFail(base)) return emitConstant(1.0);
+    if (exponent == 0.0) {
+        node.op = OpCode::Power;
+        node.lhs = base;
+        node.rhs = emitConstant(0.0);
+        return emitRaw(node);
+    }
+    if (exponent == 1.0) return base;
+    if (exponent == 2.0) return emitBinary(OpCode::Multiply, base, base);
+    if (exponent == 3.0) return emitBinary(OpCode::Multiply, emitBinary(OpCode::Multiply, base, base), base);
+    if (exponent == -1.0) {
+        node.op = OpCode::Reciprocal;
+        node.lhs = base;
+        return emitRaw(node);
+    }
+    if (exponent == 0.5) {
+        node.op = OpCode::Function;
+        node.function = FunctionId::Sqrt;
+        node.lhs = base;
+        return emitRaw(node);
+    }
+
+    node.op = OpCode::Power;
+    node.lhs = base;
+    node.rhs = emitConstant(exponent);
+    return emitRaw(node);
+}
+
+bool ExpressionOptimizer::cannotFail(std::uint32_t index) const {
+    const ExpressionNode& node = output[index];
+    switch (node.op) {
+        case OpCode::Constant:
+        case OpCode::VariableX:
+            return true;
+        case OpCode::Add:
+        case OpCode::Subtract:
+        case OpCode::Multiply:
+            return cannotFail(node.lhs) && cannotFail(node.rhs);
+        case OpCode::Negate:
+        case OpCode::Reciprocal:
+            return cannotFail(node.lhs);
+        default:
+            return false; // named variables may be missing, the rest may hit a domain error
+    }
+}
+
+void ExpressionOptimizer::removeDeadNodes(std::uint32_t root) {
+    std::vector<bool> live(output.size(), false);
+    live[root] = true;
+    for (size_t i = root + 1; i-- > 0;) {
+        if (!live[i]) continue;
+        const ExpressionNode& node = output[i];
+        int operands = operandCount(node);
+        if (operands > 0) live[node.lhs] = true;
+        if (operands > 1) live[node.rhs] = true;
+        if (operands > 2) live[node.third] = true;
+    }
+
+    std::vector<std::uint32_t> remap(output.size());
+    std::vector<ExpressionNode> compacted;
+    compacted.reserve(output.size());
+    for (size_t i = 0; i <= root; ++i) {
+        if (!live[i]) continue;
+        ExpressionNode node = output[i];
+        node.lhs = remap[node.lhs];
+        node.rhs = remap[node.rhs];
+        node.third = remap[node.third];
+        remap[i] = static_cast<std::uint32_t>(compacted.size());
+        compacted.push_back(node);
+    }
+    output = std::move(compacted);
+}
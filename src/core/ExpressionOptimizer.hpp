@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+// Rewrites a freshly parsed program into a cheaper equivalent one:
+// - folds subtrees whose operands are all constants (unless folding would
+//   hide a domain error, which is then left for run time)
+// - reassociates constant factors in product chains, so sin(x)*2*pi/180
+//   becomes a single multiplication
+// - replaces x^0, x^1, x^2, x^3, x^-1 and x^0.5 by cheaper operations;
+//   x^0 becomes 1 only where x cannot fail (built from x, constants, +, -,
+//   *, negation and x^-1), so sqrt(-1)^0 still reports its domain error
+// - turns division by a power of two into multiplication by its (exact)
+//   reciprocal
+// - shares structurally identical pure subexpressions (including identical
+//   calculus bodies), so sin(x)^2 + sin(x)*cos(x) computes sin(x) once
+// - drops nodes that no longer contribute to the result
+// - marks the nodes that do not depend on x (ExpressionNode::invariant), such
+//   as int(exp(-x^2), 0, 3) in x * int(exp(-x^2), 0, 3), whose body binds its
+//   own x; batch evaluation computes them once per batch
+// What changes:
+// - merging constant factors (also divisors: (y*c1)/c2 -> y*(c1/c2)) rounds
+//   differently and can move where an intermediate overflows; merged
+//   factors that would overflow or underflow are left apart
+// - x^3 rounds twice and may differ from pow in the last bit; x^2 and x^-1
+//   round once, like pow does on libms that round it correctly
+// - x^0.5 reports the sqrt domain error for negative x instead of giving NaN
+// No rewrite drops an error the unoptimized program would report. Folding
+// and division by powers of two are exact.
+class ExpressionOptimizer {
+public:
+    static void optimize(CompiledExpression& program);
+
+    // Operands of a node that refer to other nodes (lhs, rhs, third in that order)
+    static int operandCount(const ExpressionNode& node);
+
+private:
+    struct NodeHash {
+        size_t operator()(const ExpressionNode& node) const;
+    };
+    struct NodeEqual {
+        bool operator()(const ExpressionNode& a, const ExpressionNode& b) const;
+    };
+
+    explicit ExpressionOptimizer(size_t capacity);
+
+    std::vector<ExpressionNode> output;
+    std::unordered_map<ExpressionNode, std::uint32_t, NodeHash, NodeEqual> shared; // node -> index in output
+    size_t deduplicated = 0;
+
+    std::uint32_t emit(ExpressionNode node);
+    std::uint32_t emitRaw(ExpressionNode node);
+    std::uint32_t emitConstant(double value);
+    std::uint32_t emitBinary(OpCode op, std::uint32_t lhs, std::uint32_t rhs);
+
+    bool isConstant(std::uint32_t index) const { return output[index].op == OpCode::Constant; }
+    bool isConstant(std::uint32_t index, double value) const {
+        return isConstant(index) && output[index].value == value;
+    }
+    bool fold(const ExpressionNode& node, double& result) const;
+    std::uint32_t reducePower(std::uint32_t base, double exponent);
+    bool cannotFail(std::uint32_t index) const;
+
+    void removeDeadNodes(std::uint32_t root);
+    static void markInvariant(std::vector<ExpressionNode>& nodes);
+
+    static bool sameProgram(const CompiledExpression& a, const CompiledExpression& b);
+};
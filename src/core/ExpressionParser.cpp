@@ -0,0 +1,366 @@
+#include "ExpressionParser.hpp"
+#include <cctype>
+#include <limits>
+#include <string>
+
+namespace {
+
+bool equalsIgnoreCase(std::string_view text, std::string_view lowerName) {
+    if (text.size() != lowerName.size()) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != lowerName[i]) return false;
+    }
+    return true;
+}
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double E = 2.71828182845904523536;
+
+} // namespace
+
+ExpressionParser::ExpressionParser(std::string_view source, AngleMode angleMode,
+                                   const std::map<std::string, double>* definitions,
+                                   const std::vector<std::string>* variables)
+    : source(source), current(0), angleMode(angleMode), definitions(definitions), variables(variables),
+      odeBodies(0) {}
+
+bool ExpressionParser::parse(CompiledExpression& out) {
+    targets.assign(1, &out);
+    ExpressionLexer::tokenize(source, tokens);
+    current = 0;
+    bool expectOperand = true;
+
+    while (token().kind != TokenKind::End) {
+        const TokenKind kind = token().kind;
+        if (expectOperand) {
+            switch (kind) {
+                case TokenKind::Number: {
+                    ExpressionNode node{};
+                    node.op = OpCode::Constant;
+                    node.value = tokens.value(token());
+                    pushOperand(node);
+                    ++current;
+                    expectOperand = false;
+                    break;
+                }
+                case TokenKind::Identifier: {
+                    bool opened = false;
+                    if (!parseIdentifier(opened)) return false;
+                    expectOperand = opened;
+                    break;
+                }
+                case TokenKind::OpenParen:
+                    openGroup(GroupKind::Paren, nullptr);
+                    ++current;
+                    break;
+                case TokenKind::Minus:
+                    pushOperator(Operator::Negate);
+                    ++current;
+                    break;
+                case TokenKind::Plus:
+                    ++current; // Unary plus changes nothing
+                    break;
+                case TokenKind::BadNumber:
+                    return fail(MathError::InvalidNumber);
+                case TokenKind::CloseParen:
+                case TokenKind::Comma:
+                    return fail(MathError::MissingOperand);
+                default:
+                    return fail(MathError::UnexpectedCharacter);
+            }
+        } else {
+            bool ok = true;
+            switch (kind) {
+                case TokenKind::Plus:       ok = pushOperator(Operator::Add); break;
+                case TokenKind::Minus:      ok = pushOperator(Operator::Subtract); break;
+                case TokenKind::Star:       ok = pushOperator(Operator::Multiply); break;
+                case TokenKind::Slash:      ok = pushOperator(Operator::Divide); break;
+                case TokenKind::Percent:    ok = pushOperator(Operator::Modulo); break;
+                case TokenKind::Caret:      ok = pushOperator(Operator::Power); break;
+                case TokenKind::Comma:      ok = closeArgument(); break;
+                case TokenKind::CloseParen: ok = closeGroup(); break;
+                default:                    return fail(MathError::UnexpectedCharacter);
+            }
+            if (!ok) return false;
+            ++current;
+            expectOperand = (kind != TokenKind::CloseParen);
+        }
+    }
+
+    if (expectOperand) {
+        return fail(out.nodes.empty() && operators.empty() ? MathError::EmptyExpression
+                                                           : MathError::UnexpectedEnd);
+    }
+
+    while (!operators.empty()) {
+        if (operators.back() == Operator::Group) return fail(MathError::ExpectedCloseParen);
+        if (!reduce(operators.back())) return false;
+        operators.pop_back();
+    }
+    return true;
+}
+
+bool ExpressionParser::fail(MathError error, size_t at) {
+    CompiledExpression& program = *targets.front();
+    program.error = error;
+    program.errorPosition = static_cast<std::uint32_t>(at);
+    return false;
+}
+
+bool ExpressionParser::parseIdentifier(bool& opened) {
+    const size_t start = token().start;
+    std::string_view name = source.substr(start, token().length);
+    ++current;
+
+    ExpressionNode node{};
+    const bool bound = targets.size() > 1 || !variables;
+    if (bound && equalsIgnoreCase(name, "x")) {
+        node.op = OpCode::VariableX;
+        pushOperand(node);
+        return true;
+    }
+    if (odeBodies > 0 && token().kind != TokenKind::OpenParen && equalsIgnoreCase(name, "y")) {
+        // The state of an ode() is no outer variable, so gradients are not affected
+        node.op = OpCode::Variable;
+        node.variable = stateSlot(odeBodies - 1);
+        pushOperand(node);
+        return true;
+    }
+    if (token().kind != TokenKind::OpenParen && variables && findVariable(name, node.variable)) {
+        node.op = OpCode::Variable;
+        target().usesVariables = true;
+        pushOperand(node);
+        return true;
+    }
+
+    if (token().kind != TokenKind::OpenParen) {
+        // Constants
+        node.op = OpCode::Constant;
+        if (equalsIgnoreCase(name, "pi")) node.value = PI;
+        else if (equalsIgnoreCase(name, "e")) node.value = E;
+        else if (equalsIgnoreCase(name, "inf")) node.value = std::numeric_limits<double>::infinity();
+        else if (const double* value = findDefinition(name)) {
+            node.value = *value;
+            target().usesDefinitions = true;
+        }
+        else return fail(MathError::ExpectedOpenParen, start);
+        pushOperand(node);
+        return true;
+    }
+
+    // Names are resolved to a registry entry once, here
+    const Builtins::Info* builtin = Builtins::find(name);
+    if (!builtin) return fail(MathError::UnknownFunction, start);
+
+    openGroup((builtin->flags & Builtins::Calculus) ? GroupKind::Calculus : GroupKind::Function, builtin);
+    ++current; // Skip '('
+    opened = true;
+    return true;
+}
+
+const double* ExpressionParser::findDefinition(std::string_view name) const {
+    if (!definitions) return nullptr;
+    std::string key(name);
+    for (char& c : key) c = Builtins::foldCase(c);
+    auto it = definitions->find(key);
+    return it != definitions->end() ? &it->second : nullptr;
+}
+
+std::uint16_t ExpressionParser::stateSlot(std::uint16_t depth) const {
+    return static_cast<std::uint16_t>((variables ? variables->size() : 0) + depth);
+}
+
+bool ExpressionParser::findVariable(std::string_view name, std::uint16_t& index) const {
+    for (size_t i = 0; i < variables->size(); ++i) {
+        if (equalsIgnoreCase(name, (*variables)[i])) {
+            index = static_cast<std::uint16_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ExpressionParser::openGroup(GroupKind kind, const Builtins::Info* builtin) {
+    Group group{};
+    group.kind = kind;
+    group.builtin = builtin;
+    group.operandBase = operands.size();
+    group.bodyStart = token().start + 1; // just past the '('
+    groups.push_back(group);
+    operators.push_back(Operator::Group);
+
+    if (kind == GroupKind::Calculus) {
+        // The first argument of a calculus operator is compiled into its own program
+        pendingBodies.emplace_back();
+        targets.push_back(&pendingBodies.back());
+        if (builtin->op == OpCode::Ode) ++odeBodies;
+    }
+}
+
+bool ExpressionParser::closeArgument() {
+    if (!reduceUntilGroup()) return false;
+    if (groups.empty() || groups.back().kind == GroupKind::Paren) return fail(MathError::UnexpectedComma);
+
+    Group& group = groups.back();
+    if (operands.size() != group.operandBase + 1) return fail(MathError::MissingArgument);
+    if (group.args + 1 >= group.builtin->arity) return fail(MathError::TooManyArguments);
+
+    if (group.kind == GroupKind::Calculus && group.args == 0) {
+        // Body finished: hand it to the enclosing program
+        operands.pop_back();
+        CompiledExpression& body = pendingBodies.back();
+        body.source = std::string(source.substr(group.bodyStart, token().start - group.bodyStart));
+        targets.pop_back();
+        target().usesAngles |= body.usesAngles;
+        target().usesDefinitions |= body.usesDefinitions;
+        target().usesVariables |= body.usesVariables;
+        target().bodies.push_back(std::move(body));
+        pendingBodies.pop_back();
+        if (group.builtin->op == OpCode::Ode) --odeBodies;
+    } else {
+        group.values[group.valueCount++] = operands.back();
+        operands.pop_back();
+    }
+    ++group.args;
+    return true;
+}
+
+bool ExpressionParser::closeGroup() {
+    if (!reduceUntilGroup()) return false;
+    if (groups.empty()) return fail(MathError::UnexpectedCloseParen);
+
+    // The group holds exactly its last argument from here on
+    Group group = groups.back();
+    if (operands.size() != group.operandBase + 1) return fail(MathError::MissingOperand);
+
+    groups.pop_back();
+    operators.pop_back(); // Operator::Group
+
+    if (group.kind == GroupKind::Paren) return true;
+
+    const std::uint8_t flags = group.builtin->flags;
+    const bool omittedLast = (flags & Builtins::OptionalLast) && group.args + 2 == group.builtin->arity;
+    if (group.args + 1 < group.builtin->arity && !omittedLast) return fail(MathError::ExpectedComma);
+
+    const bool degrees = angleMode == AngleMode::Degrees;
+    if (flags & (Builtins::AngleArgument | Builtins::AngleResult)) {
+        target().usesAngles = true;
+    }
+
+    group.values[group.valueCount++] = operands.back();
+    operands.pop_back();
+    if (omittedLast) {
+        ExpressionNode zero{};
+        zero.op = OpCode::Constant;
+        group.values[group.valueCount++] = target().emit(zero);
+    }
+
+    // diff/lim take only the point as a value; the body is not one
+    ExpressionNode node{};
+    node.op = group.builtin->op;
+    node.function = group.builtin->id;
+    node.lhs = group.values[0];
+    if (group.valueCount > 1) node.rhs = group.values[1];
+    if (group.valueCount > 2) node.third = group.values[2];
+    if (group.builtin->arity == 1 && (flags & Builtins::AngleArgument) && degrees) {
+        node.lhs = emitScaled(node.lhs, PI / 180.0);
+    }
+    if (group.kind == GroupKind::Calculus) {
+        node.body = static_cast<std::uint32_t>(target().bodies.size() - 1);
+    }
+    if (node.op == OpCode::Ode) node.variable = stateSlot(odeBodies);
+
+    if ((flags & Builtins::AngleResult) && degrees) {
+        operands.push_back(emitScaled(target().emit(node), 180.0 / PI));
+    } else {
+        pushOperand(node);
+    }
+    return true;
+}
+
+bool ExpressionParser::pushOperator(Operator op) {
+    if (op != Operator::Negate) {
+        // Prefix operators never complete anything; binary ones reduce their left side first
+        while (!operators.empty() && operators.back() != Operator::Group) {
+            Operator top = operators.back();
+            if (precedence(top) < precedence(op)) break;
+            if (precedence(top) == precedence(op) && isRightAssociative(op)) break;
+            if (!reduce(top)) return false;
+            operators.pop_back();
+        }
+    }
+    operators.push_back(op);
+    return true;
+}
+
+bool ExpressionParser::reduceUntilGroup() {
+    while (!operators.empty() && operators.back() != Operator::Group) {
+        if (!reduce(operators.back())) return false;
+        operators.pop_back();
+    }
+    return true;
+}
+
+bool ExpressionParser::reduce(Operator op) {
+    ExpressionNode node{};
+    if (op == Operator::Negate) {
+        node.op = OpCode::Negate;
+        if (!popOperand(node.lhs)) return false;
+        pushOperand(node);
+        return true;
+    }
+
+    if (!popOperand(node.rhs) || !popOperand(node.lhs)) return false;
+    switch (op) {
+        case Operator::Add:      node.op = OpCode::Add; break;
+        case Operator::Subtract: node.op = OpCode::Subtract; break;
+        case Operator::Multiply: node.op = OpCode::Multiply; break;
+        case Operator::Divide:   node.op = OpCode::Divide; break;
+        case Operator::Modulo:   node.op = OpCode::Modulo; break;
+        default:                 node.op = OpCode::Power; break;
+    }
+    pushOperand(node);
+    return true;
+}
+
+void ExpressionParser::pushOperand(const ExpressionNode& node) {
+    operands.push_back(target().emit(node));
+}
+
+std::uint32_t ExpressionParser::emitScaled(std::uint32_t operand, double factor) {
+    ExpressionNode constant{};
+    constant.op = OpCode::Constant;
+    constant.value = factor;
+
+    ExpressionNode product{};
+    product.op = OpCode::Multiply;
+    product.lhs = operand;
+    product.rhs = target().emit(constant);
+    return target().emit(product);
+}
+
+bool ExpressionParser::popOperand(std::uint32_t& index) {
+    if (operands.empty() || (!groups.empty() && operands.size() == groups.back().operandBase)) {
+        return fail(MathError::MissingOperand);
+    }
+    index = operands.back();
+    operands.pop_back();
+    return true;
+}
+
+int ExpressionParser::precedence(Operator op) {
+    switch (op) {
+        case Operator::Add:
+        case Operator::Subtract: return 1;
+        case Operator::Multiply:
+        case Operator::Divide:
+        case Operator::Modulo:   return 2;
+        case Operator::Negate:   return 3;
+        case Operator::Power:    return 4;
+        default:                 return 0;
+    }
+}
+
+bool ExpressionParser::isRightAssociative(Operator op) {
+    return op == Operator::Power;
+}
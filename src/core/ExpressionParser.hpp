@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdint>
+#include "CompiledExpression.hpp"
+#include "Builtins.hpp"
+#include "ExpressionLexer.hpp"
+
+// Single pass operator-precedence parser over the tokens of ExpressionLexer.
+// Keeps pending operators and open parentheses on explicit stacks instead of
+// the call stack, so parsing is linear in the input length and nesting depth
+// is only limited by available memory.
+//
+// Precedence, lowest to highest: + -, * / %, unary + -, ^ (right associative).
+// Angle conversions for the chosen AngleMode and user definitions are
+// resolved here, so the program does not depend on them at run time.
+// Given a list of variable names, the top-level expression reads those
+// instead of x. Calculus bodies have x as their own, bound variable, which
+// hides an outer x; the other names still refer to the outer variables.
+// Bodies of ode() bind y as well, to the variable slot past the outer ones
+// (one further per nested ode()), which the evaluator fills with the state.
+// Errors are reported through return values, not exceptions: parse() returns
+// false and leaves the MathError and its source offset in the program.
+class ExpressionParser {
+public:
+    // 'definitions' maps lower-case names to values and may be null, as may
+    // the lower-case 'variables'
+    ExpressionParser(std::string_view source, AngleMode angleMode = AngleMode::Degrees,
+                     const std::map<std::string, double>* definitions = nullptr,
+                     const std::vector<std::string>* variables = nullptr);
+
+    bool parse(CompiledExpression& out);
+
+private:
+    enum class Operator : std::uint8_t { Add, Subtract, Multiply, Divide, Modulo, Power, Negate, Group };
+
+    enum class GroupKind : std::uint8_t { Paren, Function, Calculus };
+
+    // An open '(' together with the state needed to close it
+    struct Group {
+        GroupKind kind;
+        const Builtins::Info* builtin;  // called function, nullptr for plain parentheses
+        std::uint32_t args;     // completed arguments so far
+        std::uint32_t values[3]; // operands of the completed value arguments
+        std::uint32_t valueCount;
+        size_t operandBase;     // operand stack height when the group opened
+        size_t bodyStart;       // calculus: source offset of the body
+    };
+
+    std::string_view source;
+    TokenList tokens;
+    size_t current;         // index of the token being looked at
+    AngleMode angleMode;
+    const std::map<std::string, double>* definitions;
+    const std::vector<std::string>* variables;
+    std::uint16_t odeBodies;        // ode() bodies being parsed; the innermost binds y
+
+    std::vector<Operator> operators;
+    std::vector<std::uint32_t> operands;
+    std::vector<Group> groups;
+
+    // Programs nodes are appended to; calculus bodies push a new target
+    std::vector<CompiledExpression*> targets;
+    std::deque<CompiledExpression> pendingBodies;
+
+    // The steps below return false once they have recorded an error with fail()
+    bool fail(MathError error) { return fail(error, token().start); }
+    bool fail(MathError error, size_t at);
+
+    const Token& token() const { return tokens.tokens[current]; }
+    bool parseIdentifier(bool& opened); // 'opened' is set if the name started a call
+    const double* findDefinition(std::string_view name) const;
+    bool findVariable(std::string_view name, std::uint16_t& index) const;
+    // Slot of the y of an ode() body nested in 'depth' others
+    std::uint16_t stateSlot(std::uint16_t depth) const;
+    void openGroup(GroupKind kind, const Builtins::Info* builtin);
+    bool closeArgument();
+    bool closeGroup();
+
+    bool pushOperator(Operator op);
+    bool reduce(Operator op);
+    bool reduceUntilGroup();
+    void pushOperand(const ExpressionNode& node);
+    std::uint32_t emitScaled(std::uint32_t operand, double factor);
+    bool popOperand(std::uint32_t& index);
+
+    CompiledExpression& target() { return *targets.back(); }
+
+    static int precedence(Operator op);
+    static bool isRightAssociative(Operator op);
+};
@@ -0,0 +1,198 @@
+#include "Extrapolation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double Infinity = std::numeric_limits<double>::infinity();
+
+// First step of lim(), before halving; points far from 0 get steps their
+// ulps can resolve
+constexpr double FirstStep = 0.125;
+// The Levin transform's binomial weights cancel more with every order;
+// past this one they drown the result
+constexpr size_t MaxLevinOrder = 40;
+
+struct Best {
+    Extrapolation::Result result;
+
+    void consider(double value, double error) {
+        if (std::isfinite(value) && error < result.error) {
+            result.value = value;
+            result.error = error;
+        }
+    }
+};
+
+// u-transform with beta = 1: the remainder after term n is taken to be
+// (n + 1) a_n times a smooth function of n, which the transform of order k
+// eliminates up to n^-k. The weights alternate and grow like binomials, so
+// the sums are taken relative to S_k and in extended precision.
+void levin(const double* terms, const double* sums, size_t count, Best& best) {
+    double previous[2] = { NaN, NaN };
+    const size_t orders = std::min(count, MaxLevinOrder + 1);
+    for (size_t k = 1; k < orders; k++) {
+        long double numerator = 0.0L, denominator = 0.0L, binomial = 1.0L, sign = 1.0L;
+        for (size_t j = 0; j <= k; j++) {
+            const long double remainder = static_cast<long double>(j + 1) * terms[j];
+            const long double weight = sign * binomial
+                * std::pow(static_cast<long double>(j + 1) / static_cast<long double>(k + 1), static_cast<long double>(k - 1))
+                / remainder;
+            numerator += weight * (static_cast<long double>(sums[j]) - sums[k]);
+            denominator += weight;
+            binomial = binomial * static_cast<long double>(k - j) / static_cast<long double>(j + 1);
+            sign = -sign;
+        }
+        const double estimate = static_cast<double>(sums[k] + numerator / denominator);
+        if (k >= 3) {
+            best.consider(estimate, std::max(std::abs(estimate - previous[1]), std::abs(previous[1] - previous[0])));
+        }
+        previous[0] = previous[1];
+        previous[1] = estimate;
+    }
+}
+
+// Epsilon table e(c, n) with e(-1, n) = 0, e(0, n) = values[n] and
+// e(c + 1, n) = e(c - 1, n + 1) + 1 / (e(c, n + 1) - e(c, n)); the even
+// columns are estimates of the limit, the last entry of each the best.
+// 'stride' steps through interleaved samples.
+void wynn(const double* values, size_t count, size_t stride, Best& best) {
+    double columns[3][Extrapolation::MaxTerms];    // c - 1, c, c + 1
+    double* before = columns[0];
+    double* current = columns[1];
+    double* next = columns[2];
+    std::fill(before, before + count, 0.0);
+    for (size_t n = 0; n < count; n++) current[n] = values[n * stride];
+    double lastEven = current[count - 1];
+    for (size_t c = 1; c < count; c++) {
+        const size_t length = count - c;
+        for (size_t n = 0; n < length; n++) next[n] = before[n + 1] + 1.0 / (current[n + 1] - current[n]);
+        if (c % 2 == 0) {
+            const double estimate = next[length - 1];
+            if (length >= 2) {
+                best.consider(estimate, std::max(std::abs(estimate - next[length - 2]), std::abs(estimate - lastEven)));
+            }
+            lastEven = estimate;
+        }
+        std::swap(before, current);
+        std::swap(current, next);
+    }
+}
+
+Extrapolation::Result richardson(const double* samples, size_t count, size_t width, double* out) {
+    // Rows k - 1 and k of the table; entry j of a row has j powers of h eliminated
+    double rows[2][Extrapolation::LimitSteps][Extrapolation::MaxWidth];
+    auto previous = rows[0];
+    auto current = rows[1];
+
+    Extrapolation::Result result;
+    result.value = NaN;
+    result.error = Infinity;
+    result.evaluations = count;
+    for (size_t k = 0; k < count; k++) {
+        std::copy(samples + k * width, samples + (k + 1) * width, current[0]);
+        if (k == 0) {
+            result.value = current[0][0];
+            std::copy(current[0], current[0] + width, out);
+        }
+        double power = 1.0;
+        for (size_t j = 1; j <= k; j++) {
+            power *= 2.0;
+            for (size_t i = 0; i < width; i++) {
+                current[j][i] = current[j - 1][i] + (current[j - 1][i] - previous[j - 1][i]) / (power - 1.0);
+            }
+            const double error = std::max(std::abs(current[j][0] - current[j - 1][0]),
+                                          std::abs(current[j][0] - previous[j - 1][0]));
+            if (error <= result.error) {
+                result.value = current[j][0];
+                result.error = error;
+                std::copy(current[j], current[j] + width, out);
+            }
+        }
+        // Rounding has taken over once the diagonal moves more than the best error
+        if (k > 0 && std::abs(current[k][0] - previous[k - 1][0]) >= 2.0 * result.error) break;
+        std::swap(previous, current);
+    }
+    return result;
+}
+
+bool converged(const Extrapolation::Result& result, double scale, const Extrapolation::Tolerance& tolerance) {
+    return std::isfinite(result.value)
+        && result.error <= std::max(tolerance.absolute, tolerance.relative * std::max(scale, std::abs(result.value)));
+}
+
+// Largest finite |values[i]| for i in [begin, end)
+double largest(const double* values, size_t begin, size_t end, size_t stride = 1) {
+    double result = 0.0;
+    for (size_t i = begin; i < end; i++) {
+        if (std::isfinite(values[i * stride])) result = std::max(result, std::abs(values[i * stride]));
+    }
+    return result;
+}
+
+} // namespace
+
+namespace Extrapolation {
+
+double limitPoint(double point, bool fromRight, size_t k) {
+    if (std::isinf(point)) return std::ldexp(point > 0.0 ? 1.0 : -1.0, 3 + static_cast<int>(k));
+    const double step = std::ldexp(FirstStep * std::max(1.0, std::abs(point) * 1e-6), -static_cast<int>(k));
+    return fromRight ? point + step : point - step;
+}
+
+Result limit(const double* samples, size_t count, size_t width, double* out, const Tolerance& tolerance) {
+    count = std::min(count, LimitSteps);
+    width = std::min(width, MaxWidth);
+    std::fill(out, out + width, NaN);
+    if (count == 0) return Result();
+
+    const double scale = largest(samples, 0, count, width);
+    Result result = richardson(samples, count, width, out);
+    result.converged = converged(result, scale, tolerance);
+    if (result.converged || count < 3) return result;
+
+    Best best;
+    best.result.value = samples[(count - 1) * width];
+    best.result.error = Infinity;
+    best.result.evaluations = count;
+    wynn(samples, count, width, best);
+    best.result.converged = converged(best.result, scale, tolerance);
+    if (!best.result.converged) return result;
+    out[0] = best.result.value;
+    for (size_t i = 1; i < width; i++) {
+        Best coefficient;
+        coefficient.result.value = NaN;
+        coefficient.result.error = Infinity;
+        wynn(samples + i, count, width, coefficient);
+        out[i] = coefficient.result.value;
+    }
+    return best.result;
+}
+
+Result series(const double* terms, const double* partialSums, size_t count, const Tolerance& tolerance) {
+    Best best;
+    best.result.value = count > 0 ? partialSums[count - 1] : 0.0;
+    best.result.error = count > 1 ? std::abs(terms[count - 1]) : Infinity;
+    best.result.evaluations = count;
+    count = std::min(count, MaxTerms);
+    if (count < 4) return best.result;
+    levin(terms, partialSums, count, best);
+    wynn(partialSums, count, 1, best);
+
+    Result& result = best.result;
+    result.converged = converged(result, largest(partialSums, 0, count), tolerance);
+    // Terms that do not shrink diverge
+    const size_t half = count / 2;
+    const double tail = largest(terms, half, count);
+    if (tail > 0.0 && tail >= largest(terms, 0, half)) result.converged = false;
+    // A tail of one sign only adds to the partial sums in that direction; the
+    // transforms would happily continue 1/sqrt(n) to the far side (zeta(1/2))
+    bool oneSign = true;
+    for (size_t i = half; i < count; i++) oneSign = oneSign && (terms[i] > 0.0) == (terms[half] > 0.0);
+    if (oneSign && (result.value - partialSums[count - 1]) * terms[half] < -result.error) result.converged = false;
+    return result;
+}
+
+} // namespace Extrapolation
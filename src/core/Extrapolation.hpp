@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+// Convergence acceleration for lim() and infinite sums (MathEngine::estimateLimit,
+// MathEngine::estimateSeries).
+//
+// lim(f, a) extrapolates f(a + h) to h = 0 from the steps h_k = h_0 / 2^k
+// (Richardson): if f(a + h) = L + c1 h + c2 h^2 + ..., each column of the
+// table cancels one more power of h. The first steps stay far enough from a
+// for f not to cancel catastrophically, and the table stops once rounding
+// makes its estimates wander. At an infinite point the steps are 1 / x.
+// Limits that are not power series in h (sqrt(x), x ln(x) at 0) fall back on
+// Wynn's epsilon algorithm (below) over the same points.
+//
+// A series is summed from its first few dozen terms, by the Levin
+// u-transform, which handles slowly converging sums like 1/n^2, and by
+// Wynn's epsilon algorithm, which does better on alternating ones; the
+// estimate whose successive values agree best wins. Terms that do not shrink
+// make a divergent series, however well a transform seems to settle.
+namespace Extrapolation {
+
+// A result has converged when its estimated error is at most 'absolute' or
+// 'relative' times the largest of the numbers it came from
+struct Tolerance {
+    double relative = 1e-10;
+    double absolute = 1e-12;
+};
+
+struct Result {
+    double value = 0.0;
+    double error = 0.0;         // estimated absolute error
+    size_t evaluations = 0;     // points or terms evaluated
+    bool converged = false;     // error within the tolerance
+};
+
+// Points of lim()
+constexpr size_t LimitSteps = 16;
+// Terms of a series at most
+constexpr size_t MaxTerms = 128;
+// Widest samples of limit(), i.e. Taylor series up to TaylorMath::MaxOrder
+constexpr size_t MaxWidth = 25;
+
+// Point k < LimitSteps of lim() at 'point' from the given side
+double limitPoint(double point, bool fromRight, size_t k);
+
+// Extrapolates samples[k * width + i] at the points k < count to the limit,
+// into out[0..width). Column 0 holds the values of f and picks the method;
+// further columns (Taylor coefficients) are extrapolated alike.
+Result limit(const double* samples, size_t count, size_t width, double* out, const Tolerance& tolerance);
+
+// Sum of the series with terms[0..count) and partialSums[0..count)
+Result series(const double* terms, const double* partialSums, size_t count, const Tolerance& tolerance);
+
+} // namespace Extrapolation
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+// Working memory of MathEngine::gradient. The forward sweep records every
+// node's value and its partial derivatives with respect to its operands; the
+// backward sweep accumulates the adjoints d(result)/d(node) from the root
+// down. Keep one tape per thread and pass it to every call: once it has grown
+// to the largest program, gradients allocate nothing.
+class GradientTape {
+public:
+    // Nodes recorded by the last gradient() call
+    size_t size() const { return values.size(); }
+
+private:
+    friend class MathEngine;
+
+    std::vector<double> values;
+    std::vector<double> partials;   // 3 per node: with respect to lhs, rhs, third
+    std::vector<double> adjoints;
+
+    void resize(size_t nodes) {
+        values.resize(nodes);
+        partials.resize(nodes * 3);
+        adjoints.assign(nodes, 0.0);
+    }
+};
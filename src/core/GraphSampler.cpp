@@ -0,0 +1,173 @@
+#include "GraphSampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void GraphSampler::sample(const MathEngine& engine, const CompiledExpression& expression,
+                          double xMin, double xMax, double yMin, double yMax, double columns, double rows) {
+    this->engine = &engine;
+    this->expression = &expression;
+    this->yMin = yMin;
+    this->yMax = yMax;
+    pixelWidth = (xMax - xMin) / std::max(columns, 1.0);
+    pixelHeight = (yMax - yMin) / std::max(rows, 1.0);
+    points.clear();
+    open = false;
+    pointEvaluations = 0;
+    intervalEvaluations = 0;
+    if (!expression.isValid() || !(xMax > xMin) || !(yMax > yMin)) return;
+
+    if (!expression.hasIntervalForm()) {
+        sampleColumns(xMin, xMax);
+        return;
+    }
+
+    double x0 = xMin;
+    double y0 = evaluate(x0);
+    for (int i = 1; i <= InitialPieces; ++i) {
+        const double x1 = i == InitialPieces ? xMax : xMin + (xMax - xMin) * i / InitialPieces;
+        const double y1 = evaluate(x1);
+        refine(x0, y0, x1, y1);
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+double GraphSampler::evaluate(double x) {
+    ++pointEvaluations;
+    EvalContext context;
+    const double y = engine->evaluate(*expression, x, context);
+    return context.failed() ? std::numeric_limits<double>::quiet_NaN() : y;
+}
+
+void GraphSampler::refine(double x0, double y0, double x1, double y1) {
+    ++intervalEvaluations;
+    const Interval range = engine->evaluate(*expression, Interval(x0, x1));
+    if (range.empty) {
+        gap();
+        return;
+    }
+
+    // Nothing of this piece is visible
+    if (range.hi < yMin || range.lo > yMax) {
+        if (range.continuous && !std::isnan(y0) && !std::isnan(y1)) lineTo(x0, y0, x1, y1);
+        else gap();
+        return;
+    }
+
+    const bool pixel = x1 - x0 <= pixelWidth;
+    const bool continuous = range.continuous && !std::isnan(y0) && !std::isnan(y1);
+    if (continuous) {
+        // Within one pixel row, any line through the band is exact enough
+        if (range.hi - range.lo <= pixelHeight) {
+            lineTo(x0, y0, x1, y1);
+            return;
+        }
+        if (pixel) {
+            // Steep but continuous: the column covers the values found in
+            // it, in the direction the curve goes. Not the whole enclosure,
+            // which overestimates when x appears more than once (x*x-x*x is
+            // flat); where it reaches past the samples, the halves are
+            // searched for what it could be hiding
+            const double xm = 0.5 * (x0 + x1);
+            const double ym = evaluate(xm);
+            if (std::isnan(ym)) {
+                gap();
+                return;
+            }
+            double lo = std::min({ y0, ym, y1 }), hi = std::max({ y0, ym, y1 });
+            if (range.lo < lo - SpikeRows * pixelHeight || range.hi > hi + SpikeRows * pixelHeight) {
+                extend(x0, xm, lo, hi, SubpixelDepth);
+                extend(xm, x1, lo, hi, SubpixelDepth);
+            }
+            if (hi - lo <= pixelHeight) {
+                lineTo(x0, y0, xm, ym);
+                lineTo(xm, ym, x1, y1);
+                return;
+            }
+            lineTo(x0, y0, xm, y1 >= y0 ? lo : hi);
+            lineTo(xm, y1 >= y0 ? lo : hi, xm, y1 >= y0 ? hi : lo);
+            lineTo(xm, y1 >= y0 ? hi : lo, x1, y1);
+            return;
+        }
+    } else if (pixel) {
+        // A pole, jump or domain edge within this pixel: leave it open
+        gap();
+        return;
+    }
+
+    const double xm = 0.5 * (x0 + x1);
+    const double ym = evaluate(xm);
+
+    // A chord fits when the enclosure adds no spike beyond the endpoints
+    // and the midpoint lies on it
+    if (continuous && !std::isnan(ym)) {
+        const double chordLo = std::min(y0, y1) - SpikeRows * pixelHeight;
+        const double chordHi = std::max(y0, y1) + SpikeRows * pixelHeight;
+        if (range.lo >= chordLo && range.hi <= chordHi && std::fabs(ym - 0.5 * (y0 + y1)) <= 0.5 * pixelHeight) {
+            lineTo(x0, y0, xm, ym);
+            lineTo(xm, ym, x1, y1);
+            return;
+        }
+    }
+    refine(x0, y0, xm, ym);
+    refine(xm, ym, x1, y1);
+}
+
+void GraphSampler::extend(double x0, double x1, double& lo, double& hi, int depth) {
+    ++intervalEvaluations;
+    const Interval range = engine->evaluate(*expression, Interval(x0, x1));
+    if (range.empty || (range.lo >= lo - SpikeRows * pixelHeight && range.hi <= hi + SpikeRows * pixelHeight)) return;
+    const double xm = 0.5 * (x0 + x1);
+    const double ym = evaluate(xm);
+    if (!std::isnan(ym)) {
+        lo = std::min(lo, ym);
+        hi = std::max(hi, ym);
+    }
+    if (depth == 0) return;
+    extend(x0, xm, lo, hi, depth - 1);
+    extend(xm, x1, lo, hi, depth - 1);
+}
+
+void GraphSampler::sampleColumns(double xMin, double xMax) {
+    const size_t steps = static_cast<size_t>(std::ceil((xMax - xMin) / pixelWidth));
+    columnXs.resize(steps + 1);
+    columnYs.resize(steps + 1);
+    for (size_t i = 0; i <= steps; ++i) {
+        columnXs[i] = i == steps ? xMax : xMin + (xMax - xMin) * static_cast<double>(i) / static_cast<double>(steps);
+    }
+    engine->evaluateBatch(*expression, columnXs.data(), columnYs.data(), columnXs.size(), columnErrors);
+    pointEvaluations += columnXs.size();
+
+    for (size_t i = 1; i <= steps; ++i) {
+        // Without enclosures, jumps across the whole view are taken for poles
+        if (!columnErrors.test(i - 1) && !columnErrors.test(i) &&
+            std::fabs(columnYs[i] - columnYs[i - 1]) < yMax - yMin) {
+            lineTo(columnXs[i - 1], columnYs[i - 1], columnXs[i], columnYs[i]);
+        } else {
+            gap();
+        }
+    }
+}
+
+void GraphSampler::lineTo(double x0, double y0, double x1, double y1) {
+    // Clip to a band around the view, so huge values and infinities never
+    // reach screen coordinates and the visible part keeps its slope
+    const double margin = yMax - yMin;
+    const double low = yMin - margin, high = yMax + margin;
+    if ((y0 < low && y1 < low) || (y0 > high && y1 > high)) {
+        gap();
+        return;
+    }
+    double t0 = 0.0, t1 = 1.0;
+    if (std::isfinite(y0) && std::isfinite(y1) && y0 != y1) {
+        const double ta = (low - y0) / (y1 - y0), tb = (high - y0) / (y1 - y0);
+        t0 = std::max(t0, std::min(ta, tb));
+        t1 = std::min(t1, std::max(ta, tb));
+    }
+    const double dx = x1 - x0, dy = y1 - y0;
+    auto clampY = [&](double y) { return std::min(std::max(y, low), high); };
+    if (!open || t0 > 0.0) points.push_back({ x0 + t0 * dx, clampY(t0 > 0.0 ? y0 + t0 * dy : y0), false });
+    points.push_back({ x0 + t1 * dx, clampY(t1 < 1.0 ? y0 + t1 * dy : y1), true });
+    open = t1 == 1.0;
+}
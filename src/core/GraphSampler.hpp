@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "MathEngine.hpp"
+
+// Points of y = f(x) for drawing, chosen adaptively with interval
+// evaluation (MathEngine::evaluate with an Interval). A piece of the curve
+// is drawn as a straight line once its enclosure shows the function is
+// continuous there and stays close to the chord, and the midpoint is within
+// half a pixel of it; otherwise it is halved, down to one pixel. Smooth
+// curves need few evaluations, spikes between samples cannot hide inside an
+// enclosure, and poles, jumps and domain edges leave gaps instead of
+// vertical lines.
+//
+// Programs without an interval form (calculus operators) are evaluated at
+// every pixel column instead, in one batch.
+class GraphSampler {
+public:
+    struct Point {
+        double x;
+        double y;           // within a band of one view height around the visible range
+        bool connected;     // a line joins it to the previous point
+    };
+
+    // Samples x in [xMin, xMax] for a view of yMin..yMax that is 'columns'
+    // by 'rows' pixels
+    void sample(const MathEngine& engine, const CompiledExpression& expression,
+                double xMin, double xMax, double yMin, double yMax, double columns, double rows);
+
+    const std::vector<Point>& getPoints() const { return points; }
+    // Evaluations of the last sample(), for profiling
+    size_t getPointEvaluations() const { return pointEvaluations; }
+    size_t getIntervalEvaluations() const { return intervalEvaluations; }
+
+private:
+    // Initial pieces before refinement; catches features that the interval
+    // of the whole range would blur
+    static constexpr int InitialPieces = 16;
+    // How far, in pixel rows, an enclosure may reach past its chord; interval
+    // bounds overestimate a little, and smaller spikes do not show
+    static constexpr double SpikeRows = 2.0;
+    // Halvings below a pixel when looking for the extremes of a column
+    static constexpr int SubpixelDepth = 10;
+
+    const MathEngine* engine = nullptr;
+    const CompiledExpression* expression = nullptr;
+    double pixelWidth = 0.0;
+    double pixelHeight = 0.0;
+    double yMin = 0.0;
+    double yMax = 0.0;
+
+    std::vector<Point> points;
+    std::vector<double> columnXs;   // batch of sampleColumns(), reused
+    std::vector<double> columnYs;
+    ErrorMask columnErrors;
+    bool open = false;      // the last point ends a line that may continue
+    size_t pointEvaluations = 0;
+    size_t intervalEvaluations = 0;
+
+    double evaluate(double x);      // NaN where undefined
+    void refine(double x0, double y0, double x1, double y1);
+    // Widens [lo, hi] by the values of f in [x0, x1] found where the
+    // enclosure reaches more than SpikeRows past it
+    void extend(double x0, double x1, double& lo, double& hi, int depth);
+    void sampleColumns(double xMin, double xMax);
+    void lineTo(double x0, double y0, double x1, double y1);
+    void gap() { open = false; }
+};
@@ -0,0 +1,304 @@
+#include "Interval.hpp"
+#include "Builtins.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double Infinity = std::numeric_limits<double>::infinity();
+constexpr double Epsilon = std::numeric_limits<double>::epsilon();
+constexpr double Pi = 3.14159265358979323846;
+constexpr double HalfPi = Pi / 2.0;
+constexpr double TwoPi = 2.0 * Pi;
+
+// Beyond this the spacing of doubles exceeds a period, so trig gives up
+constexpr double MaxTrigArgument = 1e15;
+
+// Moves a libm result outward by at least LibmUlps ulps; zeros and
+// infinities are exact
+double below(double x) {
+    return std::isfinite(x) && x != 0.0 ? x - std::fabs(x) * (IntervalMath::LibmUlps * Epsilon) : x;
+}
+double above(double x) {
+    return std::isfinite(x) && x != 0.0 ? x + std::fabs(x) * (IntervalMath::LibmUlps * Epsilon) : x;
+}
+
+// Real-number bounds of a double result that was rounded to nearest
+double roundedDown(double x) { return std::nextafter(x, -Infinity); }
+double roundedUp(double x) { return std::nextafter(x, Infinity); }
+
+// Endpoint operations that came out NaN (inf - inf, 0 * inf) bound nothing
+Interval make(double lo, double hi, bool continuous) {
+    if (std::isnan(lo)) lo = -Infinity;
+    if (std::isnan(hi)) hi = Infinity;
+    return Interval(lo, hi, continuous);
+}
+
+// 0 * inf counts as 0: the operands' finite values never give NaN
+double product(double a, double b) {
+    return (a == 0.0 || b == 0.0) ? 0.0 : a * b;
+}
+
+Interval increasing(double (*f)(double), const Interval& a) {
+    return make(below(f(a.lo)), above(f(a.hi)), a.continuous);
+}
+
+Interval decreasing(double (*f)(double), const Interval& a) {
+    return make(below(f(a.hi)), above(f(a.lo)), a.continuous);
+}
+
+// Restricts 'a' to the domain [min, max] of a function (open ends when
+// 'open' is set). Returns false if nothing is left; a partial overlap makes
+// the result discontinuous, as some x have a domain error.
+bool restrict(Interval& a, double min, double max, bool open = false) {
+    const bool inside = open ? (a.lo > min && a.hi < max) : (a.lo >= min && a.hi <= max);
+    if (inside) return true;
+    const bool outside = open ? (a.hi <= min || a.lo >= max) : (a.hi < min || a.lo > max);
+    if (outside) return false;
+    a.lo = std::max(a.lo, min);
+    a.hi = std::min(a.hi, max);
+    a.continuous = false;
+    return true;
+}
+
+// Whether some x = offset + k * period (k integer) may lie in [lo, hi].
+// Errs towards yes: the quotients are rounded and libm uses the exact pi.
+bool hitsLattice(double lo, double hi, double offset, double period) {
+    const double slack = (std::fabs(lo) + std::fabs(hi)) * 8.0 * Epsilon + 1e-300;
+    return std::ceil((lo - slack - offset) / period) <= std::floor((hi + slack - offset) / period);
+}
+
+// sin and cos: endpoint values, or +-1 where an extremum lies inside
+Interval periodic(double (*f)(double), const Interval& a, double maximumAt) {
+    if (!(a.hi - a.lo < TwoPi) || std::fabs(a.lo) > MaxTrigArgument || std::fabs(a.hi) > MaxTrigArgument) {
+        return Interval(-1.0, 1.0, a.continuous);
+    }
+    const double first = f(a.lo), second = f(a.hi);
+    double lo = below(std::min(first, second));
+    double hi = above(std::max(first, second));
+    if (hitsLattice(a.lo, a.hi, maximumAt, TwoPi)) hi = 1.0;
+    if (hitsLattice(a.lo, a.hi, maximumAt + Pi, TwoPi)) lo = -1.0;
+    return Interval(std::max(lo, -1.0), std::min(hi, 1.0), a.continuous);
+}
+
+Interval tangent(const Interval& a) {
+    if (!(a.hi - a.lo < Pi) || std::fabs(a.lo) > MaxTrigArgument || std::fabs(a.hi) > MaxTrigArgument ||
+        hitsLattice(a.lo, a.hi, HalfPi, Pi)) {
+        return Interval::entire();
+    }
+    return increasing(std::tan, a);
+}
+
+// Even functions decreasing up to 0 and increasing after it
+Interval valley(double (*f)(double), const Interval& a) {
+    if (a.lo >= 0.0) return increasing(f, a);
+    if (a.hi <= 0.0) return decreasing(f, a);
+    return make(below(f(0.0)), above(std::max(f(a.lo), f(a.hi))), a.continuous);
+}
+
+Interval factorial(Interval a) {
+    // The kernel truncates; a jump at every integer, defined for 0..170
+    double first = std::trunc(a.lo), last = std::trunc(a.hi);
+    if (last < 0.0 || first > 170.0) return Interval::none();
+    const bool continuous = a.continuous && first == last && first >= 0.0 && last <= 170.0;
+    first = std::max(first, 0.0);
+    last = std::min(last, 170.0);
+    return Interval(Builtins::detail::factorial(first, 0.0, 0.0), Builtins::detail::factorial(last, 0.0, 0.0), continuous);
+}
+
+// nCr and nPr are piecewise constant: exact while every argument stays
+// within one integer, otherwise only known to be non-negative
+Interval combinatoric(FunctionId function, const Interval& a, const Interval& b, const Interval& c) {
+    const Builtins::Info& builtin = Builtins::get(function);
+    const bool fixed = std::trunc(a.lo) == std::trunc(a.hi) && std::trunc(b.lo) == std::trunc(b.hi) &&
+                       (builtin.arity < 3 || std::trunc(c.lo) == std::trunc(c.hi));
+    if (!fixed) return Interval(0.0, Infinity, false);
+    if (builtin.domain(a.lo, b.lo, c.lo) != MathError::None) return Interval::none();
+    const double value = builtin.function(a.lo, b.lo, c.lo);
+    return Interval(value, value, a.continuous && b.continuous && c.continuous);
+}
+
+} // namespace
+
+Interval Interval::entire() {
+    return Interval(-Infinity, Infinity, false);
+}
+
+Interval Interval::none() {
+    Interval result;
+    result.continuous = false;
+    result.empty = true;
+    return result;
+}
+
+namespace IntervalMath {
+
+Interval add(const Interval& a, const Interval& b) {
+    if (a.empty || b.empty) return Interval::none();
+    return make(a.lo + b.lo, a.hi + b.hi, a.continuous && b.continuous);
+}
+
+Interval subtract(const Interval& a, const Interval& b) {
+    if (a.empty || b.empty) return Interval::none();
+    return make(a.lo - b.hi, a.hi - b.lo, a.continuous && b.continuous);
+}
+
+Interval multiply(const Interval& a, const Interval& b) {
+    if (a.empty || b.empty) return Interval::none();
+    const double p1 = product(a.lo, b.lo), p2 = product(a.lo, b.hi);
+    const double p3 = product(a.hi, b.lo), p4 = product(a.hi, b.hi);
+    return make(std::min({ p1, p2, p3, p4 }), std::max({ p1, p2, p3, p4 }), a.continuous && b.continuous);
+}
+
+Interval square(const Interval& a) {
+    if (a.empty) return Interval::none();
+    const double first = a.lo * a.lo, second = a.hi * a.hi;
+    if (a.lo >= 0.0 || a.hi <= 0.0) return Interval(std::min(first, second), std::max(first, second), a.continuous);
+    return Interval(0.0, std::max(first, second), a.continuous);
+}
+
+Interval divide(const Interval& a, const Interval& b) {
+    if (a.empty || b.empty) return Interval::none();
+    if (b.lo == 0.0 && b.hi == 0.0) return Interval::none();
+    if (b.lo <= 0.0 && b.hi >= 0.0) return Interval::entire();  // division by zero inside
+
+    const double q1 = a.lo / b.lo, q2 = a.lo / b.hi, q3 = a.hi / b.lo, q4 = a.hi / b.hi;
+    if (std::isnan(q1) || std::isnan(q2) || std::isnan(q3) || std::isnan(q4)) {
+        return Interval(-Infinity, Infinity, a.continuous && b.continuous);
+    }
+    return Interval(std::min({ q1, q2, q3, q4 }), std::max({ q1, q2, q3, q4 }), a.continuous && b.continuous);
+}
+
+Interval selfDifference(const Interval& a) {
+    if (a.empty) return Interval::none();
+    if (!std::isfinite(a.lo) || !std::isfinite(a.hi)) return subtract(a, a); // inf - inf is NaN
+    return Interval(0.0, 0.0, a.continuous);
+}
+
+Interval selfQuotient(const Interval& a) {
+    if (a.empty) return Interval::none();
+    if (a.contains(0.0) || !std::isfinite(a.lo) || !std::isfinite(a.hi)) return divide(a, a);
+    return Interval(1.0, 1.0, a.continuous);
+}
+
+Interval modulo(const Interval& a, const Interval& b) {
+    if (a.empty || b.empty) return Interval::none();
+    if (b.lo == 0.0 && b.hi == 0.0) return Interval::none();
+    const double limit = std::max(std::fabs(b.lo), std::fabs(b.hi));
+    // fmod has the sign of a and a magnitude below |b|
+    Interval bounded(a.lo >= 0.0 ? 0.0 : -limit, a.hi <= 0.0 ? 0.0 : limit, false);
+    if (b.lo <= 0.0 && b.hi >= 0.0) return bounded;
+
+    // Continuous while trunc(a / b) stays the same: then fmod is exactly a - t * b
+    const Interval quotient = divide(a, b);
+    const double t = std::trunc(quotient.lo);
+    if (!std::isfinite(t) || t != std::trunc(quotient.hi) || std::fabs(t) > 9007199254740992.0) return bounded;
+    // The exact real value, so every rounded step is widened
+    const double first = t * b.lo, second = t * b.hi;
+    const double scaledLo = roundedDown(std::min(first, second)), scaledHi = roundedUp(std::max(first, second));
+    return Interval(std::max(roundedDown(a.lo - scaledHi), bounded.lo),
+                    std::min(roundedUp(a.hi - scaledLo), bounded.hi), a.continuous && b.continuous);
+}
+
+Interval power(const Interval& base, const Interval& exponent) {
+    if (base.empty || exponent.empty) return Interval::none();
+    const bool continuous = base.continuous && exponent.continuous;
+
+    const double n = exponent.lo;
+    if (n == exponent.hi && n == std::trunc(n) && std::fabs(n) < 9007199254740992.0) {
+        if (n == 0.0) return Interval(1.0, 1.0, continuous);
+        const double first = std::pow(base.lo, n), second = std::pow(base.hi, n);
+        if (base.lo > 0.0 || base.hi < 0.0) {
+            return make(below(std::min(first, second)), above(std::max(first, second)), continuous);
+        }
+        // Zero inside: a pole for negative powers (pow gives inf, nothing to draw)
+        if (n < 0.0) return (base.lo == 0.0 && base.hi == 0.0) ? Interval::none() : Interval::entire();
+        const bool even = std::fmod(n, 2.0) == 0.0;
+        if (even) return Interval(0.0, above(std::max(first, second)), continuous);
+        return Interval(below(first), above(second), continuous);
+    }
+
+    // pow is monotone in each argument for positive bases (and for a zero
+    // base with positive exponents), so the corners bound it
+    if (base.lo > 0.0 || (base.lo >= 0.0 && exponent.lo > 0.0)) {
+        const double p1 = std::pow(base.lo, exponent.lo), p2 = std::pow(base.lo, exponent.hi);
+        const double p3 = std::pow(base.hi, exponent.lo), p4 = std::pow(base.hi, exponent.hi);
+        return make(below(std::min({ p1, p2, p3, p4 })), above(std::max({ p1, p2, p3, p4 })), continuous);
+    }
+    // Negative bases are only defined at integer exponents
+    return Interval::entire();
+}
+
+Interval negate(const Interval& a) {
+    if (a.empty) return a;
+    return Interval(-a.hi, -a.lo, a.continuous);
+}
+
+Interval reciprocal(const Interval& a) {
+    return divide(Interval(1.0), a);
+}
+
+Interval function(FunctionId id, const Interval& a, const Interval& b, const Interval& c) {
+    if (a.empty || b.empty || c.empty) return Interval::none();
+    Interval x = a;
+
+    switch (id) {
+        case FunctionId::Sin:  return periodic(std::sin, x, HalfPi);
+        case FunctionId::Cos:  return periodic(std::cos, x, 0.0);
+        case FunctionId::Tan:   return tangent(x);
+        case FunctionId::Asin:
+            if (!restrict(x, -1.0, 1.0)) return Interval::none();
+            return make(std::max(below(std::asin(x.lo)), -HalfPi), std::min(above(std::asin(x.hi)), HalfPi), x.continuous);
+        case FunctionId::Acos:
+            if (!restrict(x, -1.0, 1.0)) return Interval::none();
+            return make(std::max(below(std::acos(x.hi)), 0.0), std::min(above(std::acos(x.lo)), Pi), x.continuous);
+        case FunctionId::Atan:  return increasing(std::atan, x);
+        case FunctionId::Log:
+            if (!restrict(x, 0.0, Infinity, true)) return Interval::none();
+            return increasing(std::log10, x);
+        case FunctionId::Ln:
+            if (!restrict(x, 0.0, Infinity, true)) return Interval::none();
+            return increasing(std::log, x);
+        case FunctionId::Sqrt:
+            if (!restrict(x, 0.0, Infinity)) return Interval::none();
+            // Correctly rounded, so monotone
+            return Interval(std::sqrt(x.lo), std::sqrt(x.hi), x.continuous);
+        case FunctionId::Cbrt:  return increasing(std::cbrt, x);
+        case FunctionId::Exp: {
+            Interval result = increasing(std::exp, x);
+            result.lo = std::max(result.lo, 0.0);
+            return result;
+        }
+        case FunctionId::Abs:
+            if (x.lo >= 0.0) return x;
+            if (x.hi <= 0.0) return negate(x);
+            return Interval(0.0, std::max(-x.lo, x.hi), x.continuous);
+        case FunctionId::Fact:  return factorial(x);
+        case FunctionId::Ncr:
+        case FunctionId::Npr:   return combinatoric(id, a, b, c);
+        case FunctionId::Sinh:  return increasing(std::sinh, x);
+        case FunctionId::Cosh: {
+            Interval result = valley(std::cosh, x);
+            result.lo = std::max(result.lo, 1.0);
+            return result;
+        }
+        case FunctionId::Tanh: {
+            Interval result = increasing(std::tanh, x);
+            result.lo = std::max(result.lo, -1.0);
+            result.hi = std::min(result.hi, 1.0);
+            return result;
+        }
+        case FunctionId::Asinh: return increasing(std::asinh, x);
+        case FunctionId::Acosh:
+            if (!restrict(x, 1.0, Infinity)) return Interval::none();
+            return make(std::max(below(std::acosh(x.lo)), 0.0), above(std::acosh(x.hi)), x.continuous);
+        case FunctionId::Atanh:
+            if (!restrict(x, -1.0, 1.0, true)) return Interval::none();
+            return increasing(std::atanh, x);
+        default:
+            return Interval::entire();
+    }
+}
+
+} // namespace IntervalMath
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CompiledExpression.hpp"
+
+// Enclosure of the values an expression takes while x ranges over an
+// interval (MathEngine::evaluate with an Interval argument). It bounds the
+// doubles the interpreter computes, not just the real-number results: IEEE
+// operations round monotonically, so rounding the endpoint operations to
+// nearest already bounds them, and libm results, which are not guaranteed to
+// be monotone, are widened by IntervalMath::LibmUlps.
+//
+// The flags describe the whole input range. A continuous result is defined
+// and continuous at every point of it; otherwise there may be a domain error,
+// a pole or a jump somewhere inside, and [lo, hi] only bounds the values at
+// the points where the expression is defined. An empty result is defined
+// nowhere.
+struct Interval {
+    double lo = 0.0;
+    double hi = 0.0;
+    bool continuous = true;
+    bool empty = false;
+
+    Interval() = default;
+    Interval(double value) : lo(value), hi(value) {}
+    Interval(double lo, double hi, bool continuous = true) : lo(lo), hi(hi), continuous(continuous) {}
+
+    // Any value, possibly undefined or discontinuous: what nothing is known about
+    static Interval entire();
+    static Interval none();
+
+    bool contains(double value) const { return !empty && lo <= value && value <= hi; }
+    double width() const { return hi - lo; }
+};
+
+namespace IntervalMath {
+
+// Widening of libm results, in ulps (SimdMath.hpp lists up to 3.2 for glibc)
+constexpr double LibmUlps = 4.0;
+
+Interval add(const Interval& a, const Interval& b);
+Interval subtract(const Interval& a, const Interval& b);
+Interval multiply(const Interval& a, const Interval& b);
+// a * a: never negative, unlike multiply(a, a)
+Interval square(const Interval& a);
+Interval divide(const Interval& a, const Interval& b);
+// a - a and a / a: exactly 0 and 1 wherever a is finite (and nonzero)
+Interval selfDifference(const Interval& a);
+Interval selfQuotient(const Interval& a);
+Interval modulo(const Interval& a, const Interval& b);
+Interval power(const Interval& base, const Interval& exponent);
+Interval negate(const Interval& a);
+Interval reciprocal(const Interval& a);
+
+// Built-in functions in radians, like Builtins; the calculus operators have
+// no interval form and give Interval::entire()
+Interval function(FunctionId function, const Interval& a, const Interval& b, const Interval& c);
+
+} // namespace IntervalMath
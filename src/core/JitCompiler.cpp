@@ -0,0 +1,267 @@
+#include "JitCompiler.hpp"
+#include "Builtins.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CALCULATOR_JIT_X64 1
+#endif
+
+#ifdef CALCULATOR_JIT_X64
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
+#ifdef CALCULATOR_JIT_X64
+namespace {
+
+// Node values are addressed as [rbx + 8 * index] with a 32-bit displacement
+constexpr size_t MaxNodes = (1u << 28) - 1;
+
+double power(double base, double exponent) { return std::pow(base, exponent); }
+double modulo(double a, double b) { return std::fmod(a, b); }
+
+// Encoder for the few x86-64 instructions the code generator needs.
+// xmm0 to xmm2 carry operands, xmm0 the result; rbx points at the node values.
+class Assembler {
+public:
+    std::vector<std::uint8_t> code;
+
+    void bytes(std::initializer_list<std::uint8_t> list) { code.insert(code.end(), list); }
+    void imm32(std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+    void imm64(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) code.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+
+    // <prefix> 0F <opcode> xmm, [rbx + 8 * slot]
+    void memoryOperand(std::uint8_t prefix, std::uint8_t opcode, int xmm, std::uint32_t slot) {
+        bytes({ prefix, 0x0F, opcode, static_cast<std::uint8_t>(0x83 | xmm << 3) });
+        imm32(slot * 8);
+    }
+    void load(int xmm, std::uint32_t slot) { memoryOperand(0xF2, 0x10, xmm, slot); }   // movsd xmm, [slot]
+    void store(int xmm, std::uint32_t slot) { memoryOperand(0xF2, 0x11, xmm, slot); }  // movsd [slot], xmm
+
+    void loadConstant(int xmm, double value) {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bytes({ 0x48, 0xB8 });                                              // mov rax, imm64
+        imm64(bits);
+        bytes({ 0x66, 0x48, 0x0F, 0x6E, static_cast<std::uint8_t>(0xC0 | xmm << 3) }); // movq xmm, rax
+    }
+
+    template <typename Function>
+    void call(Function* function) {
+        bytes({ 0x48, 0xB8 });                                              // mov rax, imm64
+        imm64(reinterpret_cast<std::uintptr_t>(function));
+        bytes({ 0xFF, 0xD0 });                                              // call rax
+    }
+
+    // Conditional jump with a rel32 target patched by patch()
+    size_t jump(std::uint8_t condition) {
+        bytes({ 0x0F, condition });
+        imm32(0);
+        return code.size() - 4;
+    }
+    void patch(size_t at, size_t target) {
+        std::int32_t offset = static_cast<std::int32_t>(target - (at + 4));
+        std::memcpy(&code[at], &offset, sizeof(offset));
+    }
+};
+
+static_assert(sizeof(MathError) == 1, "domain checks are tested through al");
+
+constexpr std::uint8_t JumpIfEqual = 0x84;
+constexpr std::uint8_t JumpIfNotEqual = 0x85;
+
+// Emits the whole function: int f(double x, double* values)
+bool generate(const CompiledExpression& program, Assembler& a) {
+    const std::vector<ExpressionNode>& nodes = program.getNodes();
+    if (nodes.empty() || nodes.size() > MaxNodes) return false;
+
+    // Jumps taken when a node could fail; the interpreter re-runs that x
+    std::vector<size_t> bailouts;
+    auto bailIfZero = [&](int xmm) {
+        a.bytes({ 0x66, 0x0F, 0x57, 0xD2 });                                // xorpd xmm2, xmm2
+        a.bytes({ 0x66, 0x0F, 0x2E, static_cast<std::uint8_t>(0xC2 | xmm << 3) }); // ucomisd xmm, xmm2
+        a.bytes({ 0x7A, 0x06 });                                            // jp over (NaN is not zero)
+        bailouts.push_back(a.jump(JumpIfEqual));
+    };
+
+    a.bytes({ 0x53 });                                                      // push rbx
+    a.bytes({ 0x48, 0x83, 0xEC, 0x30 });                                    // sub rsp, 48: shadow space, x, alignment
+#ifdef _WIN32
+    a.bytes({ 0x48, 0x89, 0xD3 });                                          // mov rbx, rdx
+#else
+    a.bytes({ 0x48, 0x89, 0xFB });                                          // mov rbx, rdi
+#endif
+    a.bytes({ 0xF2, 0x0F, 0x11, 0x44, 0x24, 0x20 });                        // movsd [rsp + 32], xmm0
+
+    // xmm0 still holds the previous node after its store, which saves most loads
+    std::uint32_t inXmm0 = static_cast<std::uint32_t>(-1);
+    auto operand = [&](std::uint32_t slot) {
+        if (slot != inXmm0) a.load(0, slot);
+    };
+
+    for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+        const ExpressionNode& node = nodes[i];
+        switch (node.op) {
+            case OpCode::Constant:
+                a.loadConstant(0, node.value);
+                break;
+            case OpCode::VariableX:
+                a.bytes({ 0xF2, 0x0F, 0x10, 0x44, 0x24, 0x20 });            // movsd xmm0, [rsp + 32]
+                break;
+            case OpCode::Add:
+                operand(node.lhs);
+                a.memoryOperand(0xF2, 0x58, 0, node.rhs);                   // addsd
+                break;
+            case OpCode::Subtract:
+                operand(node.lhs);
+                a.memoryOperand(0xF2, 0x5C, 0, node.rhs);                   // subsd
+                break;
+            case OpCode::Multiply:
+                operand(node.lhs);
+                a.memoryOperand(0xF2, 0x59, 0, node.rhs);                   // mulsd
+                break;
+            case OpCode::Divide:
+                a.load(1, node.rhs);
+                bailIfZero(1);
+                operand(node.lhs);
+                a.bytes({ 0xF2, 0x0F, 0x5E, 0xC1 });                        // divsd xmm0, xmm1
+                break;
+            case OpCode::Modulo:
+                a.load(1, node.rhs);
+                bailIfZero(1);
+                operand(node.lhs);
+                a.call(&modulo);
+                break;
+            case OpCode::Power:
+                operand(node.lhs);
+                a.load(1, node.rhs);
+                a.call(&power);
+                break;
+            case OpCode::Negate:
+                operand(node.lhs);
+                a.loadConstant(1, -0.0);
+                a.bytes({ 0x66, 0x0F, 0x57, 0xC1 });                        // xorpd xmm0, xmm1
+                break;
+            case OpCode::Reciprocal:
+                a.loadConstant(0, 1.0);
+                a.memoryOperand(0xF2, 0x5E, 0, node.lhs);                   // divsd
+                break;
+            case OpCode::Function: {
+                const Builtins::Info& builtin = Builtins::get(node.function);
+                if (!builtin.function) return false;
+                auto arguments = [&] {
+                    operand(node.lhs);
+                    if (builtin.arity > 1) a.load(1, node.rhs);
+                    if (builtin.arity > 2) a.load(2, node.third);
+                };
+                if (builtin.domain) {
+                    arguments();
+                    a.call(builtin.domain);
+                    a.bytes({ 0x84, 0xC0 });                                // test al, al (MathError is one byte)
+                    bailouts.push_back(a.jump(JumpIfNotEqual));
+                    inXmm0 = static_cast<std::uint32_t>(-1);                // clobbered by the call
+                }
+                arguments();
+                a.call(builtin.function);
+                break;
+            }
+            default:
+                return false; // calculus operators and named variables stay in the interpreter
+        }
+        a.store(0, i);
+        inXmm0 = i;
+    }
+
+    a.bytes({ 0x31, 0xC0 });                                                // xor eax, eax
+    a.bytes({ 0x48, 0x83, 0xC4, 0x30, 0x5B, 0xC3 });                        // add rsp, 48; pop rbx; ret
+
+    size_t bail = a.code.size();
+    a.bytes({ 0xB8, 0x01, 0x00, 0x00, 0x00 });                              // mov eax, 1
+    a.bytes({ 0x48, 0x83, 0xC4, 0x30, 0x5B, 0xC3 });                        // add rsp, 48; pop rbx; ret
+    for (size_t at : bailouts) a.patch(at, bail);
+    return true;
+}
+
+// Copies the code into fresh pages and makes them executable (never writable and executable at once)
+void* mapExecutable(const std::vector<std::uint8_t>& code, size_t& mappedSize) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t page = info.dwPageSize;
+    mappedSize = (code.size() + page - 1) / page * page;
+    void* memory = VirtualAlloc(nullptr, mappedSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!memory) return nullptr;
+    std::memcpy(memory, code.data(), code.size());
+    DWORD previous = 0;
+    if (!VirtualProtect(memory, mappedSize, PAGE_EXECUTE_READ, &previous)) {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        return nullptr;
+    }
+    FlushInstructionCache(GetCurrentProcess(), memory, mappedSize);
+    return memory;
+#else
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    mappedSize = (code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return nullptr;
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, mappedSize, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mappedSize);
+        return nullptr;
+    }
+    return memory;
+#endif
+}
+
+} // namespace
+#endif
+
+JitFunction::~JitFunction() {
+#ifdef CALCULATOR_JIT_X64
+    if (!memory) return;
+#ifdef _WIN32
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, mappedSize);
+#endif
+#endif
+}
+
+bool JitCompiler::isAvailable() {
+#ifdef CALCULATOR_JIT_X64
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<const JitFunction> JitCompiler::compile(const CompiledExpression& program) {
+#ifdef CALCULATOR_JIT_X64
+    Assembler assembler;
+    if (!generate(program, assembler)) return nullptr;
+
+    std::shared_ptr<JitFunction> function(new JitFunction());
+    function->memory = mapExecutable(assembler.code, function->mappedSize);
+    if (!function->memory) return nullptr;
+    function->codeSize = assembler.code.size();
+    function->entry = reinterpret_cast<JitFunction::Entry>(function->memory);
+    return function;
+#else
+    (void)program;
+    return nullptr;
+#endif
+}
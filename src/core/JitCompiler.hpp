@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "CompiledExpression.hpp"
+
+// Native x86-64 (SSE2) code for one compiled expression.
+// The generated function writes every node value into 'values' (one double
+// per node, like the interpreter) and calls the built-in kernels directly.
+// It gives up as soon as a node could raise an error (division by zero, a
+// domain error, ...); the caller then re-runs the interpreter, which reports
+// the error with the usual message. Results are bit-identical to the
+// interpreter: same operations, same order, same kernels.
+class JitFunction {
+public:
+    ~JitFunction();
+    JitFunction(const JitFunction&) = delete;
+    JitFunction& operator=(const JitFunction&) = delete;
+
+    // Returns false if the interpreter has to handle this x
+    bool run(double x, double* values) const { return entry(x, values) == 0; }
+    size_t getCodeSize() const { return codeSize; }
+
+private:
+    friend class JitCompiler;
+    using Entry = int (*)(double x, double* values);
+
+    JitFunction() = default;
+
+    void* memory = nullptr;
+    size_t mappedSize = 0;
+    size_t codeSize = 0;
+    Entry entry = nullptr;
+};
+
+class JitCompiler {
+public:
+    // False on targets without a code generator
+    static bool isAvailable();
+
+    // Returns nullptr if the program cannot be compiled: calculus operators
+    // (their bodies can be compiled on their own), an unsupported target, or
+    // no executable memory
+    static std::shared_ptr<const JitFunction> compile(const CompiledExpression& program);
+};
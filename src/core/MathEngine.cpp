@@ -1,10 +1,32 @@
 #include "MathEngine.hpp"
-#include <sstream>
+#include "ExpressionParser.hpp"
+#include "ExpressionOptimizer.hpp"
+#include "JitCompiler.hpp"
+#include "SimdMath.hpp"
+#include "Builtins.hpp"
+#include "Combinatorics.hpp"
+#include "Taylor.hpp"
+#include "ThreadPool.hpp"
+#include "CompensatedSum.hpp"
+#include "Extrapolation.hpp"
 #include <algorithm>
-#include <cctype>
-#include <stack>
+#include <atomic>
+#include <limits>
 
-MathEngine::MathEngine() : memory(0.0), lastError("") {}
+namespace {
+
+// Batches handed to the thread pool hold at least this many node
+// evaluations; below it, waking the workers costs more than it saves
+constexpr size_t ParallelWork = 1 << 16;
+// Node evaluations a calculus operator is taken to cost
+constexpr size_t CalculusCost = 1000;
+// Terms per chunk of sum(): fixed, since it decides the order of additions
+constexpr long long SumChunk = 16384;
+constexpr long long CalculusSumChunk = 8;
+
+} // namespace
+
+MathEngine::MathEngine() : memory(0.0), lastError(MathError::None), angleMode(AngleMode::Degrees) {}
 
 // Basic operations
 double MathEngine::add(double a, double b) { return a + b; }
@@ -12,7 +34,7 @@ double MathEngine::subtract(double a, double b) { return a - b; }
 double MathEngine::multiply(double a, double b) { return a * b; }
 double MathEngine::divide(double a, double b) {
     if (b == 0.0) {
-        setError("Division by zero");
+        setError(MathError::DivisionByZero);
         return 0.0;
     }
     return a / b;
@@ -36,7 +58,7 @@ double MathEngine::tangent(double x, bool isDegrees) {
 
 double MathEngine::arcsine(double x, bool isDegrees) {
     if (x < -1.0 || x > 1.0) {
-        setError("arcsin domain error");
+        setError(MathError::AsinDomain);
         return 0.0;
     }
     double result = std::asin(x);
@@ -45,7 +67,7 @@ double MathEngine::arcsine(double x, bool isDegrees) {
 
 double MathEngine::arccosine(double x, bool isDegrees) {
     if (x < -1.0 || x > 1.0) {
-        setError("arccos domain error");
+        setError(MathError::AcosDomain);
         return 0.0;
     }
     double result = std::acos(x);
@@ -63,18 +85,18 @@ double MathEngine::hyperbolicCosine(double x) { return std::cosh(x); }
 double MathEngine::hyperbolicTangent(double x) { return std::tanh(x); }
 double MathEngine::hyperbolicArcSine(double x) { return std::asinh(x); }
 double MathEngine::hyperbolicArcCosine(double x) {
-    if (x < 1.0) { setError("acosh domain error"); return 0.0; }
+    if (x < 1.0) { setError(MathError::AcoshDomain); return 0.0; }
     return std::acosh(x);
 }
 double MathEngine::hyperbolicArcTangent(double x) {
-    if (x <= -1.0 || x >= 1.0) { setError("atanh domain error"); return 0.0; }
+    if (x <= -1.0 || x >= 1.0) { setError(MathError::AtanhDomain); return 0.0; }
     return std::atanh(x);
 }
 
 // Logarithmic functions
 double MathEngine::logarithm(double x) {
     if (x <= 0.0) {
-        setError("log domain error");
+        setError(MathError::LogDomain);
         return 0.0;
     }
     return std::log10(x);
@@ -82,7 +104,7 @@ double MathEngine::logarithm(double x) {
 
 double MathEngine::naturalLog(double x) {
     if (x <= 0.0) {
-        setError("ln domain error");
+        setError(MathError::LnDomain);
         return 0.0;
     }
     return std::log(x);
@@ -90,7 +112,7 @@ double MathEngine::naturalLog(double x) {
 
 double MathEngine::logBase(double x, double base) {
     if (x <= 0.0 || base <= 0.0 || base == 1.0) {
-        setError("log base domain error");
+        setError(MathError::LogBaseDomain);
         return 0.0;
     }
     return std::log(x) / std::log(base);
@@ -103,7 +125,7 @@ double MathEngine::power(double base, double exponent) {
 
 double MathEngine::squareRoot(double x) {
     if (x < 0.0) {
-        setError("sqrt of negative number");
+        setError(MathError::SqrtDomain);
         return 0.0;
     }
     return std::sqrt(x);
@@ -115,7 +137,7 @@ double MathEngine::cubeRoot(double x) {
 
 double MathEngine::nthRoot(double x, double n) {
     if (n == 0.0) {
-        setError("0th root undefined");
+        setError(MathError::ZerothRoot);
         return 0.0;
     }
     return std::pow(x, 1.0 / n);
@@ -128,11 +150,11 @@ double MathEngine::exponential(double x) {
 // Advanced functions
 double MathEngine::factorial(int n) {
     if (n < 0) {
-        setError("factorial of negative number");
+        setError(MathError::FactorialNegative);
         return 0.0;
     }
     if (n > 170) {
-        setError("factorial overflow");
+        setError(MathError::FactorialOverflow);
         return 0.0;
     }
     double result = 1.0;
@@ -144,23 +166,23 @@ double MathEngine::factorial(int n) {
 
 double MathEngine::permutation(int n, int r) {
     if (n < 0 || r < 0 || r > n) {
-        setError("Invalid permutation parameters");
+        setError(MathError::InvalidPermutation);
         return 0.0;
     }
-    return factorial(n) / factorial(n - r);
+    return Combinatorics::permutation(n, r);
 }
 
 double MathEngine::combination(int n, int r) {
     if (n < 0 || r < 0 || r > n) {
-        setError("Invalid combination parameters");
+        setError(MathError::InvalidCombination);
         return 0.0;
     }
-    return factorial(n) / (factorial(r) * factorial(n - r));
+    return Combinatorics::combination(n, r);
 }
 
 double MathEngine::modulo(double a, double b) {
     if (b == 0.0) {
-        setError("Modulo by zero");
+        setError(MathError::ModuloByZero);
         return 0.0;
     }
     return std::fmod(a, b);
@@ -172,46 +194,500 @@ double MathEngine::absolute(double x) {
 
 // Calculus and Sequences
 double MathEngine::derivative(const std::string& expr, double point) {
-    double h = 1e-6;
-    double f_x_plus_h = evaluate(expr, point + h);
-    double f_x_minus_h = evaluate(expr, point - h);
+    return derivative(compileCached(expr), point);
+}
+
+double MathEngine::integral(const std::string& expr, double lower, double upper) {
+    return integral(compileCached(expr), lower, upper);
+}
+
+double MathEngine::limit(const std::string& expr, double point, bool fromRight) {
+    return limit(compileCached(expr), point, fromRight);
+}
+
+double MathEngine::summation(const std::string& expr, int start, int end) {
+    return summation(compileCached(expr), start, end);
+}
+
+double MathEngine::solve(const std::string& expr, double lower, double upper) {
+    return solve(compileCached(expr), lower, upper);
+}
+
+double MathEngine::ode(const std::string& expr, double x0, double y0, double x1) {
+    return ode(compile(expr, { "x", "y" }), x0, y0, x1);
+}
+
+double MathEngine::derivative(const CompiledExpression& expr, double point) {
+    EvalContext context;
+    double result = derivative(expr, point, context);
+    report(context);
+    return result;
+}
+
+double MathEngine::integral(const CompiledExpression& expr, double lower, double upper) {
+    EvalContext context;
+    double result = integral(expr, lower, upper, context);
+    report(context);
+    return result;
+}
+
+double MathEngine::limit(const CompiledExpression& expr, double point, bool fromRight) {
+    EvalContext context;
+    double result = limit(expr, point, fromRight, context);
+    report(context);
+    return result;
+}
+
+double MathEngine::summation(const CompiledExpression& expr, int start, int end) {
+    EvalContext context;
+    double result = summation(expr, start, end, context);
+    report(context);
+    return result;
+}
+
+double MathEngine::solve(const CompiledExpression& expr, double lower, double upper) {
+    EvalContext context;
+    double result = solve(expr, lower, upper, context);
+    report(context);
+    return result;
+}
+
+double MathEngine::ode(const CompiledExpression& expr, double x0, double y0, double x1) {
+    EvalContext context;
+    Ode::Solution solution = solveOde(expr, x0, y0, x1, odeTolerance, context);
+    report(context);
+    return context.failed() ? 0.0 : solution.value;
+}
+
+double MathEngine::derivative(const CompiledExpression& expr, double point, EvalContext& context,
+                              const double* variables) const {
+    if (!expr.isValid()) { context.fail(expr); return 0.0; }
     
-    if (hasError()) return 0.0;
+    // One pass over dual numbers gives the value and the exact derivative
+    const double x[2] = { point, 1.0 };
+    double result[2];
+    runTaylor(expr, x, 1, result, context, variables);
+    return context.failed() ? 0.0 : result[1];
+}
+
+double MathEngine::integral(const CompiledExpression& expr, double lower, double upper,
+                            EvalContext& context, const double* variables) const {
+    Quadrature::Result result = integrate(expr, lower, upper, context, variables);
+    return context.failed() ? 0.0 : result.value;
+}
+
+Quadrature::Result MathEngine::integrate(const CompiledExpression& expr, double lower, double upper,
+                                         EvalContext& context, const double* variables) const {
+    if (!expr.isValid()) { context.fail(expr); return Quadrature::Result(); }
+    
+    // The rules hand over their nodes in batches
+    struct Integrand {
+        const MathEngine* engine;
+        const CompiledExpression* expr;
+        const double* variables;
+    } integrand{ this, &expr, variables };
+    auto evaluate = [](void* state, const double* xs, double* ys, size_t count) {
+        auto& integrand = *static_cast<Integrand*>(state);
+        return integrand.engine->runParallel(*integrand.expr, xs, ys, count, integrand.variables);
+    };
     
-    return (f_x_plus_h - f_x_minus_h) / (2 * h);
+    Quadrature::Result result = Quadrature::integrate(evaluate, &integrand, lower, upper, integralTolerance);
+    if (result.failure != MathError::None) context.fail(result.failure);
+    else if (!Quadrature::acceptable(result, integralTolerance)) context.fail(MathError::NoConvergence);
+    return result;
 }
 
-double MathEngine::integral(const std::string& expr, double lower, double upper) {
-    int n = 1000; // Number of intervals (must be even for Simpson's)
-    double h = (upper - lower) / n;
+void MathEngine::setIntegralTolerance(double relative, double absolute) {
+    // Below a few ulps the error estimates are rounding noise
+    integralTolerance.relative = std::clamp(relative, 1e-14, 1.0);
+    integralTolerance.absolute = absolute > 0.0 ? absolute : 0.0;
+}
+
+void MathEngine::setOdeTolerance(double relative, double absolute) {
+    odeTolerance.relative = std::clamp(relative, 1e-14, 1.0);
+    odeTolerance.absolute = absolute > 0.0 ? absolute : 0.0;
+}
+
+void MathEngine::setExtrapolationTolerance(double relative, double absolute) {
+    extrapolationTolerance.relative = std::clamp(relative, 1e-14, 1.0);
+    extrapolationTolerance.absolute = absolute > 0.0 ? absolute : 0.0;
+}
+
+double MathEngine::limit(const CompiledExpression& expr, double point, bool fromRight,
+                         EvalContext& context, const double* variables) const {
+    Extrapolation::Result result = estimateLimit(expr, point, fromRight, context, variables);
+    return context.failed() ? 0.0 : result.value;
+}
+
+Extrapolation::Result MathEngine::estimateLimit(const CompiledExpression& expr, double point, bool fromRight,
+                                                EvalContext& context, const double* variables) const {
+    if (!expr.isValid()) { context.fail(expr); return Extrapolation::Result(); }
+    
+    const size_t steps = Extrapolation::LimitSteps;
+    double xs[steps];
+    double ys[steps];
+    for (size_t k = 0; k < steps; k++) xs[k] = Extrapolation::limitPoint(point, fromRight, k);
+    ErrorMask errors;
+    errors.reset(steps);
+    runBatch(expr, xs, ys, steps, errors, variables);
+    if (errors.any()) {
+        context.fail(errors.error(errors.first()));
+        return Extrapolation::Result();
+    }
+    
+    double value;
+    Extrapolation::Result result = Extrapolation::limit(ys, steps, 1, &value, extrapolationTolerance);
+    if (!result.converged) context.fail(MathError::NoConvergence);
+    return result;
+}
+
+void MathEngine::limitTaylor(const CompiledExpression& body, const double* point, size_t order, double* out,
+                             EvalContext& context, const double* variables) const {
+    const size_t steps = Extrapolation::LimitSteps, width = order + 1;
+    double samples[Extrapolation::LimitSteps * Extrapolation::MaxWidth];
+    double shifted[TaylorMath::MaxOrder + 1];
+    std::copy(point, point + width, shifted);
+    // x = 1/h at an infinite point, which moving the point does not move
+    if (std::isinf(point[0])) std::fill(shifted + 1, shifted + width, 0.0);
+    
+    for (size_t k = 0; k < steps; k++) {
+        shifted[0] = Extrapolation::limitPoint(point[0], true, k);
+        runTaylor(body, shifted, order, samples + k * width, context, variables);
+        if (context.failed()) return;
+    }
+    Extrapolation::Result result = Extrapolation::limit(samples, steps, width, out, extrapolationTolerance);
+    if (!result.converged) context.fail(MathError::NoConvergence);
+}
+
+double MathEngine::summation(const CompiledExpression& expr, int start, int end,
+                             EvalContext& context, const double* variables) const {
+    if (!expr.isValid()) { context.fail(expr); return 0.0; }
+    if (end < start) return 0.0;
     
-    double sum = evaluate(expr, lower) + evaluate(expr, upper);
+    // Chunks of terms go to the thread pool. Each is added up with
+    // compensation and the chunks pairwise, in an order fixed by the range
+    // alone, so every thread count gives the same result.
+    const long long terms = (long long)end - start + 1;
+    const long long perChunk = expr.hasCalculus() ? CalculusSumChunk : SumChunk;
+    const size_t chunks = static_cast<size_t>((terms + perChunk - 1) / perChunk);
+    std::vector<CompensatedSum> sums(chunks);
+    std::vector<MathError> errors(chunks, MathError::None);
+    std::atomic<size_t> firstFailed{ chunks };
     
-    for (int i = 1; i < n; i++) {
-        double x = lower + i * h;
-        double val = evaluate(expr, x);
-        if (hasError()) return 0.0;
+    auto sumChunk = [&](size_t chunk) {
+        // Chunks after a failing one cannot change the outcome
+        if (chunk > firstFailed.load(std::memory_order_relaxed)) return;
         
-        if (i % 2 == 0) sum += 2 * val;
-        else sum += 4 * val;
+        const size_t batch = 1024;
+        double xs[batch];
+        double ys[batch];
+        ErrorMask mask;
+        const long long first = start + (long long)chunk * perChunk;
+        const long long last = std::min(first + perChunk - 1, (long long)end);
+        for (long long from = first; from <= last; from += (long long)batch) {
+            size_t count = static_cast<size_t>(std::min((long long)batch, last - from + 1));
+            for (size_t i = 0; i < count; i++) xs[i] = (double)(from + (long long)i);
+            
+            mask.reset(count);
+            runBatch(expr, xs, ys, count, mask, variables);
+            if (mask.any()) {
+                errors[chunk] = mask.error(mask.first());
+                size_t failed = firstFailed.load();
+                while (chunk < failed && !firstFailed.compare_exchange_weak(failed, chunk)) {}
+                return;
+            }
+            for (size_t i = 0; i < count; i++) sums[chunk].add(ys[i]);
+        }
+    };
+    ThreadPool::shared().forEach(chunks, sumChunk);
+    
+    // The first failing term in order, as in a serial loop
+    const size_t failed = firstFailed.load();
+    if (failed < chunks) {
+        context.fail(errors[failed]);
+        return 0.0;
     }
+    return reducePairwise(sums.data(), chunks).value();
+}
+
+Extrapolation::Result MathEngine::estimateSeries(const CompiledExpression& expr, int start,
+                                                 EvalContext& context, const double* variables) const {
+    if (!expr.isValid()) { context.fail(expr); return Extrapolation::Result(); }
     
-    return sum * h / 3.0;
+    // Terms come in batches until an estimate is as good as rounding allows
+    const size_t batch = 16, maxTerms = Extrapolation::MaxTerms;
+    double xs[maxTerms];
+    double terms[maxTerms];
+    double sums[maxTerms];
+    ErrorMask errors;
+    CompensatedSum sum;
+    double scale = 0.0;
+    Extrapolation::Result best;
+    best.error = std::numeric_limits<double>::infinity();
+    size_t count = 0;
+    while (count < maxTerms) {
+        for (size_t i = 0; i < batch; i++) xs[count + i] = (double)start + (double)(count + i);
+        errors.reset(batch);
+        runBatch(expr, xs + count, terms + count, batch, errors, variables);
+        if (errors.any()) {
+            context.fail(errors.error(errors.first()));
+            return Extrapolation::Result();
+        }
+        for (size_t i = count; i < count + batch; i++) {
+            sum.add(terms[i]);
+            sums[i] = sum.value();
+            if (std::isfinite(sums[i])) scale = std::max(scale, std::abs(sums[i]));
+        }
+        count += batch;
+        
+        // A converged estimate beats any that is not
+        Extrapolation::Result result = Extrapolation::series(terms, sums, count, extrapolationTolerance);
+        if (result.converged > best.converged
+            || (result.converged == best.converged && result.error < best.error)) best = result;
+        if (best.converged && best.error <= 16.0 * std::numeric_limits<double>::epsilon() * scale) break;
+    }
+    best.evaluations = count;
+    if (!best.converged) context.fail(MathError::NoConvergence);
+    return best;
 }
 
-double MathEngine::limit(const std::string& expr, double point, bool fromRight) {
-    double h = 1e-7;
-    double val = evaluate(expr, point + (fromRight ? h : -h));
-    return val;
+double MathEngine::sumNode(const CompiledExpression& body, double lower, double upper,
+                           EvalContext& context, const double* variables) const {
+    // Bounds are truncated to ints; an upper bound of inf sums the series
+    const double largest = std::numeric_limits<int>::max();
+    if (!(std::abs(lower) <= largest) || !(upper >= -largest)) {
+        context.fail(MathError::InvalidSumBounds);
+        return 0.0;
+    }
+    if (upper == std::numeric_limits<double>::infinity()) {
+        Extrapolation::Result result = estimateSeries(body, (int)lower, context, variables);
+        return context.failed() ? 0.0 : result.value;
+    }
+    if (!(upper <= largest)) {
+        context.fail(MathError::InvalidSumBounds);
+        return 0.0;
+    }
+    return summation(body, (int)lower, (int)upper, context, variables);
 }
 
-double MathEngine::summation(const std::string& expr, int start, int end) {
-    double total = 0.0;
-    for (int i = start; i <= end; i++) {
-        total += evaluate(expr, (double)i);
-        if (hasError()) return 0.0;
+double MathEngine::solve(const CompiledExpression& expr, double lower, double upper, EvalContext& context,
+                         const double* variables) const {
+    RootFinding::Result result = findRoot(expr, lower, upper, RootFinding::Method::Newton, context, variables);
+    return context.failed() ? 0.0 : result.root;
+}
+
+RootFinding::Result MathEngine::findRoot(const CompiledExpression& expr, double lower, double upper,
+                                         RootFinding::Method method, EvalContext& context,
+                                         const double* variables) const {
+    if (!expr.isValid()) { context.fail(expr); return RootFinding::Result(); }
+    if (!std::isfinite(lower) || !std::isfinite(upper)) {
+        context.fail(MathError::InvalidInterval);
+        return RootFinding::Result();
+    }
+    if (lower > upper) std::swap(lower, upper);
+    
+    // A sign change over the bounds needs a few evaluations, a scan a thousand
+    std::vector<RootFinding::Bracket> brackets;
+    size_t evaluations = 2;
+    const double ends[2] = { lower, upper };
+    double values[2];
+    ErrorMask errors;
+    errors.reset(2);
+    runBatch(expr, ends, values, 2, errors, variables);
+    for (size_t i = 0; i < 2; ++i) {
+        if (errors.test(i)) values[i] = std::numeric_limits<double>::quiet_NaN();
     }
-    return total;
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 0) {
+            RootFinding::findBrackets(ends, values, 2, brackets);
+        } else {
+            std::vector<double> xs(RootFinding::ScanPoints), ys(RootFinding::ScanPoints);
+            scan(expr, lower, upper, xs.data(), ys.data(), variables);
+            evaluations += RootFinding::ScanPoints;
+            RootFinding::findBrackets(xs.data(), ys.data(), xs.size(), brackets);
+        }
+        for (const RootFinding::Bracket& bracket : brackets) {
+            RootFinding::Result result = refineRoot(expr, bracket, method, variables);
+            evaluations += result.evaluations;
+            if (RootFinding::isRoot(result, bracket)) {
+                result.evaluations = evaluations;
+                return result;
+            }
+        }
+    }
+    context.fail(MathError::NoRoot);
+    RootFinding::Result result;
+    result.evaluations = evaluations;
+    result.failure = MathError::NoRoot;
+    return result;
+}
+
+std::vector<RootFinding::Result> MathEngine::findRoots(const CompiledExpression& expr, double lower, double upper,
+                                                       RootFinding::Method method, EvalContext& context,
+                                                       const double* variables) const {
+    std::vector<RootFinding::Result> roots;
+    if (!expr.isValid()) { context.fail(expr); return roots; }
+    if (!std::isfinite(lower) || !std::isfinite(upper)) {
+        context.fail(MathError::InvalidInterval);
+        return roots;
+    }
+    if (lower > upper) std::swap(lower, upper);
+    
+    std::vector<double> xs(RootFinding::ScanPoints), ys(RootFinding::ScanPoints);
+    scan(expr, lower, upper, xs.data(), ys.data(), variables);
+    std::vector<RootFinding::Bracket> brackets;
+    RootFinding::findBrackets(xs.data(), ys.data(), xs.size(), brackets);
+    
+    // Brackets are refined by index and collected in order, so poles and
+    // jumps drop out the same way for any number of threads
+    std::vector<RootFinding::Result> results(brackets.size());
+    auto refineBracket = [&](size_t i) { results[i] = refineRoot(expr, brackets[i], method, variables); };
+    ThreadPool::shared().forEach(brackets.size(), refineBracket);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (RootFinding::isRoot(results[i], brackets[i])) roots.push_back(results[i]);
+    }
+    return roots;
+}
+
+RootFinding::Result MathEngine::refineRoot(const CompiledExpression& expr, const RootFinding::Bracket& bracket,
+                                           RootFinding::Method method, const double* variables) const {
+    struct Equation {
+        const MathEngine* engine;
+        const CompiledExpression* expr;
+        const double* variables;
+    } equation{ this, &expr, variables };
+    // The slope comes exactly from a first-order Taylor pass
+    auto evaluate = [](void* state, double x, double* value, double* slope) {
+        auto& equation = *static_cast<Equation*>(state);
+        EvalContext context;
+        if (slope) {
+            const double point[2] = { x, 1.0 };
+            double series[2];
+            equation.engine->runTaylor(*equation.expr, point, 1, series, context, equation.variables);
+            *value = series[0];
+            *slope = series[1];
+        } else {
+            *value = equation.engine->run(*equation.expr, x, context, equation.variables);
+        }
+        return context.getErrorCode();
+    };
+    return RootFinding::refine(evaluate, &equation, bracket, method);
+}
+
+void MathEngine::scan(const CompiledExpression& expr, double lower, double upper, double* xs, double* ys,
+                      const double* variables) const {
+    const size_t count = RootFinding::ScanPoints;
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = i + 1 == count ? upper : lower + (upper - lower) * static_cast<double>(i) / static_cast<double>(count - 1);
+    }
+    const size_t cost = expr.size() * (expr.hasCalculus() ? CalculusCost : 1);
+    const size_t pieces = std::max<size_t>(1, std::min(count, count * cost / ParallelWork));
+    auto runPiece = [&](size_t piece) {
+        const size_t begin = count * piece / pieces, end = count * (piece + 1) / pieces;
+        ErrorMask mask;
+        mask.reset(end - begin);
+        runBatch(expr, xs + begin, ys + begin, end - begin, mask, variables);
+        for (size_t i = begin; i < end; ++i) {
+            if (mask.test(i - begin)) ys[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+    };
+    ThreadPool::shared().forEach(pieces, runPiece);
+}
+
+Ode::Solution MathEngine::solveOde(const CompiledExpression& expr, double x0, double y0, double x1,
+                                   const Ode::Tolerance& tolerance, EvalContext& context) const {
+    if (!expr.isValid()) { context.fail(expr); return Ode::Solution(); }
+    if (expr.getVariableCount() != 2) {
+        context.fail(MathError::MissingVariables);
+        return Ode::Solution();
+    }
+    if (!std::isfinite(x0) || !std::isfinite(x1)) {
+        context.fail(MathError::InvalidInterval);
+        return Ode::Solution();
+    }
+    
+    struct Equation {
+        const MathEngine* engine;
+        const CompiledExpression* expr;
+    } equation{ this, &expr };
+    auto evaluate = [](void* state, double x, double y, double* value) {
+        auto& equation = *static_cast<Equation*>(state);
+        EvalContext context;
+        const double variables[2] = { x, y };
+        *value = equation.engine->run(*equation.expr, x, context, variables);
+        return context.getErrorCode();
+    };
+    Ode::Solution solution = Ode::solve(evaluate, &equation, x0, y0, x1, tolerance);
+    if (solution.failure != MathError::None) context.fail(solution.failure);
+    return solution;
+}
+
+double MathEngine::odeNode(const CompiledExpression& body, std::uint16_t slot, double x0, double y0, double x1,
+                           EvalContext& context, const double* variables, double* slope) const {
+    if (!std::isfinite(x0) || !std::isfinite(x1)) {
+        context.fail(MathError::InvalidInterval);
+        return 0.0;
+    }
+    
+    // The body sees the variables around it with y appended
+    struct Equation {
+        const MathEngine* engine;
+        const CompiledExpression* body;
+        std::vector<double> variables;
+        std::uint16_t slot;
+    } equation{ this, &body, std::vector<double>(slot + 1, 0.0), slot };
+    if (variables) std::copy(variables, variables + slot, equation.variables.begin());
+    auto evaluate = [](void* state, double x, double y, double* value) {
+        auto& equation = *static_cast<Equation*>(state);
+        EvalContext context;
+        equation.variables[equation.slot] = y;
+        *value = equation.engine->run(*equation.body, x, context, equation.variables.data());
+        return context.getErrorCode();
+    };
+    Ode::Solution solution = Ode::solve(evaluate, &equation, x0, y0, x1, odeTolerance);
+    if (solution.failure != MathError::None) {
+        context.fail(solution.failure);
+        return 0.0;
+    }
+    if (slope) {
+        MathError error = evaluate(&equation, x1, solution.value, slope);
+        if (error != MathError::None) context.fail(error);
+    }
+    return solution.value;
+}
+
+MathError MathEngine::runParallel(const CompiledExpression& program, const double* xs, double* out,
+                                  size_t count, const double* variables) const {
+    const size_t cost = program.size() * (program.hasCalculus() ? CalculusCost : 1);
+    const size_t pieces = std::min(count, count * cost / ParallelWork);
+    if (pieces < 2) {
+        ErrorMask mask;
+        mask.reset(count);
+        runBatch(program, xs, out, count, mask, variables);
+        return mask.any() ? mask.error(mask.first()) : MathError::None;
+    }
+    
+    std::vector<MathError> errors(pieces, MathError::None);
+    auto runPiece = [&](size_t piece) {
+        const size_t begin = count * piece / pieces, end = count * (piece + 1) / pieces;
+        ErrorMask mask;
+        mask.reset(end - begin);
+        runBatch(program, xs + begin, out + begin, end - begin, mask, variables);
+        if (mask.any()) errors[piece] = mask.error(mask.first());
+    };
+    ThreadPool::shared().forEach(pieces, runPiece);
+    for (MathError error : errors) {
+        if (error != MathError::None) return error;
+    }
+    return MathError::None;
+}
+
+void MathEngine::setThreadCount(size_t threads) {
+    ThreadPool::shared().setThreadCount(threads);
+}
+
+size_t MathEngine::getThreadCount() const {
+    return ThreadPool::shared().getThreadCount();
 }
 
 // Memory operations
@@ -227,271 +703,742 @@ double MathEngine::evaluate(const std::string& expression) {
 }
 
 double MathEngine::evaluate(const std::string& expression, double x) {
-    clearError();
-    try {
-        // Simple variable substitution for 'x'
-        // Note: This is a basic implementation. A robust one would pass x to parseExpression.
-        // For now, we'll use a member variable or pass it down.
-        // Let's modify parseFactor to handle 'x'.
-        this->currentX = x; 
-        return parseExpression(expression);
-    } catch (const std::exception& e) {
-        setError(e.what());
+    return evaluate(compileCached(expression), x);
+}
+
+double MathEngine::evaluate(const CompiledExpression& expression, double x) {
+    EvalContext context;
+    double result = evaluate(expression, x, context);
+    report(context);
+    return result;
+}
+
+double MathEngine::evaluate(const CompiledExpression& expression, double x, EvalContext& context) const {
+    if (!expression.isValid()) {
+        context.fail(expression);
         return 0.0;
     }
+    double result = run(expression, x, context);
+    return context.failed() ? 0.0 : result;
 }
 
-void MathEngine::skipWhitespace(const std::string& expr, size_t& pos) {
-    while (pos < expr.length() && std::isspace(expr[pos])) {
-        ++pos;
+std::string MathEngine::evaluateBig(const std::string& expression) {
+    BigEvaluator evaluator(expression, bigPrecision, &definitions);
+    std::string result;
+    if (evaluator.evaluate(result)) {
+        lastError = MathError::None;
+        return result;
     }
+    lastError = evaluator.getErrorCode();
+    if (isParseError(lastError)) lastParseError = evaluator.getError();
+    return std::string();
 }
 
-double MathEngine::parseNumber(const std::string& expr, size_t& pos) {
-    skipWhitespace(expr, pos);
-    size_t start = pos;
-    
-    if (pos < expr.length() && (expr[pos] == '+' || expr[pos] == '-')) {
-        ++pos;
+bool MathEngine::evaluateRational(const std::string& expression, Rational& result) {
+    if (rationalEvaluator.evaluate(expression, &definitions, result)) {
+        lastError = MathError::None;
+        return true;
     }
-    
-    while (pos < expr.length() && (std::isdigit(expr[pos]) || expr[pos] == '.')) {
-        ++pos;
+    lastError = rationalEvaluator.getErrorCode();
+    if (isParseError(lastError)) lastParseError = rationalEvaluator.getError();
+    return false;
+}
+
+void MathEngine::evaluateBatch(const CompiledExpression& expression, const double* xs, double* out,
+                               size_t count, ErrorMask& errors) const {
+    errors.reset(count);
+    if (!expression.isValid()) {
+        errors.setAll(expression);
+        std::fill(out, out + count, 0.0);
+        return;
     }
+    runBatch(expression, xs, out, count, errors);
+}
+
+Interval MathEngine::evaluate(const CompiledExpression& expression, const Interval& x) const {
+    if (!expression.isValid()) return Interval::none();
     
-    if (pos == start || (pos == start + 1 && !std::isdigit(expr[start]))) {
-        throw std::runtime_error("Invalid number format");
+    Interval localValues[64];
+    std::vector<Interval> heapValues;
+    Interval* values = localValues;
+    if (expression.nodes.size() > 64) {
+        heapValues.resize(expression.nodes.size());
+        values = heapValues.data();
     }
     
-    return std::stod(expr.substr(start, pos - start));
+    for (size_t i = 0; i < expression.nodes.size(); ++i) {
+        const ExpressionNode& node = expression.nodes[i];
+        const Interval& a = values[node.lhs];
+        const Interval& b = values[node.rhs];
+        Interval& result = values[i];
+        
+        switch (node.op) {
+            case OpCode::Constant:   result = Interval(node.value); break;
+            case OpCode::VariableX:  result = x; break;
+            case OpCode::Add:        result = IntervalMath::add(a, b); break;
+            // x * x, x - x and x / x after CSE; the general rules would not
+            // know both sides are the same x
+            case OpCode::Subtract:
+                result = node.lhs == node.rhs ? IntervalMath::selfDifference(a) : IntervalMath::subtract(a, b);
+                break;
+            case OpCode::Multiply:
+                result = node.lhs == node.rhs ? IntervalMath::square(a) : IntervalMath::multiply(a, b);
+                break;
+            case OpCode::Divide:
+                result = node.lhs == node.rhs ? IntervalMath::selfQuotient(a) : IntervalMath::divide(a, b);
+                break;
+            case OpCode::Modulo:     result = IntervalMath::modulo(a, b); break;
+            case OpCode::Power:      result = IntervalMath::power(a, b); break;
+            case OpCode::Negate:     result = IntervalMath::negate(a); break;
+            case OpCode::Reciprocal: result = IntervalMath::reciprocal(a); break;
+            case OpCode::Function:
+                result = IntervalMath::function(node.function, a, b, values[node.third]);
+                break;
+            default:                 result = Interval::entire(); break;
+        }
+    }
+    return values[expression.nodes.size() - 1];
 }
 
-double MathEngine::parseFactor(const std::string& expr, size_t& pos) {
-    skipWhitespace(expr, pos);
+double MathEngine::evaluate(const CompiledExpression& expression, const double* variables, size_t count,
+                            EvalContext& context) const {
+    if (!expression.isValid()) {
+        context.fail(expression);
+        return 0.0;
+    }
+    if (count != expression.getVariableCount()) {
+        context.fail(MathError::MissingVariables);
+        return 0.0;
+    }
+    // Programs with named variables never read x
+    double result = run(expression, variables[0], context, variables);
+    return context.failed() ? 0.0 : result;
+}
+
+double MathEngine::gradient(const CompiledExpression& expression, const double* variables, size_t count,
+                            double* gradient, GradientTape& tape, EvalContext& context) const {
+    std::fill(gradient, gradient + count, 0.0);
+    if (!expression.isValid()) {
+        context.fail(expression);
+        return 0.0;
+    }
+    if (count != expression.getVariableCount()) {
+        context.fail(MathError::MissingVariables);
+        return 0.0;
+    }
     
-    // Handle parentheses
-    if (pos < expr.length() && expr[pos] == '(') {
-        ++pos;
-        double result = parseExpression(expr.substr(pos));
-        // Find matching closing parenthesis
-        int depth = 1;
-        size_t start = pos;
-        while (pos < expr.length() && depth > 0) {
-            if (expr[pos] == '(') ++depth;
-            if (expr[pos] == ')') --depth;
-            ++pos;
+    // Forward sweep: values and local partial derivatives
+    const std::vector<ExpressionNode>& nodes = expression.nodes;
+    tape.resize(nodes.size());
+    double* values = tape.values.data();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const ExpressionNode& node = nodes[i];
+        const double a = values[node.lhs];
+        const double b = values[node.rhs];
+        const double c = values[node.third];
+        double& result = values[i];
+        double* partial = &tape.partials[i * 3];
+        // The tape has no partials of a body's result by the variables it reads
+        if (node.op >= OpCode::Derivative && expression.bodies[node.body].readsVariables()) {
+            context.fail(MathError::NoGradient);
+            return 0.0;
         }
-        size_t subexprPos = 0;
-        result = parseExpression(expr.substr(start, pos - start - 1));
-        return result;
+        
+        switch (node.op) {
+            case OpCode::Constant:  result = node.value; break;
+            case OpCode::VariableX: result = variables[0]; break;
+            case OpCode::Variable:  result = variables[node.variable]; break;
+            case OpCode::Add:
+                result = a + b;
+                partial[0] = 1.0;
+                partial[1] = 1.0;
+                break;
+            case OpCode::Subtract:
+                result = a - b;
+                partial[0] = 1.0;
+                partial[1] = -1.0;
+                break;
+            case OpCode::Multiply:
+                result = a * b;
+                partial[0] = b;
+                partial[1] = a;
+                break;
+            case OpCode::Divide:
+                if (b == 0.0) {
+                    context.fail(MathError::DivisionByZero);
+                    break;
+                }
+                result = a / b;
+                partial[0] = 1.0 / b;
+                partial[1] = -result / b;
+                break;
+            case OpCode::Modulo:
+                if (b == 0.0) {
+                    context.fail(MathError::ModuloByZero);
+                    break;
+                }
+                result = std::fmod(a, b);
+                partial[0] = 1.0;
+                partial[1] = -std::round((a - result) / b);
+                break;
+            case OpCode::Negate:
+                result = -a;
+                partial[0] = -1.0;
+                break;
+            case OpCode::Reciprocal:
+                result = 1.0 / a;
+                partial[0] = -result * result;
+                break;
+            case OpCode::Power:
+            case OpCode::Function: {
+                // The first-order Taylor rules give one partial per pass
+                if (node.op == OpCode::Function) {
+                    const Builtins::Info& builtin = Builtins::get(node.function);
+                    MathError error = builtin.domain ? builtin.domain(a, b, c) : MathError::None;
+                    if (error != MathError::None) {
+                        context.fail(error);
+                        break;
+                    }
+                }
+                double series[2];
+                const double withA[2] = { a, 1.0 }, fixedA[2] = { a, 0.0 };
+                const double withB[2] = { b, 1.0 }, fixedB[2] = { b, 0.0 };
+                const double fixedC[2] = { c, 0.0 };
+                if (node.op == OpCode::Power) {
+                    partial[1] = 0.0;
+                    if (nodes[node.rhs].op != OpCode::Constant) {
+                        TaylorMath::power(fixedA, withB, series, 1);
+                        partial[1] = series[1];
+                    }
+                    TaylorMath::power(withA, fixedB, series, 1);
+                    partial[0] = series[1];
+                } else {
+                    // Multi-argument built-ins (nCr, nPr) truncate theirs: flat
+                    TaylorMath::function(node.function, withA, fixedB, fixedC, series, 1);
+                    partial[0] = series[1];
+                    partial[1] = 0.0;
+                    partial[2] = 0.0;
+                }
+                result = series[0];
+                break;
+            }
+            case OpCode::Derivative: {
+                // f'(a) and f''(a) from one second-order pass
+                const double point[3] = { a, 1.0, 0.0 };
+                double series[3];
+                runTaylor(expression.bodies[node.body], point, 2, series, context);
+                result = series[1];
+                partial[0] = 2.0 * series[2];
+                break;
+            }
+            case OpCode::Limit: {
+                const double point[2] = { a, 1.0 };
+                double series[2];
+                limitTaylor(expression.bodies[node.body], point, 1, series, context, nullptr);
+                result = series[0];
+                partial[0] = series[1];
+                break;
+            }
+            case OpCode::Integral: {
+                // d/da = -f(a), d/db = f(b); an integrable singularity at a bound has none
+                const CompiledExpression& body = expression.bodies[node.body];
+                result = integral(body, a, b, context);
+                EvalContext atLower, atUpper;
+                const double lower = run(body, a, atLower), upper = run(body, b, atUpper);
+                partial[0] = atLower.failed() ? std::numeric_limits<double>::quiet_NaN() : -lower;
+                partial[1] = atUpper.failed() ? std::numeric_limits<double>::quiet_NaN() : upper;
+                break;
+            }
+            case OpCode::Summation:
+                result = sumNode(expression.bodies[node.body], a, b, context, nullptr);
+                partial[0] = 0.0;
+                partial[1] = 0.0;
+                break;
+            case OpCode::Solve:
+                // Moving the bounds does not move the root they enclose
+                result = solve(expression.bodies[node.body], a, b, context);
+                partial[0] = 0.0;
+                partial[1] = 0.0;
+                break;
+            case OpCode::Ode: {
+                // d/dx1 = f(x1, y(x1)); x0 and y0 would need the variational equation
+                double slope = 0.0;
+                result = odeNode(expression.bodies[node.body], node.variable, a, b, c, context, nullptr, &slope);
+                partial[0] = std::numeric_limits<double>::quiet_NaN();
+                partial[1] = std::numeric_limits<double>::quiet_NaN();
+                partial[2] = slope;
+                break;
+            }
+        }
+        if (context.failed()) return 0.0;
+    }
+    
+    // Backward sweep: adjoints flow from each node to its operands, and from
+    // the variables into the gradient
+    double* adjoints = tape.adjoints.data();
+    adjoints[nodes.size() - 1] = 1.0;
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const double adjoint = adjoints[i];
+        if (adjoint == 0.0) continue;
+        const ExpressionNode& node = nodes[i];
+        const double* partial = &tape.partials[i * 3];
+        const int operands = ExpressionOptimizer::operandCount(node);
+        if (operands > 0) adjoints[node.lhs] += adjoint * partial[0];
+        if (operands > 1) adjoints[node.rhs] += adjoint * partial[1];
+        if (operands > 2) adjoints[node.third] += adjoint * partial[2];
+        if (node.op == OpCode::Variable) gradient[node.variable] += adjoint;
+        else if (node.op == OpCode::VariableX) gradient[0] += adjoint;
+    }
+    return values[nodes.size() - 1];
+}
+
+CompiledExpression MathEngine::compile(const std::string& expression) const {
+    return compile(expression, {});
+}
+
+CompiledExpression MathEngine::compile(const std::string& expression, const std::vector<std::string>& variables) const {
+    CompiledExpression program;
+    program.source = expression;
+    program.variables = variables;
+    for (std::string& name : program.variables) {
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    }
+    ExpressionParser parser(program.source, angleMode, &definitions,
+                            program.variables.empty() ? nullptr : &program.variables);
+    if (parser.parse(program)) {
+        ExpressionOptimizer::optimize(program);
+    } else {
+        program.nodes.clear();
+        program.bodies.clear();
+    }
+    return program;
+}
+
+const CompiledExpression& MathEngine::compileCached(const std::string& expression) {
+    ExpressionCache::normalize(expression, cacheKey);
+    if (const CompiledExpression* cached = cache.find(cacheKey)) {
+        return *cached;
+    }
+    return cache.insert(cacheKey, compile(expression));
+}
+
+void MathEngine::setAngleMode(AngleMode mode) {
+    if (mode == angleMode) return;
+    angleMode = mode;
+    cache.invalidateIf([](const CompiledExpression& e) { return e.dependsOnAngleMode(); });
+}
+
+void MathEngine::define(const std::string& name, double value) {
+    std::string key = name;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    auto found = definitions.find(key);
+    if (found != definitions.end() && found->second == value) return; // ans is often defined again unchanged
+    definitions[key] = value;
+    invalidateDefinitions();
+}
+
+void MathEngine::undefine(const std::string& name) {
+    std::string key = name;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    if (definitions.erase(key) > 0) invalidateDefinitions();
+}
+
+void MathEngine::invalidateDefinitions() {
+    ++definitionsGeneration;
+    // Programs that failed on an unknown name may compile now
+    cache.invalidateIf([](const CompiledExpression& e) { return !e.isValid() || e.dependsOnDefinitions(); });
+}
+
+double MathEngine::run(const CompiledExpression& program, double x, EvalContext& context,
+                       const double* variables) const {
+    // Small programs (the common case) keep their intermediate values on the stack
+    double localValues[64];
+    std::vector<double> heapValues;
+    double* values = localValues;
+    if (program.nodes.size() > 64) {
+        heapValues.resize(program.nodes.size());
+        values = heapValues.data();
     }
     
-    // Handle functions and variables
-    if (pos < expr.length() && std::isalpha(expr[pos])) {
-        size_t start = pos;
-        while (pos < expr.length() && std::isalpha(expr[pos])) {
-            ++pos;
+    // Hot programs run as native code; it hands errors back to the interpreter
+    if (jitThreshold > 0) {
+        const JitFunction* native = program.native.get();
+        if (!native && program.native.countEvaluation(jitThreshold)) {
+            program.native.publish(JitCompiler::compile(program));
+            native = program.native.get();
         }
-        std::string funcName = expr.substr(start, pos - start);
-        skipWhitespace(expr, pos);
-        
-        // Check for variable 'x'
-        if (funcName == "x" || funcName == "X") {
-            return currentX;
+        if (native && native->run(x, values)) {
+            return values[program.nodes.size() - 1];
         }
+    }
+    
+    for (size_t i = 0; i < program.nodes.size(); ++i) {
+        const ExpressionNode& node = program.nodes[i];
+        double result = 0.0;
         
-        if (pos >= expr.length() || expr[pos] != '(') {
-            // Constants
-            if (funcName == "pi" || funcName == "PI") return PI;
-            if (funcName == "e" || funcName == "E") return E;
-            throw std::runtime_error("Expected '(' after function name");
+        switch (node.op) {
+            case OpCode::Constant:  result = node.value; break;
+            case OpCode::VariableX: result = x; break;
+            case OpCode::Variable:
+                if (!variables) context.fail(MathError::MissingVariables);
+                else result = variables[node.variable];
+                break;
+            case OpCode::Add:       result = values[node.lhs] + values[node.rhs]; break;
+            case OpCode::Subtract:  result = values[node.lhs] - values[node.rhs]; break;
+            case OpCode::Multiply:  result = values[node.lhs] * values[node.rhs]; break;
+            case OpCode::Divide:
+                if (values[node.rhs] == 0.0) context.fail(MathError::DivisionByZero);
+                else result = values[node.lhs] / values[node.rhs];
+                break;
+            case OpCode::Modulo:
+                if (values[node.rhs] == 0.0) context.fail(MathError::ModuloByZero);
+                else result = std::fmod(values[node.lhs], values[node.rhs]);
+                break;
+            case OpCode::Power:     result = std::pow(values[node.lhs], values[node.rhs]); break;
+            case OpCode::Negate:    result = -values[node.lhs]; break;
+            case OpCode::Reciprocal: result = 1.0 / values[node.lhs]; break;
+            case OpCode::Function:
+                result = applyFunction(node.function, values[node.lhs], values[node.rhs], values[node.third], context);
+                break;
+            case OpCode::Derivative:
+                result = derivative(program.bodies[node.body], values[node.lhs], context, variables);
+                break;
+            case OpCode::Limit:
+                result = limit(program.bodies[node.body], values[node.lhs], true, context, variables);
+                break;
+            case OpCode::Integral:
+                result = integral(program.bodies[node.body], values[node.lhs], values[node.rhs], context, variables);
+                break;
+            case OpCode::Summation:
+                result = sumNode(program.bodies[node.body], values[node.lhs], values[node.rhs], context, variables);
+                break;
+            case OpCode::Solve:
+                result = solve(program.bodies[node.body], values[node.lhs], values[node.rhs], context, variables);
+                break;
+            case OpCode::Ode:
+                result = odeNode(program.bodies[node.body], node.variable, values[node.lhs], values[node.rhs],
+                                 values[node.third], context, variables);
+                break;
         }
         
-        ++pos; // Skip '('
-        
-        // Handle multi-argument functions (diff, int, sum, lim)
-        std::string lowerFunc = funcName;
-        std::transform(lowerFunc.begin(), lowerFunc.end(), lowerFunc.begin(), ::tolower);
+        if (context.failed()) return 0.0;
+        values[i] = result;
+    }
+    
+    return program.nodes.empty() ? 0.0 : values[program.nodes.size() - 1];
+}
+
+void MathEngine::runBatch(const CompiledExpression& program, const double* xs, double* out,
+                          size_t count, ErrorMask& errors, const double* variables) const {
+    // Node values are kept column by column: values[node * BatchLanes + lane]
+    constexpr size_t BatchLanes = 256;
+    const size_t lanesPerBlock = std::min(count, BatchLanes);
+    std::vector<double> values(program.nodes.size() * lanesPerBlock);
+    
+    // Nodes that do not depend on x are computed once, as a single lane of
+    // the first block, and keep their column; their error is given to every
+    // lane when the node comes up, so lanes still keep their first error
+    std::vector<MathError> invariantErrors(program.nodes.size(), MathError::None);
+    ErrorMask invariantMask;
+    size_t hoisted = 0;
+    
+    for (size_t block = 0; block < count; block += BatchLanes) {
+        const size_t blockLanes = std::min(BatchLanes, count - block);
+        const double* x = xs + block;
         
-        if (lowerFunc == "diff" || lowerFunc == "int" || lowerFunc == "sum" || lowerFunc == "lim") {
-            // Parse first argument as string expression (until comma)
-            size_t startArg = pos;
-            int parenDepth = 0;
-            while (pos < expr.length()) {
-                if (expr[pos] == '(') parenDepth++;
-                if (expr[pos] == ')') {
-                    if (parenDepth == 0) break;
-                    parenDepth--;
-                }
-                if (expr[pos] == ',' && parenDepth == 0) break;
-                pos++;
-            }
-            
-            std::string subExpr = expr.substr(startArg, pos - startArg);
-            
-            if (pos >= expr.length() || expr[pos] != ',') throw std::runtime_error("Expected ','");
-            pos++; // Skip ','
-            
-            double arg2 = parseExpression(expr.substr(pos)); // This might consume too much if there are more args
-            // Actually, we need to parse strictly until next comma or end paren
-            // Let's simplify: assume parseExpression stops at comma or paren? No it doesn't.
-            // We need a parseArgument helper or just manually parse numbers for now.
-            // For simplicity, let's assume arguments 2, 3 are simple numbers or expressions that parseFactor can handle?
-            // No, parseExpression consumes until end of string or unmatched operator.
-            // We need to implement a robust argument parser. 
-            
-            // RE-IMPLEMENTATION for robustness:
-            // We will recursively call parseExpression but we need to make sure it stops at comma.
-            // Since parseExpression calls parseTerm -> parseFactor, we can't easily change stop condition without big refactor.
-            // Hack: Extract the substring for the argument.
+        for (size_t i = 0; i < program.nodes.size(); ++i) {
+            const ExpressionNode& node = program.nodes[i];
+            double* result = &values[i * lanesPerBlock];
+            const double* a = &values[node.lhs * lanesPerBlock];
+            const double* b = &values[node.rhs * lanesPerBlock];
+            const double* c = &values[node.third * lanesPerBlock];
             
-            // Find end of second argument
-            startArg = pos;
-            parenDepth = 0;
-            while (pos < expr.length()) {
-                if (expr[pos] == '(') parenDepth++;
-                if (expr[pos] == ')') {
-                    if (parenDepth == 0) break;
-                    parenDepth--;
+            size_t first = block, lanes = blockLanes;
+            if (node.invariant) {
+                if (block == 0) {
+                    invariantMask.reset(1);
+                    first = 0;
+                    lanes = 1;
+                    if (node.op != OpCode::Constant) hoisted++;
+                } else {
+                    if (invariantErrors[i] != MathError::None) {
+                        for (size_t l = 0; l < blockLanes; ++l) errors.set(block + l, invariantErrors[i]);
+                    }
+                    continue;
                 }
-                if (expr[pos] == ',' && parenDepth == 0) break;
-                pos++;
             }
-            std::string arg2Str = expr.substr(startArg, pos - startArg);
-            double val2 = evaluate(arg2Str, currentX); // Evaluate arg2 (limits/bounds)
+            ErrorMask& laneErrors = node.invariant ? invariantMask : errors;
             
-            if (lowerFunc == "diff" || lowerFunc == "lim") {
-                if (pos >= expr.length() || expr[pos] != ')') throw std::runtime_error("Expected ')'");
-                pos++;
-                if (lowerFunc == "diff") return derivative(subExpr, val2);
-                else return limit(subExpr, val2);
+            switch (node.op) {
+                case OpCode::Constant:
+                    std::fill(result, result + lanes, node.value);
+                    break;
+                case OpCode::VariableX:
+                    std::copy(x, x + lanes, result);
+                    break;
+                case OpCode::Variable:
+                    if (variables) {
+                        std::fill(result, result + lanes, variables[node.variable]);
+                        break;
+                    }
+                    std::fill(result, result + lanes, 0.0);
+                    for (size_t l = 0; l < lanes; ++l) laneErrors.set(first + l, MathError::MissingVariables);
+                    break;
+                case OpCode::Add:
+                    for (size_t l = 0; l < lanes; ++l) result[l] = a[l] + b[l];
+                    break;
+                case OpCode::Subtract:
+                    for (size_t l = 0; l < lanes; ++l) result[l] = a[l] - b[l];
+                    break;
+                case OpCode::Multiply:
+                    for (size_t l = 0; l < lanes; ++l) result[l] = a[l] * b[l];
+                    break;
+                case OpCode::Divide:
+                    for (size_t l = 0; l < lanes; ++l) result[l] = a[l] / b[l];
+                    for (size_t l = 0; l < lanes; ++l) {
+                        if (b[l] == 0.0) laneErrors.set(first + l, MathError::DivisionByZero);
+                    }
+                    break;
+                case OpCode::Modulo:
+                    for (size_t l = 0; l < lanes; ++l) {
+                        if (b[l] == 0.0) {
+                            laneErrors.set(first + l, MathError::ModuloByZero);
+                            result[l] = 0.0;
+                        } else {
+                            result[l] = std::fmod(a[l], b[l]);
+                        }
+                    }
+                    break;
+                case OpCode::Power:
+                    SimdMath::pow(a, b, result, lanes);
+                    break;
+                case OpCode::Negate:
+                    for (size_t l = 0; l < lanes; ++l) result[l] = -a[l];
+                    break;
+                case OpCode::Reciprocal:
+                    for (size_t l = 0; l < lanes; ++l) result[l] = 1.0 / a[l];
+                    break;
+                case OpCode::Function: {
+                    const Builtins::Info& builtin = Builtins::get(node.function);
+                    if (SimdMath::Kernel kernel = SimdMath::find(node.function)) {
+                        // Vector kernels handle any argument; lanes outside the domain are overwritten
+                        kernel(a, result, lanes);
+                        if (!builtin.domain) break;
+                        for (size_t l = 0; l < lanes; ++l) {
+                            MathError error = builtin.domain(a[l], b[l], c[l]);
+                            if (error != MathError::None) {
+                                laneErrors.set(first + l, error);
+                                result[l] = 0.0;
+                            }
+                        }
+                        break;
+                    }
+                    if (!builtin.domain) {
+                        for (size_t l = 0; l < lanes; ++l) result[l] = builtin.function(a[l], b[l], c[l]);
+                        break;
+                    }
+                    // Kernels are only called inside their domain (fact loops up to its argument)
+                    for (size_t l = 0; l < lanes; ++l) {
+                        MathError error = builtin.domain(a[l], b[l], c[l]);
+                        if (error != MathError::None) {
+                            laneErrors.set(first + l, error);
+                            result[l] = 0.0;
+                        } else {
+                            result[l] = builtin.function(a[l], b[l], c[l]);
+                        }
+                    }
+                    break;
+                }
+                case OpCode::Derivative:
+                case OpCode::Integral:
+                case OpCode::Limit:
+                case OpCode::Summation:
+                case OpCode::Solve:
+                case OpCode::Ode:
+                    // Each lane is a whole numeric method of its own; run them one by one
+                    for (size_t l = 0; l < lanes; ++l) {
+                        result[l] = 0.0;
+                        if (laneErrors.test(first + l)) continue;
+                        EvalContext context;
+                        const CompiledExpression& body = program.bodies[node.body];
+                        switch (node.op) {
+                            case OpCode::Derivative: result[l] = derivative(body, a[l], context, variables); break;
+                            case OpCode::Limit:      result[l] = limit(body, a[l], true, context, variables); break;
+                            case OpCode::Integral:   result[l] = integral(body, a[l], b[l], context, variables); break;
+                            case OpCode::Solve:      result[l] = solve(body, a[l], b[l], context, variables); break;
+                            case OpCode::Ode:
+                                result[l] = odeNode(body, node.variable, a[l], b[l], c[l], context, variables);
+                                break;
+                            default:                 result[l] = sumNode(body, a[l], b[l], context, variables); break;
+                        }
+                        if (context.failed()) laneErrors.set(first + l, context.getErrorCode());
+                    }
+                    break;
             }
             
-            if (lowerFunc == "int" || lowerFunc == "sum") {
-                if (pos >= expr.length() || expr[pos] != ',') throw std::runtime_error("Expected ','");
-                pos++; // Skip ','
-                
-                // Parse third argument
-                startArg = pos;
-                parenDepth = 0;
-                while (pos < expr.length()) {
-                    if (expr[pos] == '(') parenDepth++;
-                    if (expr[pos] == ')') {
-                        if (parenDepth == 0) break;
-                        parenDepth--;
-                    }
-                    // No more commas expected
-                    pos++;
+            if (node.invariant) {
+                std::fill(result + 1, result + lanesPerBlock, result[0]);
+                invariantErrors[i] = invariantMask.error(0);
+                if (invariantErrors[i] != MathError::None) {
+                    for (size_t l = 0; l < blockLanes; ++l) errors.set(block + l, invariantErrors[i]);
                 }
-                // Backtrack one if we hit ')'
-                if (pos > 0 && expr[pos-1] == ')') pos--;
-                
-                std::string arg3Str = expr.substr(startArg, pos - startArg);
-                double val3 = evaluate(arg3Str, currentX);
-                
-                if (pos >= expr.length() || expr[pos] != ')') throw std::runtime_error("Expected ')'");
-                pos++;
-                
-                if (lowerFunc == "int") return integral(subExpr, val2, val3);
-                else return summation(subExpr, (int)val2, (int)val3);
             }
         }
-
-        double arg = parseFactor(expr, pos);
-        skipWhitespace(expr, pos);
         
-        if (pos >= expr.length() || expr[pos] != ')') {
-            throw std::runtime_error("Expected ')' after function argument");
+        const double* root = &values[(program.nodes.size() - 1) * lanesPerBlock];
+        for (size_t l = 0; l < blockLanes; ++l) {
+            out[block + l] = errors.test(block + l) ? 0.0 : root[l];
         }
-        ++pos;
-        
-        return parseFunction(funcName, arg);
     }
-    
-    // Handle numbers
-    return parseNumber(expr, pos);
+    if (count > 1 && hoisted > 0) {
+        skippedEvaluations.fetch_add(hoisted * (count - 1), std::memory_order_relaxed);
+    }
 }
 
-double MathEngine::parseTerm(const std::string& expr, size_t& pos) {
-    double result = parseFactor(expr, pos);
+void MathEngine::runTaylor(const CompiledExpression& program, const double* x, size_t order, double* out,
+                           EvalContext& context, const double* variables) const {
+    // Coefficients are kept node by node: values[node * width + k]
+    const size_t width = order + 1;
+    double localValues[256];
+    std::vector<double> heapValues;
+    double* values = localValues;
+    if (program.nodes.size() * width > 256) {
+        heapValues.resize(program.nodes.size() * width);
+        values = heapValues.data();
+    }
     
-    while (true) {
-        skipWhitespace(expr, pos);
-        if (pos >= expr.length()) break;
+    for (size_t i = 0; i < program.nodes.size(); ++i) {
+        const ExpressionNode& node = program.nodes[i];
+        const double* a = &values[node.lhs * width];
+        const double* b = &values[node.rhs * width];
+        double* result = &values[i * width];
         
-        char op = expr[pos];
-        if (op == '*' || op == '/' || op == '%' || op == '^') {
-            ++pos;
-            double right = parseFactor(expr, pos);
-            
-            if (op == '*') result *= right;
-            else if (op == '/') result = divide(result, right);
-            else if (op == '%') result = modulo(result, right);
-            else if (op == '^') result = power(result, right);
-        } else {
-            break;
+        switch (node.op) {
+            case OpCode::Constant:
+                result[0] = node.value;
+                std::fill(result + 1, result + width, 0.0);
+                break;
+            case OpCode::VariableX:  std::copy(x, x + width, result); break;
+            case OpCode::Variable:
+                // Outer variables do not move with x
+                if (!variables) {
+                    context.fail(MathError::MissingVariables);
+                    break;
+                }
+                result[0] = variables[node.variable];
+                std::fill(result + 1, result + width, 0.0);
+                break;
+            case OpCode::Add:        TaylorMath::add(a, b, result, order); break;
+            case OpCode::Subtract:   TaylorMath::subtract(a, b, result, order); break;
+            case OpCode::Multiply:   TaylorMath::multiply(a, b, result, order); break;
+            case OpCode::Divide:
+                if (b[0] == 0.0) context.fail(MathError::DivisionByZero);
+                else TaylorMath::divide(a, b, result, order);
+                break;
+            case OpCode::Modulo:
+                if (b[0] == 0.0) context.fail(MathError::ModuloByZero);
+                else TaylorMath::modulo(a, b, result, order);
+                break;
+            case OpCode::Power:      TaylorMath::power(a, b, result, order); break;
+            case OpCode::Negate:     TaylorMath::negate(a, result, order); break;
+            case OpCode::Reciprocal: TaylorMath::reciprocal(a, result, order); break;
+            case OpCode::Function: {
+                const Builtins::Info& builtin = Builtins::get(node.function);
+                const double* c = &values[node.third * width];
+                MathError error = builtin.domain ? builtin.domain(a[0], b[0], c[0]) : MathError::None;
+                if (error != MathError::None) context.fail(error);
+                else TaylorMath::function(node.function, a, b, c, result, order);
+                break;
+            }
+            case OpCode::Derivative: {
+                // f' around a(t0) from one more order of f, then composed with a
+                if (order >= TaylorMath::MaxOrder) {
+                    context.fail(MathError::DerivativeTooDeep);
+                    break;
+                }
+                double point[TaylorMath::MaxOrder + 1] = { a[0], 1.0 };
+                double f[TaylorMath::MaxOrder + 1];
+                runTaylor(program.bodies[node.body], point, order + 1, f, context, variables);
+                if (context.failed()) break;
+                for (size_t k = 0; k <= order; ++k) f[k] = static_cast<double>(k + 1) * f[k + 1];
+                TaylorMath::compose(f, a, result, order);
+                break;
+            }
+            case OpCode::Limit:
+                limitTaylor(program.bodies[node.body], a, order, result, context, variables);
+                break;
+            case OpCode::Integral: {
+                // d/dt of the integral from a to b is f(b) b' - f(a) a'
+                const CompiledExpression& body = program.bodies[node.body];
+                const double value = integral(body, a[0], b[0], context, variables);
+                if (order == 0 || context.failed()) {
+                    result[0] = value;
+                    break;
+                }
+                double atLower[TaylorMath::MaxOrder + 1], atUpper[TaylorMath::MaxOrder + 1];
+                double lower[TaylorMath::MaxOrder + 1];
+                runTaylor(body, a, order - 1, atLower, context, variables);
+                runTaylor(body, b, order - 1, atUpper, context, variables);
+                if (context.failed()) break;
+                TaylorMath::integrate(b, atUpper, value, result, order);
+                TaylorMath::integrate(a, atLower, 0.0, lower, order);
+                for (size_t k = 1; k <= order; ++k) result[k] -= lower[k];
+                break;
+            }
+            case OpCode::Summation:
+                // Bounds are truncated, so the sum is a step function of them
+                result[0] = sumNode(program.bodies[node.body], a[0], b[0], context, variables);
+                std::fill(result + 1, result + width, 0.0);
+                break;
+            case OpCode::Solve:
+                result[0] = solve(program.bodies[node.body], a[0], b[0], context, variables);
+                std::fill(result + 1, result + width, 0.0);
+                break;
+            case OpCode::Ode: {
+                // d/dt of y(c) is y'(c) c' = f(c, y(c)) c'. Moving x0 or y0 moves
+                // the whole solution (the variational equation), and higher
+                // orders need derivatives of f along it: neither is known.
+                const double* c = &values[node.third * width];
+                double slope = 0.0;
+                result[0] = odeNode(program.bodies[node.body], node.variable, a[0], b[0], c[0], context, variables,
+                                    order > 0 ? &slope : nullptr);
+                std::fill(result + 1, result + width, std::numeric_limits<double>::quiet_NaN());
+                bool fixed = true;
+                for (size_t k = 1; k <= order; ++k) fixed = fixed && a[k] == 0.0 && b[k] == 0.0;
+                if (order > 0 && fixed) result[1] = slope * c[1];
+                break;
+            }
         }
+        
+        if (context.failed()) return;
     }
     
-    return result;
+    const double* root = &values[(program.nodes.size() - 1) * width];
+    std::copy(root, root + width, out);
 }
 
-double MathEngine::parseExpression(const std::string& expr) {
-    size_t pos = 0;
-    double result = parseTerm(expr, pos);
+double MathEngine::applyFunction(FunctionId function, double a, double b, double c, EvalContext& context) {
+    const Builtins::Info& builtin = Builtins::get(function);
     
-    while (true) {
-        skipWhitespace(expr, pos);
-        if (pos >= expr.length()) break;
-        
-        char op = expr[pos];
-        if (op == '+' || op == '-') {
-            ++pos;
-            double right = parseTerm(expr, pos);
-            
-            if (op == '+') result += right;
-            else if (op == '-') result -= right;
-        } else {
-            break;
+    if (builtin.domain) {
+        MathError error = builtin.domain(a, b, c);
+        if (error != MathError::None) {
+            context.fail(error);
+            return 0.0;
         }
     }
-    
-    return result;
+    return builtin.function(a, b, c);
 }
 
-double MathEngine::parseFunction(const std::string& funcName, double arg) {
-    std::string lower = funcName;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    
-    if (lower == "sin") return sine(arg);
-    if (lower == "cos") return cosine(arg);
-    if (lower == "tan") return tangent(arg);
-    if (lower == "asin") return arcsine(arg);
-    if (lower == "acos") return arccosine(arg);
-    if (lower == "atan") return arctangent(arg);
-    if (lower == "log") return logarithm(arg);
-    if (lower == "ln") return naturalLog(arg);
-    if (lower == "sqrt") return squareRoot(arg);
-    if (lower == "cbrt") return cubeRoot(arg);
-    if (lower == "exp") return exponential(arg);
-    if (lower == "abs") return absolute(arg);
-    if (lower == "fact") return factorial(static_cast<int>(arg));
-    
-    // Hyperbolic
-    if (lower == "sinh") return hyperbolicSine(arg);
-    if (lower == "cosh") return hyperbolicCosine(arg);
-    if (lower == "tanh") return hyperbolicTangent(arg);
-    if (lower == "asinh") return hyperbolicArcSine(arg);
-    if (lower == "acosh") return hyperbolicArcCosine(arg);
-    if (lower == "atanh") return hyperbolicArcTangent(arg);
-    
-    throw std::runtime_error("Unknown function: " + funcName);
+void MathEngine::setError(MathError error) {
+    lastError = error;
 }
 
-void MathEngine::setError(const std::string& error) {
-    lastError = error;
+void MathEngine::report(const EvalContext& context) {
+    lastError = context.getErrorCode();
+    if (isParseError(lastError)) lastParseError = context.getError();
 }
 
-void MathEngine::clearError() {
-    lastError.clear();
+std::string MathEngine::getLastError() const {
+    return isParseError(lastError) ? lastParseError : formatError(lastError);
 }
@@ -3,8 +3,22 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <atomic>
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
+#include "CompiledExpression.hpp"
+#include "ErrorMask.hpp"
+#include "EvalContext.hpp"
+#include "GradientTape.hpp"
+#include "Quadrature.hpp"
+#include "Extrapolation.hpp"
+#include "RootFinding.hpp"
+#include "Ode.hpp"
+#include "Interval.hpp"
+#include "ExpressionCache.hpp"
+#include "BigEvaluator.hpp"
+#include "RationalEvaluator.hpp"
 
 class MathEngine {
 public:
@@ -14,6 +28,85 @@ public:
     double evaluate(const std::string& expression);
     double evaluate(const std::string& expression, double x);
     
+    // Compile once, evaluate many times (graphing, calculus)
+    CompiledExpression compile(const std::string& expression) const;
+    double evaluate(const CompiledExpression& expression, double x);
+    
+    // Reentrant evaluation: errors go to 'context' instead of lastError and
+    // the engine is not modified, so any number of threads may evaluate
+    // through one engine at once (while nobody changes its settings or cache)
+    double evaluate(const CompiledExpression& expression, double x, EvalContext& context) const;
+    
+    // Evaluates the expression at xs[0..count) into out[0..count), one block
+    // of points per pass over the program. Failed points get 0 and a flag in
+    // 'errors' instead of lastError. Built-in functions and powers use the
+    // SimdMath vector kernels, so values can differ from evaluate() by the few
+    // ulps documented in SimdMath.hpp.
+    void evaluateBatch(const CompiledExpression& expression, const double* xs, double* out,
+                       size_t count, ErrorMask& errors) const;
+    
+    // Bounds of the expression over every x in 'x' (see Interval.hpp), for
+    // plotting. Invalid programs give Interval::none(), programs without an
+    // interval form (see CompiledExpression::hasIntervalForm) Interval::entire().
+    Interval evaluate(const CompiledExpression& expression, const Interval& x) const;
+    
+    // Programs of several variables, for fitting and optimization: the
+    // top-level expression reads the named variables (case-insensitive)
+    // instead of x. Calculus bodies bind x themselves and read the other
+    // variables, so int(x*y, 0, 1) of {"y"} is y/2. An empty list is
+    // compile(expression).
+    CompiledExpression compile(const std::string& expression, const std::vector<std::string>& variables) const;
+    // 'variables' holds expression.getVariableCount() values, x for programs
+    // without named variables; another count is MathError::MissingVariables
+    double evaluate(const CompiledExpression& expression, const double* variables, size_t count,
+                    EvalContext& context) const;
+    // Value, plus the gradient with respect to the variables in 'gradient',
+    // by reverse-mode automatic differentiation (see GradientTape.hpp): one
+    // forward and one backward sweep, however many variables there are.
+    // Partial derivatives follow diff() (see Taylor.hpp). Calculus bodies
+    // that read the variables fail with MathError::NoGradient.
+    double gradient(const CompiledExpression& expression, const double* variables, size_t count,
+                    double* gradient, GradientTape& tape, EvalContext& context) const;
+    
+    // Arbitrary-precision evaluation (see BigEvaluator): decimal text of the
+    // result, or an empty string with lastError set
+    std::string evaluateBig(const std::string& expression);
+    void setBigPrecision(size_t digits) { bigPrecision = std::clamp<size_t>(digits, 1, MaxBigPrecision); }
+    size_t getBigPrecision() const { return bigPrecision; }
+    static constexpr size_t MaxBigPrecision = 1000000;
+    
+    // Exact evaluation as a fraction (see RationalEvaluator). Returns false
+    // with lastError set when the expression is invalid or needs irrational
+    // values (MathError::NotRational); evaluate() then gives the double result.
+    bool evaluateRational(const std::string& expression, Rational& result);
+    
+    // Compiled program from the expression cache; stays valid until the
+    // cache is next modified (compileCached, settings changes)
+    const CompiledExpression& compileCached(const std::string& expression);
+    void setCacheCapacity(size_t capacity) { cache.setCapacity(capacity); }
+    const ExpressionCache& getCache() const { return cache; }
+    
+    // Compiled expressions evaluated more than 'evaluations' times switch to
+    // native code where the JIT is available; 0 keeps the interpreter
+    void setJitThreshold(size_t evaluations) { jitThreshold = evaluations; }
+    size_t getJitThreshold() const { return jitThreshold; }
+    
+    // Node evaluations saved so far by batch evaluation (graphs, int(), sum())
+    // computing the nodes that do not depend on x once per batch instead of
+    // at every point (see ExpressionNode::invariant), for profiling
+    size_t getSkippedEvaluations() const { return skippedEvaluations.load(std::memory_order_relaxed); }
+    void resetSkippedEvaluations() { skippedEvaluations.store(0, std::memory_order_relaxed); }
+    
+    // Settings baked into compiled expressions; changing them invalidates
+    // the affected cache entries
+    void setAngleMode(AngleMode mode);
+    AngleMode getAngleMode() const { return angleMode; }
+    void define(const std::string& name, double value);
+    void undefine(const std::string& name);
+    // Changes whenever a definition does, for callers that keep results
+    // computed from them
+    size_t getDefinitionsGeneration() const { return definitionsGeneration; }
+    
     // Basic operations
     double add(double a, double b);
     double subtract(double a, double b);
@@ -57,8 +150,83 @@ public:
     // Calculus and Sequences
     double derivative(const std::string& expr, double point);
     double integral(const std::string& expr, double lower, double upper);
-    double limit(const std::string& expr, double point, bool fromRight = true); // Basic limit approximation
+    double limit(const std::string& expr, double point, bool fromRight = true);
     double summation(const std::string& expr, int start, int end);
+    double solve(const std::string& expr, double lower, double upper);
+    double ode(const std::string& expr, double x0, double y0, double x1); // expr of x and y
+    double derivative(const CompiledExpression& expr, double point);
+    double integral(const CompiledExpression& expr, double lower, double upper);
+    double limit(const CompiledExpression& expr, double point, bool fromRight = true);
+    double summation(const CompiledExpression& expr, int start, int end);
+    double solve(const CompiledExpression& expr, double lower, double upper);
+    double ode(const CompiledExpression& expr, double x0, double y0, double x1);
+    
+    // Reentrant versions, see evaluate(expression, x, context). 'variables'
+    // holds the values of the named variables for bodies that read them (see
+    // CompiledExpression::readsVariables), i.e. those of their top-level program.
+    double derivative(const CompiledExpression& expr, double point, EvalContext& context,
+                      const double* variables = nullptr) const;
+    double integral(const CompiledExpression& expr, double lower, double upper, EvalContext& context,
+                    const double* variables = nullptr) const;
+    double limit(const CompiledExpression& expr, double point, bool fromRight, EvalContext& context,
+                 const double* variables = nullptr) const;
+    double summation(const CompiledExpression& expr, int start, int end, EvalContext& context,
+                     const double* variables = nullptr) const;
+    double solve(const CompiledExpression& expr, double lower, double upper, EvalContext& context,
+                 const double* variables = nullptr) const;
+    
+    // lim() with its error estimate (see Extrapolation.hpp); limit() is the
+    // value. Fails with MathError::NoConvergence when the estimated error is
+    // above the extrapolation tolerance. The point may be infinite.
+    Extrapolation::Result estimateLimit(const CompiledExpression& expr, double point, bool fromRight,
+                                        EvalContext& context, const double* variables = nullptr) const;
+    // Sum of the terms from 'start' to infinity, i.e. sum(f, start, inf),
+    // with its error estimate and the number of terms used; fails like
+    // estimateLimit()
+    Extrapolation::Result estimateSeries(const CompiledExpression& expr, int start, EvalContext& context,
+                                         const double* variables = nullptr) const;
+    // int() with its error estimate and evaluation count (see Quadrature.hpp);
+    // integral() is the value. Bounds may be infinite. Fails with
+    // MathError::NoConvergence unless the estimate is Quadrature::acceptable,
+    // as for divergent integrals.
+    Quadrature::Result integrate(const CompiledExpression& expr, double lower, double upper,
+                                 EvalContext& context, const double* variables = nullptr) const;
+    // Root of f in [lower, upper] with its iteration count (see RootFinding.hpp):
+    // the bounds themselves when f changes sign over them, otherwise the
+    // first sign change of a scan as in findRoots(). Fails with
+    // MathError::NoRoot when there is none; solve() is the root, by Newton.
+    RootFinding::Result findRoot(const CompiledExpression& expr, double lower, double upper,
+                                 RootFinding::Method method, EvalContext& context,
+                                 const double* variables = nullptr) const;
+    // Every root where f changes sign between two of RootFinding::ScanPoints
+    // samples over [lower, upper], in order. The samples are one batch, the
+    // roots are refined on the thread pool. Roots where f touches 0 without
+    // changing sign are only found when a sample hits them exactly.
+    std::vector<RootFinding::Result> findRoots(const CompiledExpression& expr, double lower, double upper,
+                                               RootFinding::Method method, EvalContext& context,
+                                               const double* variables = nullptr) const;
+    // y(x1) for y' = f(x, y), y(x0) = y0, with the steps and their dense
+    // output (see Ode.hpp), so the solution can be read anywhere along the
+    // way. f is compiled with two variables, x and y in that order (see
+    // compile(expression, variables)); ode() is the value at x1. Fails with
+    // MathError::NoConvergence when the steps stall, as where y blows up.
+    Ode::Solution solveOde(const CompiledExpression& expr, double x0, double y0, double x1,
+                           const Ode::Tolerance& tolerance, EvalContext& context) const;
+    // An integral is done when its estimated error is at most 'absolute' or
+    // 'relative' times its value
+    void setIntegralTolerance(double relative, double absolute);
+    const Quadrature::Tolerance& getIntegralTolerance() const { return integralTolerance; }
+    // Error allowed per step of ode(), in the same sense
+    void setOdeTolerance(double relative, double absolute);
+    const Ode::Tolerance& getOdeTolerance() const { return odeTolerance; }
+    // Error allowed of lim() and sum(f, a, inf), in the same sense
+    void setExtrapolationTolerance(double relative, double absolute);
+    const Extrapolation::Tolerance& getExtrapolationTolerance() const { return extrapolationTolerance; }
+    // Threads, the caller's included, that int() and sum() spread their
+    // evaluations over; set for every engine at once (ThreadPool::shared()).
+    // Results are the same for any count.
+    void setThreadCount(size_t threads);
+    size_t getThreadCount() const;
     
     // Memory operations
     void memoryClear();
@@ -72,28 +240,66 @@ public:
     static constexpr double E = 2.71828182845904523536;
     
     // Error handling
-    std::string getLastError() const { return lastError; }
-    bool hasError() const { return !lastError.empty(); }
+    // The message is formatted here, failing calls only store the error id
+    std::string getLastError() const;
+    MathError getLastErrorCode() const { return lastError; }
+    bool hasError() const { return lastError != MathError::None; }
     
 private:
     double memory;
-    double currentX; // For graphing
-    std::string lastError;
+    MathError lastError;
+    std::string lastParseError; // message of a parse error, which needs the source
+    
+    AngleMode angleMode;
+    std::map<std::string, double> definitions; // lower-case names
+    size_t definitionsGeneration = 0;
+    ExpressionCache cache;
+    std::string cacheKey; // reused buffer for normalized cache keys
+    size_t jitThreshold = 64;
+    size_t bigPrecision = 50;   // significant digits of inexact big-number results
+    Quadrature::Tolerance integralTolerance;
+    Ode::Tolerance odeTolerance;
+    Extrapolation::Tolerance extrapolationTolerance;
+    RationalEvaluator rationalEvaluator; // kept for its buffers
+    mutable std::atomic<size_t> skippedEvaluations{ 0 };
     
-    // Expression parsing helpers
-    double parseExpression(const std::string& expr);
-    double parseTerm(const std::string& expr, size_t& pos);
-    double parseFactor(const std::string& expr, size_t& pos);
-    double parseNumber(const std::string& expr, size_t& pos);
-    double parseFunction(const std::string& funcName, double arg);
+    void invalidateDefinitions();
     
-    void skipWhitespace(const std::string& expr, size_t& pos);
-    bool isOperator(char c);
-    int getPrecedence(char op);
+    // Executes a valid compiled program; stops at the first error. Named
+    // variables fail with MathError::MissingVariables unless given.
+    double run(const CompiledExpression& program, double x, EvalContext& context,
+               const double* variables = nullptr) const;
+    // Batch version; 'errors' must already be reset to 'count' lanes
+    void runBatch(const CompiledExpression& program, const double* xs, double* out,
+                  size_t count, ErrorMask& errors, const double* variables = nullptr) const;
+    // runBatch on the thread pool when the batch is large enough to gain;
+    // returns the error of the first failing point
+    MathError runParallel(const CompiledExpression& program, const double* xs, double* out,
+                          size_t count, const double* variables = nullptr) const;
+    // Taylor series version (see Taylor.hpp): x and out have order + 1 coefficients
+    void runTaylor(const CompiledExpression& program, const double* x, size_t order, double* out,
+                   EvalContext& context, const double* variables = nullptr) const;
+    // lim() and sum() nodes of programs; lim() of a Taylor series is extrapolated coefficientwise
+    void limitTaylor(const CompiledExpression& body, const double* point, size_t order, double* out,
+                     EvalContext& context, const double* variables) const;
+    double sumNode(const CompiledExpression& body, double lower, double upper, EvalContext& context,
+                   const double* variables) const;
+    // Root in one bracket, and f at the RootFinding::ScanPoints points of a
+    // scan over [lower, upper] (NaN where it fails)
+    RootFinding::Result refineRoot(const CompiledExpression& expr, const RootFinding::Bracket& bracket,
+                                   RootFinding::Method method, const double* variables) const;
+    void scan(const CompiledExpression& expr, double lower, double upper, double* xs, double* ys,
+              const double* variables) const;
+    // ode() nodes of programs: the body reads y from variables[slot], past
+    // the top-level variables and the y of enclosing ode() bodies. 'slope'
+    // (may be null) receives y'(x1).
+    double odeNode(const CompiledExpression& body, std::uint16_t slot, double x0, double y0, double x1,
+                   EvalContext& context, const double* variables, double* slope = nullptr) const;
+    static double applyFunction(FunctionId function, double a, double b, double c, EvalContext& context);
     
     double toRadians(double degrees);
     double toDegrees(double radians);
     
-    void setError(const std::string& error);
-    void clearError();
+    void setError(MathError error);
+    void report(const EvalContext& context); // copies the outcome into lastError
 };
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Error ids reported by the parser and by evaluation. Failing evaluations
+// only store the id, which needs no allocation; the message is looked up (and,
+// for parse errors, formatted from the source) when someone asks for it.
+enum class MathError : std::uint8_t {
+    None,
+
+    // Evaluation
+    DivisionByZero,
+    ModuloByZero,
+    AsinDomain,
+    AcosDomain,
+    LogDomain,
+    LnDomain,
+    LogBaseDomain,
+    SqrtDomain,
+    AcoshDomain,
+    AtanhDomain,
+    FactorialNegative,
+    FactorialOverflow,
+    FactorialDomain,
+    ZerothRoot,
+    InvalidPermutation,
+    InvalidCombination,
+    InvalidModulus,
+    NotInBigMode,
+    ResultTooLarge,
+    NotRational,
+    DerivativeTooDeep,
+    MissingVariables,
+    NoConvergence,
+    InvalidSumBounds,
+    NoGradient,
+    NoRoot,
+    InvalidInterval,
+
+    // Parsing; the position of the error in the source is kept alongside
+    EmptyExpression,
+    UnexpectedEnd,
+    UnexpectedCharacter,
+    InvalidNumber,
+    MissingOperand,
+    MissingArgument,
+    TooManyArguments,
+    ExpectedComma,
+    UnexpectedComma,
+    ExpectedCloseParen,
+    UnexpectedCloseParen,
+    ExpectedOpenParen,
+    UnknownFunction
+};
+
+inline bool isParseError(MathError error) {
+    return error >= MathError::EmptyExpression;
+}
+
+// Fixed part of the message; nullptr for MathError::None
+inline const char* errorMessage(MathError error) {
+    switch (error) {
+        case MathError::None:                 return nullptr;
+        case MathError::DivisionByZero:       return "Division by zero";
+        case MathError::ModuloByZero:         return "Modulo by zero";
+        case MathError::AsinDomain:           return "arcsin domain error";
+        case MathError::AcosDomain:           return "arccos domain error";
+        case MathError::LogDomain:            return "log domain error";
+        case MathError::LnDomain:             return "ln domain error";
+        case MathError::LogBaseDomain:        return "log base domain error";
+        case MathError::SqrtDomain:           return "sqrt of negative number";
+        case MathError::AcoshDomain:          return "acosh domain error";
+        case MathError::AtanhDomain:          return "atanh domain error";
+        case MathError::FactorialNegative:    return "factorial of negative number";
+        case MathError::FactorialOverflow:    return "factorial overflow";
+        case MathError::FactorialDomain:      return "factorial domain error";
+        case MathError::ZerothRoot:           return "0th root undefined";
+        case MathError::InvalidPermutation:   return "Invalid permutation parameters";
+        case MathError::InvalidCombination:   return "Invalid combination parameters";
+        case MathError::InvalidModulus:       return "nCr modulus must be a prime below 2^31";
+        case MathError::NotInBigMode:         return "Not available in big-number mode";
+        case MathError::ResultTooLarge:       return "Result too large";
+        case MathError::NotRational:          return "Result is not rational";
+        case MathError::DerivativeTooDeep:    return "Derivatives nested too deeply";
+        case MathError::MissingVariables:     return "Values of the variables are missing";
+        case MathError::NoConvergence:        return "Does not converge";
+        case MathError::InvalidSumBounds:     return "Invalid sum bounds";
+        case MathError::NoGradient:           return "No gradient through calculus over variables";
+        case MathError::NoRoot:               return "No root in the interval";
+        case MathError::InvalidInterval:      return "Invalid interval";
+        case MathError::EmptyExpression:      return "Empty expression";
+        case MathError::UnexpectedEnd:        return "Unexpected end of expression";
+        case MathError::UnexpectedCharacter:  return "Unexpected character: ";
+        case MathError::InvalidNumber:        return "Invalid number format";
+        case MathError::MissingOperand:       return "Missing operand";
+        case MathError::MissingArgument:      return "Missing argument";
+        case MathError::TooManyArguments:     return "Too many arguments";
+        case MathError::ExpectedComma:        return "Expected ','";
+        case MathError::UnexpectedComma:      return "Unexpected ','";
+        case MathError::ExpectedCloseParen:   return "Expected ')'";
+        case MathError::UnexpectedCloseParen: return "Unexpected ')'";
+        case MathError::ExpectedOpenParen:    return "Expected '(' after function name";
+        case MathError::UnknownFunction:      return "Unknown function: ";
+    }
+    return "Unknown error";
+}
+
+// Full message; parse errors that name a character or function take it
+// from 'source' at 'position'
+inline std::string formatError(MathError error, std::string_view source = {}, size_t position = 0) {
+    const char* text = errorMessage(error);
+    std::string message = text ? text : "";
+    if (position < source.size()) {
+        if (error == MathError::UnexpectedCharacter) {
+            message += source[position];
+        } else if (error == MathError::UnknownFunction) {
+            size_t end = position;
+            while (end < source.size() && std::isalpha(static_cast<unsigned char>(source[end]))) ++end;
+            message += source.substr(position, end - position);
+        }
+    }
+    return message;
+}
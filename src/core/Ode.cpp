@@ -0,0 +1,338 @@
+#include "Ode.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double Epsilon = std::numeric_limits<double>::epsilon();
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+// Dormand-Prince 5(4): nodes, stages, and the fifth-order weights (the
+// seventh stage is at the new point)
+constexpr double C2 = 1.0 / 5.0, C3 = 3.0 / 10.0, C4 = 4.0 / 5.0, C5 = 8.0 / 9.0;
+constexpr double A21 = 1.0 / 5.0;
+constexpr double A31 = 3.0 / 40.0, A32 = 9.0 / 40.0;
+constexpr double A41 = 44.0 / 45.0, A42 = -56.0 / 15.0, A43 = 32.0 / 9.0;
+constexpr double A51 = 19372.0 / 6561.0, A52 = -25360.0 / 2187.0, A53 = 64448.0 / 6561.0, A54 = -212.0 / 729.0;
+constexpr double A61 = 9017.0 / 3168.0, A62 = -355.0 / 33.0, A63 = 46732.0 / 5247.0, A64 = 49.0 / 176.0,
+                 A65 = -5103.0 / 18656.0;
+constexpr double A71 = 35.0 / 384.0, A73 = 500.0 / 1113.0, A74 = 125.0 / 192.0, A75 = -2187.0 / 6784.0,
+                 A76 = 11.0 / 84.0;
+// Fifth- less fourth-order weights
+constexpr double E1 = 71.0 / 57600.0, E3 = -71.0 / 16695.0, E4 = 71.0 / 1920.0, E5 = -17253.0 / 339200.0,
+                 E6 = 22.0 / 525.0, E7 = -1.0 / 40.0;
+// Fourth-order continuous extension (Hairer's DOPRI5)
+constexpr double D1 = -12715105075.0 / 11282082432.0, D3 = 87487479700.0 / 32700410799.0,
+                 D4 = -10690763975.0 / 1880347072.0, D5 = 701980252875.0 / 199316789632.0,
+                 D6 = -1453857185.0 / 822651844.0, D7 = 69997945.0 / 29380423.0;
+
+// Radau IIA of order 5: nodes and stages; the last row is also the weights
+constexpr double Sqrt6 = 2.44948974278317809820;
+constexpr double RadauC[3] = { (4.0 - Sqrt6) / 10.0, (4.0 + Sqrt6) / 10.0, 1.0 };
+constexpr double RadauA[3][3] = {
+    { (88.0 - 7.0 * Sqrt6) / 360.0, (296.0 - 169.0 * Sqrt6) / 1800.0, (-2.0 + 3.0 * Sqrt6) / 225.0 },
+    { (296.0 + 169.0 * Sqrt6) / 1800.0, (88.0 + 7.0 * Sqrt6) / 360.0, (-2.0 - 3.0 * Sqrt6) / 225.0 },
+    { (16.0 - Sqrt6) / 36.0, (16.0 + Sqrt6) / 36.0, 1.0 / 9.0 }
+};
+// RADAU5's error estimate (u / h - J)^-1 (f(x, y) + (e1 z1 + e2 z2 + e3 z3) / h),
+// with u the real eigenvalue of A^-1
+constexpr double RadauE[3] = { -(13.0 + 7.0 * Sqrt6) / 3.0, (-13.0 + 7.0 * Sqrt6) / 3.0, -1.0 / 3.0 };
+constexpr double RadauU = 3.63783425274449573221;
+// Newton iterations per step at most; slower convergence takes a smaller step
+constexpr int MaxNewtonIterations = 7;
+
+// Hairer's test: the explicit steps are stiff once h |df/dy| exceeds this on
+// StiffSteps accepted steps without NonstiffSteps in a row below it. The
+// stability region ends near 3.3, but the step control settles a little
+// inside it, at about 2.8, when stability is all that bounds the steps.
+constexpr double StiffLimit = 2.5;
+constexpr int StiffSteps = 15;
+constexpr int NonstiffSteps = 6;
+
+struct Equation {
+    Ode::Function f;
+    void* state;
+    Ode::Solution& solution;
+
+    bool operator()(double x, double y, double* value) {
+        solution.statistics.evaluations++;
+        MathError error = f(state, x, y, value);
+        if (error == MathError::None) return true;
+        solution.failure = error;
+        return false;
+    }
+};
+
+// Outcome of one step from (x, y) to x + h
+struct Step {
+    double y;           // at x + h
+    double slope;       // f(x + h, y), the first stage of the step after
+    double error;       // estimate relative to the tolerance; NaN when f overflowed
+    double stiffness;   // h |df/dy| seen by the last stages, explicit steps only
+    double c[5];        // dense output (Ode::Segment)
+};
+
+double errorScale(const Ode::Tolerance& tolerance, double y, double next) {
+    return tolerance.absolute + tolerance.relative * std::max(std::abs(y), std::abs(next));
+}
+
+bool dormandPrince(Equation& f, double x, double y, double slope, double h, const Ode::Tolerance& tolerance,
+                   Step& step) {
+    const double k1 = slope;
+    double k2, k3, k4, k5, k6, k7;
+    if (!f(x + C2 * h, y + h * A21 * k1, &k2)) return false;
+    if (!f(x + C3 * h, y + h * (A31 * k1 + A32 * k2), &k3)) return false;
+    if (!f(x + C4 * h, y + h * (A41 * k1 + A42 * k2 + A43 * k3), &k4)) return false;
+    if (!f(x + C5 * h, y + h * (A51 * k1 + A52 * k2 + A53 * k3 + A54 * k4), &k5)) return false;
+    const double y6 = y + h * (A61 * k1 + A62 * k2 + A63 * k3 + A64 * k4 + A65 * k5);
+    if (!f(x + h, y6, &k6)) return false;
+    step.y = y + h * (A71 * k1 + A73 * k3 + A74 * k4 + A75 * k5 + A76 * k6);
+    if (!f(x + h, step.y, &k7)) return false;
+    step.slope = k7;
+
+    const double error = h * (E1 * k1 + E3 * k3 + E4 * k4 + E5 * k5 + E6 * k6 + E7 * k7);
+    step.error = std::abs(error) / errorScale(tolerance, y, step.y);
+    // Stages 6 and 7 are at the same x, so they difference f in y
+    step.stiffness = step.y != y6 ? std::abs(h * (k7 - k6) / (step.y - y6)) : 0.0;
+
+    const double change = step.y - y;
+    const double spline = h * k1 - change;
+    step.c[0] = y;
+    step.c[1] = change;
+    step.c[2] = spline;
+    step.c[3] = change - h * k7 - spline;
+    step.c[4] = h * (D1 * k1 + D3 * k3 + D4 * k4 + D5 * k5 + D6 * k6 + D7 * k7);
+    return true;
+}
+
+// Value of a segment's polynomial c at x + t h, t in [0, 1] or just past it
+double interpolate(const double* c, double t) {
+    const double u = 1.0 - t;
+    return c[0] + t * (c[1] + u * (c[2] + t * (c[3] + u * c[4])));
+}
+
+// One step of Radau IIA: the increments z_i = y(x + c_i h) - y solve
+// z = h A f(x + c h, y + z), by simplified Newton iterations with the
+// Jacobian J = df/dy at (x, y). 'previous' (may be null) extrapolates the
+// first guess.
+bool radau(Equation& f, double x, double y, double slope, double h, double jacobian,
+           const Ode::Segment* previous, const Ode::Tolerance& tolerance, Step& step) {
+    step.stiffness = 0.0;
+    step.error = NaN;
+    double z[3] = { 0.0, 0.0, 0.0 };
+    if (previous) {
+        for (int i = 0; i < 3; i++) z[i] = interpolate(previous->c, 1.0 + RadauC[i] * h / previous->h) - y;
+    }
+
+    // Inverse of the Newton matrix I - h J A, by cofactors
+    double m[3][3], inverse[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) m[i][j] = (i == j ? 1.0 : 0.0) - h * jacobian * RadauA[i][j];
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            const int r0 = (j + 1) % 3, r1 = (j + 2) % 3, c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+            inverse[i][j] = m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0];
+        }
+    }
+    const double determinant = m[0][0] * inverse[0][0] + m[0][1] * inverse[1][0] + m[0][2] * inverse[2][0];
+    if (!std::isfinite(determinant) || determinant == 0.0) return true;
+    for (auto& row : inverse) {
+        for (double& entry : row) entry /= determinant;
+    }
+
+    // Newton's error shrinks by 'rate' per iteration; stop when what is left
+    // is well below the tolerance
+    const double scale = tolerance.absolute + tolerance.relative * std::abs(y);
+    const double target = std::max(10.0 * Epsilon / tolerance.relative, std::min(0.03, std::sqrt(tolerance.relative)));
+    double previousNorm = 0.0;
+    bool converged = false;
+    for (int iteration = 0; iteration < MaxNewtonIterations && !converged; iteration++) {
+        double values[3], residual[3];
+        for (int i = 0; i < 3; i++) {
+            if (!f(x + RadauC[i] * h, y + z[i], &values[i])) return false;
+        }
+        for (int i = 0; i < 3; i++) {
+            residual[i] = h * (RadauA[i][0] * values[0] + RadauA[i][1] * values[1] + RadauA[i][2] * values[2]) - z[i];
+        }
+        double norm = 0.0;
+        for (int i = 0; i < 3; i++) {
+            const double change = inverse[i][0] * residual[0] + inverse[i][1] * residual[1] + inverse[i][2] * residual[2];
+            z[i] += change;
+            norm = std::max(norm, std::abs(change) / scale);
+        }
+        if (!std::isfinite(norm)) return true;
+        if (iteration == 0) {
+            converged = norm <= target;
+        } else {
+            const double rate = norm / previousNorm;
+            if (rate >= 1.0) return true;
+            converged = rate / (1.0 - rate) * norm <= target;
+        }
+        previousNorm = norm;
+    }
+    if (!converged) return true;
+
+    step.y = y + z[2];
+    if (!f(x + h, step.y, &step.slope)) return false;
+    const double filter = RadauU / h - jacobian;
+    const double weighted = (RadauE[0] * z[0] + RadauE[1] * z[1] + RadauE[2] * z[2]) / h;
+    double error = (slope + weighted) / filter;
+    // Very stiff components make the first estimate too large; one more pass
+    // through f damps them
+    if (std::abs(error) >= errorScale(tolerance, y, step.y)) {
+        double value;
+        if (!f(x, y + error, &value)) return false;
+        error = (value + weighted) / filter;
+    }
+
+    // Collocation polynomial through y and y + z_i at the nodes
+    const double q0 = (z[0] - RadauC[0] * z[2]) / (RadauC[0] * (1.0 - RadauC[0]));
+    const double q1 = (z[1] - RadauC[1] * z[2]) / (RadauC[1] * (1.0 - RadauC[1]));
+    step.c[0] = y;
+    step.c[1] = z[2];
+    step.c[3] = (q1 - q0) / (RadauC[1] - RadauC[0]);
+    step.c[2] = q0 - RadauC[0] * step.c[3];
+    step.c[4] = 0.0;
+
+    // The estimate above is of the end of the step, which a stiff equation
+    // holds to its slow solution even when the polynomial does not follow
+    // it in between; the polynomial's residual halfway, filtered the same
+    // way, is the error of the dense output there
+    double middle;
+    if (!f(x + 0.5 * h, interpolate(step.c, 0.5), &middle)) return false;
+    const double residual = (step.c[1] + 0.25 * step.c[3]) / h - middle;
+    error = std::max(std::abs(error), std::abs(residual / filter));
+    step.error = error / errorScale(tolerance, y, step.y);
+    return true;
+}
+
+// df/dy by a finite difference, as small as rounding in f allows
+bool differentiate(Equation& f, double x, double y, double slope, const Ode::Tolerance& tolerance,
+                   double& jacobian) {
+    const double dy = std::sqrt(Epsilon) * std::max(std::abs(y), tolerance.absolute / tolerance.relative);
+    double value;
+    if (!f(x, y + dy, &value)) return false;
+    jacobian = (value - slope) / dy;
+    return true;
+}
+
+// Hairer's starting step for a method of order 5: one where the first two
+// derivatives of y change the solution about as much as the tolerance allows
+bool initialStep(Equation& f, double x, double y, double slope, double span, const Ode::Tolerance& tolerance,
+                 double& h) {
+    const double scale = tolerance.absolute + tolerance.relative * std::abs(y);
+    const double d0 = std::abs(y) / scale, d1 = std::abs(slope) / scale;
+    double h0 = d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1;
+    h0 = std::min(h0, std::abs(span));
+    const double direction = span > 0.0 ? 1.0 : -1.0;
+    double next;
+    if (!f(x + direction * h0, y + direction * h0 * slope, &next)) return false;
+    const double d2 = std::abs(next - slope) / scale / h0;
+    const double largest = std::max(d1, d2);
+    const double h1 = largest <= 1e-15 ? std::max(1e-6, h0 * 1e-3) : std::pow(0.01 / largest, 0.2);
+    h = direction * std::min({ 100.0 * h0, h1, std::abs(span) });
+    if (!std::isfinite(h) || h == 0.0) h = direction * h0;
+    return true;
+}
+
+} // namespace
+
+namespace Ode {
+
+double Solution::at(double x) const {
+    if (!((x >= start && x <= end) || (x <= start && x >= end))) return NaN;
+    if (segments.empty()) return value;
+    // The last segment starting at or before x, along the direction of integration
+    const double direction = end >= start ? 1.0 : -1.0;
+    auto after = std::upper_bound(segments.begin(), segments.end(), x * direction,
+                                  [direction](double point, const Segment& segment) { return point < segment.x * direction; });
+    const Segment& segment = after == segments.begin() ? segments.front() : *(after - 1);
+    return interpolate(segment.c, std::min(std::max((x - segment.x) / segment.h, 0.0), 1.0));
+}
+
+Solution solve(Function f, void* state, double x0, double y0, double x1, const Tolerance& tolerance) {
+    Solution solution;
+    solution.start = solution.end = x0;
+    solution.value = y0;
+    Equation equation{ f, state, solution };
+    Statistics& statistics = solution.statistics;
+
+    double x = x0, y = y0, slope, h;
+    if (!equation(x, y, &slope)) return solution;
+    if (x1 == x0) {
+        solution.converged = true;
+        return solution;
+    }
+    if (!initialStep(equation, x, y, slope, x1 - x0, tolerance, h)) return solution;
+
+    const double direction = x1 > x0 ? 1.0 : -1.0;
+    bool stiff = false, rejected = false;
+    int stiffCount = 0, nonstiffCount = 0;
+    double jacobian = 0.0;
+    bool jacobianCurrent = false;   // computed at (x, y)
+    while (statistics.steps < MaxSteps) {
+        // Stretch the step by up to 1% rather than leave a sliver before x1
+        const bool last = (x + 1.01 * h - x1) * direction >= 0.0;
+        if (last) h = x1 - x;
+        if (std::abs(h) <= 16.0 * Epsilon * std::abs(x)) break;
+
+        Step step;
+        if (stiff) {
+            if (!jacobianCurrent) {
+                if (!differentiate(equation, x, y, slope, tolerance, jacobian)) return solution;
+                statistics.jacobians++;
+                jacobianCurrent = true;
+            }
+            const Segment* previous = solution.segments.empty() ? nullptr : &solution.segments.back();
+            if (!radau(equation, x, y, slope, h, jacobian, previous, tolerance, step)) return solution;
+        } else {
+            if (!dormandPrince(equation, x, y, slope, h, tolerance, step)) return solution;
+        }
+
+        // Both estimates are of the error of a lower order (4 and 3); NaN
+        // (overflow, Newton failing) shrinks the step most
+        const double exponent = stiff ? 1.0 / 4.0 : 1.0 / 5.0;
+        double factor = std::isfinite(step.error) ? 0.9 * std::pow(step.error, -exponent) : 0.2;
+        if (!(step.error <= 1.0) || !std::isfinite(step.y) || !std::isfinite(step.slope)) {
+            statistics.rejected++;
+            rejected = true;
+            h *= std::min(std::max(factor, 0.2), 0.9);
+            continue;
+        }
+
+        Segment segment{ x, h, { step.c[0], step.c[1], step.c[2], step.c[3], step.c[4] } };
+        solution.segments.push_back(segment);
+        statistics.steps++;
+        if (stiff) statistics.stiffSteps++;
+        x = last ? x1 : x + h;
+        y = step.y;
+        slope = step.slope;
+        jacobianCurrent = false;
+        solution.end = x;
+        solution.value = y;
+        if (last) {
+            solution.converged = true;
+            return solution;
+        }
+
+        if (!stiff) {
+            if (step.stiffness > StiffLimit) {
+                nonstiffCount = 0;
+                if (++stiffCount == StiffSteps) {
+                    stiff = true;
+                    statistics.stiffFrom = x;
+                }
+            } else if (++nonstiffCount == NonstiffSteps) {
+                stiffCount = 0;
+            }
+        }
+        // No growth right after a rejection
+        h *= std::min(std::max(factor, 0.2), rejected ? 1.0 : 5.0);
+        rejected = false;
+    }
+    solution.failure = MathError::NoConvergence;
+    return solution;
+}
+
+} // namespace Ode
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "MathError.hpp"
+
+// Initial value problems y' = f(x, y), y(x0) = y0, for ode(f, x0, y0, x1)
+// (MathEngine::solveOde).
+//
+// Steps are Dormand-Prince 5(4): six evaluations of f per step (the seventh
+// is the first of the next step), with the embedded fourth-order solution as
+// the error estimate that sizes the next step. When f is stiff, its step
+// size is bounded by stability rather than accuracy; Hairer's test notices
+// this from the last two stages of successive steps (h |df/dy| stays near
+// the edge of the stability region), and the rest of the interval is then
+// taken by the implicit Radau IIA method of order 5, which is L-stable and
+// keeps its order on stiff problems. Its stages are solved by simplified
+// Newton iterations with a finite-difference df/dy, as in Hairer's RADAU5.
+//
+// Every step keeps the coefficients of its continuous extension (dense
+// output), so the solution can be read anywhere between x0 and the last
+// step, to the accuracy of the steps, without integrating again.
+namespace Ode {
+
+struct Tolerance {
+    double relative = 1e-10;
+    double absolute = 1e-12;
+};
+
+struct Statistics {
+    size_t steps = 0;           // accepted steps
+    size_t rejected = 0;        // steps taken again, smaller
+    size_t evaluations = 0;     // evaluations of f
+    size_t jacobians = 0;       // Jacobians for the implicit method
+    size_t stiffSteps = 0;      // accepted steps of the implicit method
+    double stiffFrom = std::numeric_limits<double>::quiet_NaN(); // x of the switch, NaN without
+};
+
+// Stores f(x, y) in 'value'; returns the error of f, MathError::None if there is none
+using Function = MathError (*)(void* state, double x, double y, double* value);
+
+// y(x + t h) = c[0] + t (c[1] + (1 - t) (c[2] + t (c[3] + (1 - t) c[4]))) for t in [0, 1]
+struct Segment {
+    double x, h;
+    double c[5];
+};
+
+struct Solution {
+    double start = 0.0;
+    double end = 0.0;           // x reached, x1 unless failed
+    double value = 0.0;         // y at end
+    bool converged = false;     // reached x1
+    MathError failure = MathError::None; // first error of f, or NoConvergence
+    Statistics statistics;
+    std::vector<Segment> segments; // one per step, in order; x falls when integrating backwards
+
+    // Dense output; NaN outside [start, end]
+    double at(double x) const;
+};
+
+// Integrates from x0 to x1 (either side of x0). Fails with MathError::NoConvergence
+// when the steps get too small or too many, as near a singularity of y, or
+// with the first error of f; the solution up to there is kept.
+Solution solve(Function f, void* state, double x0, double y0, double x1, const Tolerance& tolerance);
+
+// Accepted steps at most
+constexpr size_t MaxSteps = 100000;
+
+} // namespace Ode
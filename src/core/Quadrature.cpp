@@ -0,0 +1,375 @@
+#include "Quadrature.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace {
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double Epsilon = std::numeric_limits<double>::epsilon();
+constexpr double HalfPi = 1.57079632679489661923;
+
+// Gauss-Kronrod 7-15 rule on [-1, 1] (QUADPACK's qk15). Kronrod nodes
+// +-KronrodNodes[i]; those with odd i, and 0, are the Gauss nodes.
+const double KronrodNodes[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0,
+};
+const double KronrodWeights[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+};
+const double GaussWeights[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+};
+constexpr size_t RuleNodes = 15;
+
+// A piece of the curve resting on an end is split this often, and far more
+// often than the number of pieces would suggest for uniform splitting, before
+// the end counts as singular
+constexpr int SingularDepth = 8;
+// Tanh-sinh halves its step this often at most, about 800 evaluations
+constexpr int MaxLevel = 6;
+
+// Pieces split per round at most: the worst, and those within a factor of
+// two of it. Each round is one integrand call, large enough to be spread
+// over threads.
+constexpr size_t RoundSegments = 16;
+
+// Integrals are taken over t in a finite range [ta, tb]. Infinite bounds are
+// mapped there, and the integrand multiplied by dx/dt:
+//   [a, inf)     x = a + t / (1 - t)     t in [0, 1)
+//   (-inf, b]    x = b - (1 - t) / t     t in (0, 1]
+//   (-inf, inf)  x = t / (1 - t^2)       t in (-1, 1)
+enum class Infinite { None, Upper, Lower, Both };
+
+struct Problem {
+    Quadrature::Integrand integrand = nullptr;
+    void* state = nullptr;
+    Infinite infinite = Infinite::None;
+    double bound = 0.0;     // the finite bound of a half-infinite range
+    size_t evaluations = 0;
+    MathError failure = MathError::None;
+    std::vector<double> xs;     // evaluate()'s buffers
+    std::vector<double> scales;
+};
+
+// Integrand in t at ts[0..count) into gs[0..count); false on its first error
+bool evaluate(Problem& problem, const double* ts, double* gs, size_t count) {
+    std::vector<double>& xs = problem.xs;
+    std::vector<double>& scales = problem.scales;
+    xs.resize(count);
+    scales.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const double t = ts[i];
+        double s;
+        switch (problem.infinite) {
+            case Infinite::None:  xs[i] = t; scales[i] = 1.0; break;
+            case Infinite::Upper:
+                s = 1.0 / (1.0 - t);
+                xs[i] = problem.bound + t * s;
+                scales[i] = s * s;
+                break;
+            case Infinite::Lower:
+                s = 1.0 / t;
+                xs[i] = problem.bound - (1.0 - t) * s;
+                scales[i] = s * s;
+                break;
+            case Infinite::Both:
+                s = 1.0 / (1.0 - t * t);
+                xs[i] = t * s;
+                scales[i] = (1.0 + t * t) * s * s;
+                break;
+        }
+    }
+    problem.evaluations += count;
+    MathError error = problem.integrand(problem.state, xs.data(), gs, count);
+    if (error != MathError::None) {
+        problem.failure = error;
+        return false;
+    }
+    // An integrand that vanishes far out stays 0, whatever dx/dt is
+    for (size_t i = 0; i < count; i++) gs[i] = gs[i] == 0.0 ? 0.0 : gs[i] * scales[i];
+    return true;
+}
+
+double target(const Quadrature::Tolerance& tolerance, double value) {
+    return std::max(tolerance.absolute, tolerance.relative * std::abs(value));
+}
+
+struct Segment {
+    double a, b;
+    double value;
+    double error;
+    double floor;   // rounding error of 'value'; splitting cannot get below it
+    int depth;      // times split from the whole range
+};
+
+struct ByError {
+    bool operator()(const Segment& lhs, const Segment& rhs) const { return lhs.error < rhs.error; }
+};
+
+// The rule's nodes for [a, b]: 7 left of the center, the center, 7 right of it
+void ruleNodes(double a, double b, double* ts) {
+    const double center = 0.5 * (a + b), half = 0.5 * (b - a);
+    for (size_t j = 0; j < 7; j++) {
+        ts[j] = center - half * KronrodNodes[j];
+        ts[14 - j] = center + half * KronrodNodes[j];
+    }
+    ts[7] = center;
+}
+
+// The 15-point Kronrod estimate of [a, b] from the integrand at ruleNodes(),
+// with QUADPACK's error estimate: the difference to the 7-point Gauss
+// estimate, scaled down as it falls below the variation of the integrand
+Segment rule(double a, double b, const double* g, int depth) {
+    const double half = 0.5 * (b - a);
+    double kronrod = KronrodWeights[7] * g[7];
+    double gauss = GaussWeights[3] * g[7];
+    double absolute = std::abs(kronrod);
+    for (size_t j = 0; j < 7; j++) {
+        const double left = g[j], right = g[14 - j];
+        kronrod += KronrodWeights[j] * (left + right);
+        absolute += KronrodWeights[j] * (std::abs(left) + std::abs(right));
+        if (j % 2 == 1) gauss += GaussWeights[j / 2] * (left + right);
+    }
+    const double mean = 0.5 * kronrod;
+    double variation = KronrodWeights[7] * std::abs(g[7] - mean);
+    for (size_t j = 0; j < 7; j++) {
+        variation += KronrodWeights[j] * (std::abs(g[j] - mean) + std::abs(g[14 - j] - mean));
+    }
+
+    Segment segment;
+    segment.a = a;
+    segment.b = b;
+    segment.depth = depth;
+    segment.value = kronrod * half;
+    segment.error = std::abs((kronrod - gauss) * half);
+    variation *= std::abs(half);
+    absolute *= std::abs(half);
+    if (variation != 0.0 && segment.error != 0.0) {
+        segment.error = variation * std::min(1.0, std::pow(200.0 * segment.error / variation, 1.5));
+    }
+    segment.floor = 50.0 * Epsilon * absolute;
+    segment.error = std::max(segment.error, segment.floor);
+    return segment;
+}
+
+// Tanh-sinh quadrature of [a, b]: x = c + h tanh(pi/2 sinh(t)) on a grid of
+// t, halving the step until two estimates agree. The nodes crowd into the
+// ends so fast that integrable singularities there hardly matter; nodes
+// closer to an end than doubles can tell are left out, and the outermost
+// terms stand in for what they would have added to the error.
+Quadrature::Result tanhSinh(Problem& problem, double a, double b, const Quadrature::Tolerance& tolerance) {
+    Quadrature::Result result;
+    result.value = NaN;
+    result.error = NaN;
+    const double half = 0.5 * (b - a);
+    std::vector<double> ts, weights, gs;
+    double sum = 0.0;       // sum of weight * g over every node so far
+    double previous = NaN;
+    for (int level = 0; level <= MaxLevel; level++) {
+        const double step = std::ldexp(1.0, -level);
+        ts.clear();
+        weights.clear();
+        size_t outermost[2] = { 0, 0 };     // last left and right node, 0 for none
+        // Level 0 takes every multiple of the step, later levels the new odd ones
+        bool leftDone = false, rightDone = false;
+        for (int k = level == 0 ? 0 : 1; !(leftDone && rightDone); k += level == 0 ? 1 : 2) {
+            const double t = k * step;
+            const double u = HalfPi * std::sinh(t);
+            const double e = std::exp(u);
+            // 1 - tanh(u) and 1 / cosh(u)^2 without cancellation
+            const double distance = half * 2.0 / (e * e + 1.0);
+            const double weight = half * HalfPi * std::cosh(t) * 4.0 / ((e + 1.0 / e) * (e + 1.0 / e));
+            if (weight == 0.0 || distance == 0.0) break;
+            if (k == 0) {
+                ts.push_back(a + half);
+                weights.push_back(weight);
+                continue;
+            }
+            const double left = a + distance, right = b - distance;
+            leftDone = leftDone || !(left > a);
+            rightDone = rightDone || !(right < b);
+            if (!leftDone) {
+                outermost[0] = ts.size();
+                ts.push_back(left);
+                weights.push_back(weight);
+            }
+            if (!rightDone) {
+                outermost[1] = ts.size();
+                ts.push_back(right);
+                weights.push_back(weight);
+            }
+        }
+        gs.resize(ts.size());
+        if (!evaluate(problem, ts.data(), gs.data(), ts.size())) return result;
+        for (size_t i = 0; i < ts.size(); i++) sum += weights[i] * gs[i];
+        double tail = 0.0;
+        for (size_t i : outermost) {
+            if (i != 0) tail += std::abs(weights[i] * gs[i]);
+        }
+
+        const double estimate = step * sum;
+        if (level > 0) {
+            result.value = estimate;
+            result.error = std::abs(estimate - previous) + tail;
+            // The first two levels are too coarse to agree by anything but chance
+            if (level >= 2 && result.error <= target(tolerance, estimate)) {
+                result.converged = true;
+                break;
+            }
+        }
+        previous = estimate;
+    }
+    return result;
+}
+
+// Pieces a few ulps wide would put nodes onto their ends
+bool splittable(const Segment& segment) {
+    return segment.b - segment.a > 100.0 * Epsilon * (std::abs(segment.a) + std::abs(segment.b));
+}
+
+bool singularEnd(const Segment& segment, double ta, double tb, size_t segments) {
+    if (segment.a != ta && segment.b != tb) return false;
+    if (segment.depth < SingularDepth) return false;
+    return std::ldexp(1.0, segment.depth / 2) > static_cast<double>(segments);
+}
+
+// Adaptive Gauss-Kronrod over [ta, tb], with tanh-sinh as the fallback
+Quadrature::Result adaptive(Problem& problem, double ta, double tb, const Quadrature::Tolerance& tolerance) {
+    Quadrature::Result result;
+    double ts[RoundSegments * 2 * RuleNodes], gs[RoundSegments * 2 * RuleNodes];
+    ruleNodes(ta, tb, ts);
+    if (!evaluate(problem, ts, gs, RuleNodes)) return result;
+
+    std::priority_queue<Segment, std::vector<Segment>, ByError> queue;
+    queue.push(rule(ta, tb, gs, 0));
+    double value = queue.top().value, error = queue.top().error;
+    bool triedTanhSinh = false;
+    Quadrature::Result fallback;
+    fallback.error = NaN;
+    while (!(error <= target(tolerance, value)) && queue.size() < Quadrature::MaxSegments) {
+        const Segment worst = queue.top();
+        if (std::isnan(error) || worst.error <= worst.floor || !splittable(worst)) break;
+
+        if (!triedTanhSinh && singularEnd(worst, ta, tb, queue.size())) {
+            triedTanhSinh = true;
+            fallback = tanhSinh(problem, ta, tb, tolerance);
+            if (problem.failure != MathError::None) {
+                // Nodes the adaptive rule would never have visited
+                problem.failure = MathError::None;
+                fallback.error = NaN;
+            }
+            else if (fallback.converged) {
+                return fallback;
+            }
+        }
+
+        // Every split adds a piece
+        const size_t room = std::min(RoundSegments, Quadrature::MaxSegments - queue.size());
+        Segment round[RoundSegments];
+        size_t split = 0;
+        while (split < room && !queue.empty()) {
+            const Segment& next = queue.top();
+            if (split > 0 && (next.error < 0.5 * worst.error || next.error <= next.floor || !splittable(next))) break;
+            round[split++] = next;
+            queue.pop();
+        }
+        for (size_t i = 0; i < split; i++) {
+            const double middle = 0.5 * (round[i].a + round[i].b);
+            ruleNodes(round[i].a, middle, ts + 2 * i * RuleNodes);
+            ruleNodes(middle, round[i].b, ts + (2 * i + 1) * RuleNodes);
+        }
+        if (!evaluate(problem, ts, gs, split * 2 * RuleNodes)) return result;
+        for (size_t i = 0; i < split; i++) {
+            const Segment& piece = round[i];
+            const double middle = 0.5 * (piece.a + piece.b);
+            const Segment left = rule(piece.a, middle, gs + 2 * i * RuleNodes, piece.depth + 1);
+            const Segment right = rule(middle, piece.b, gs + (2 * i + 1) * RuleNodes, piece.depth + 1);
+            value += left.value + right.value - piece.value;
+            error += left.error + right.error - piece.error;
+            queue.push(left);
+            queue.push(right);
+        }
+    }
+
+    // Running totals drift; add the pieces up afresh
+    result.value = 0.0;
+    result.error = 0.0;
+    for (; !queue.empty(); queue.pop()) {
+        result.value += queue.top().value;
+        result.error += queue.top().error;
+    }
+    result.converged = result.error <= target(tolerance, result.value);
+    if (result.converged) return result;
+
+    if (!triedTanhSinh) {
+        fallback = tanhSinh(problem, ta, tb, tolerance);
+        if (problem.failure != MathError::None) {
+            problem.failure = MathError::None;
+            return result;
+        }
+    }
+    return fallback.error < result.error ? fallback : result;
+}
+
+} // namespace
+
+namespace Quadrature {
+
+Result integrate(Integrand integrand, void* state, double lower, double upper, const Tolerance& tolerance) {
+    Result result;
+    if (std::isnan(lower) || std::isnan(upper)) {
+        result.value = result.error = NaN;
+        return result;
+    }
+    if (lower == upper) {
+        // int(f, inf, inf) is no empty range: it has no meaning at all
+        if (std::isinf(lower)) result.failure = MathError::InvalidInterval;
+        else result.converged = true;
+        return result;
+    }
+    // Integrate upwards; reversed bounds change the sign
+    const double sign = lower < upper ? 1.0 : -1.0;
+    if (upper < lower) std::swap(lower, upper);
+
+    Problem problem;
+    problem.integrand = integrand;
+    problem.state = state;
+    double ta = lower, tb = upper;
+    if (std::isinf(lower) && std::isinf(upper)) {
+        problem.infinite = Infinite::Both;
+        ta = -1.0;
+        tb = 1.0;
+    } else if (std::isinf(upper)) {
+        problem.infinite = Infinite::Upper;
+        problem.bound = lower;
+        ta = 0.0;
+        tb = 1.0;
+    } else if (std::isinf(lower)) {
+        problem.infinite = Infinite::Lower;
+        problem.bound = upper;
+        ta = 0.0;
+        tb = 1.0;
+    }
+
+    result = adaptive(problem, ta, tb, tolerance);
+    result.value *= sign;
+    result.evaluations = problem.evaluations;
+    result.failure = problem.failure;
+    return result;
+}
+
+bool acceptable(const Result& result, const Tolerance& tolerance) {
+    return result.converged || result.error <= NearMiss * target(tolerance, result.value);
+}
+
+} // namespace Quadrature
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include "MathError.hpp"
+
+// Adaptive numerical integration (MathEngine::integral). Gauss-Kronrod 7-15
+// rules are applied to a priority queue of subintervals, always splitting
+// the one with the largest error estimate, until the total error meets the
+// tolerance. When the splitting keeps closing in on an end of the range, the
+// integrand is taken to be singular there and tanh-sinh quadrature, whose
+// nodes cluster doubly exponentially at the ends, is tried instead.
+// Infinite bounds are mapped onto a finite range first, so
+// int(exp(-x^2), -inf, inf) works like any other integral.
+namespace Quadrature {
+
+struct Tolerance {
+    double absolute = 1e-12;
+    double relative = 1e-10;
+};
+
+struct Result {
+    double value = 0.0;
+    double error = 0.0;         // estimated absolute error
+    size_t evaluations = 0;     // integrand evaluations
+    bool converged = false;     // error within the tolerance
+    // First error of the integrand; MathError::InvalidInterval when both
+    // bounds are the same infinity
+    MathError failure = MathError::None;
+};
+
+// Fills ys[0..count) with the integrand at xs[0..count); returns the error of
+// the first failing point, MathError::None if there is none
+using Integrand = MathError (*)(void* state, const double* xs, double* ys, size_t count);
+
+// Integral from 'lower' to 'upper', either of which may be infinite. Stops
+// at the integrand's first error.
+Result integrate(Integrand integrand, void* state, double lower, double upper, const Tolerance& tolerance);
+
+// Whether a result that did not converge is still close enough to the
+// tolerance to stand: within NearMiss times the error it allows, as when an
+// integrable singularity at an end, like that of 1/sqrt(1-x^2) on [-1, 1],
+// keeps the last digits from settling. Divergent integrals miss by many
+// orders of magnitude.
+constexpr double NearMiss = 1e4;
+bool acceptable(const Result& result, const Tolerance& tolerance);
+
+// Limit on the subintervals of the Gauss-Kronrod queue, i.e. on 30 * MaxSegments evaluations
+constexpr size_t MaxSegments = 1000;
+
+} // namespace Quadrature
@@ -0,0 +1,351 @@
+#include "Rational.hpp"
+#include "BigFloat.hpp"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+// Literals further from 1 than this are not taken exactly
+constexpr long long MaxLiteralExponent = 10000;
+
+// Fractions with a 2^a * 5^b denominator print as decimals up to this many places
+constexpr size_t MaxDecimalPlaces = 40;
+
+constexpr long long PowersOfTen[19] = {
+    1ll, 10ll, 100ll, 1000ll, 10000ll, 100000ll, 1000000ll, 10000000ll, 100000000ll,
+    1000000000ll, 10000000000ll, 100000000000ll, 1000000000000ll, 10000000000000ll,
+    100000000000000ll, 1000000000000000ll, 10000000000000000ll, 100000000000000000ll,
+    1000000000000000000ll
+};
+
+// Checked arithmetic; also fails for LLONG_MIN, which Rational never holds
+bool checkedAdd(long long a, long long b, long long& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    if (__builtin_add_overflow(a, b, &out)) return false;
+#else
+    if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b)) return false;
+    out = a + b;
+#endif
+    return out != LLONG_MIN;
+}
+
+bool checkedMultiply(long long a, long long b, long long& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    if (__builtin_mul_overflow(a, b, &out)) return false;
+#else
+    // Operands are never LLONG_MIN
+    if (a != 0 && (b > 0 ? b : -b) > LLONG_MAX / (a > 0 ? a : -a)) return false;
+    out = a * b;
+#endif
+    return out != LLONG_MIN;
+}
+
+long long gcd(long long a, long long b) {
+    return static_cast<long long>(BigInt::gcd(static_cast<std::uint64_t>(a < 0 ? -a : a),
+                                              static_cast<std::uint64_t>(b < 0 ? -b : b)));
+}
+
+BigInt exactQuotient(const BigInt& a, const BigInt& b) {
+    BigInt quotient, remainder;
+    BigInt::divMod(a, b, quotient, remainder);
+    return quotient;
+}
+
+// "1234" with 2 places -> "12.34", "5" with 3 places -> "0.005"
+std::string insertPoint(std::string digits, size_t places, bool negative) {
+    if (digits.size() <= places) digits.insert(0, places + 1 - digits.size(), '0');
+    digits.insert(digits.size() - places, 1, '.');
+    if (negative) digits.insert(0, 1, '-');
+    return digits;
+}
+
+} // namespace
+
+Rational::Rational(long long integer) {
+    if (integer == LLONG_MIN) {
+        wide = std::make_unique<Wide>(Wide{ BigInt(integer), BigInt(1) });
+    } else {
+        numerator = integer;
+    }
+}
+
+Rational::Rational(BigInt numerator, BigInt denominator) {
+    if (denominator.isNegative()) {
+        numerator = -numerator;
+        denominator = -denominator;
+    }
+    const BigInt divisor = BigInt::gcd(numerator, denominator);
+    if (!(divisor == BigInt(1))) {
+        numerator = exactQuotient(numerator, divisor);
+        denominator = exactQuotient(denominator, divisor);
+    }
+    *this = fromParts(std::move(numerator), std::move(denominator));
+}
+
+Rational::Rational(const Rational& other)
+    : numerator(other.numerator), denominator(other.denominator),
+      wide(other.wide ? std::make_unique<Wide>(*other.wide) : nullptr) {}
+
+Rational& Rational::operator=(const Rational& other) {
+    if (this != &other) {
+        numerator = other.numerator;
+        denominator = other.denominator;
+        wide = other.wide ? std::make_unique<Wide>(*other.wide) : nullptr;
+    }
+    return *this;
+}
+
+Rational Rational::fromInt64(long long numerator, long long denominator) {
+    Rational result;
+    result.numerator = numerator;
+    result.denominator = denominator;
+    return result;
+}
+
+Rational Rational::fromParts(BigInt numerator, BigInt denominator) {
+    long long smallNumerator = 0, smallDenominator = 0;
+    if (numerator.toInt64(smallNumerator) && smallNumerator != LLONG_MIN && denominator.toInt64(smallDenominator)) {
+        return fromInt64(smallNumerator, smallDenominator);
+    }
+    Rational result;
+    result.wide = std::make_unique<Wide>(Wide{ std::move(numerator), std::move(denominator) });
+    return result;
+}
+
+bool Rational::parse(std::string_view literal, Rational& out) {
+    // The digits as one integer, scaled by 10^(exponent - fraction digits)
+    std::uint64_t mantissa = 0;
+    bool small = true;
+    bool point = false;
+    long long fractionDigits = 0;
+    size_t i = 0;
+    for (; i < literal.size() && literal[i] != 'e' && literal[i] != 'E'; ++i) {
+        const char c = literal[i];
+        if (c == '.') {
+            if (point) return false;
+            point = true;
+            continue;
+        }
+        if (c < '0' || c > '9') return false;
+        if (point) ++fractionDigits;
+        if (mantissa >= 100000000000000000ull) small = false;
+        else mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+    }
+    const size_t mantissaEnd = i;
+
+    long long exponent = 0;
+    if (i < literal.size()) {
+        const char* begin = literal.data() + i + 1;
+        const char* end = literal.data() + literal.size();
+        if (begin < end && *begin == '+') ++begin;
+        auto parsed = std::from_chars(begin, end, exponent);
+        if (parsed.ec != std::errc() || parsed.ptr != end) return false;
+        if (exponent > MaxLiteralExponent || exponent < -MaxLiteralExponent) return false;
+    }
+    const long long scale = exponent - fractionDigits;
+
+    if (small) {
+        // Common keypad literals stay in 64 bits
+        const long long value = static_cast<long long>(mantissa);
+        if (scale >= 0 && scale <= 18) {
+            long long scaled = 0;
+            if (checkedMultiply(value, PowersOfTen[scale], scaled)) {
+                out = Rational(scaled);
+                return true;
+            }
+        } else if (scale < 0 && scale >= -18) {
+            const long long divisor = gcd(value, PowersOfTen[-scale]);
+            out = fromInt64(value / divisor, PowersOfTen[-scale] / divisor);
+            return true;
+        }
+    }
+
+    std::string digits;
+    for (size_t j = 0; j < mantissaEnd; ++j) {
+        if (literal[j] != '.') digits += literal[j];
+    }
+    BigInt value;
+    if (!BigInt::parse(digits, value)) return false;
+    if (scale >= 0) {
+        out = fromParts(std::move(value.shiftDigitsLeft(static_cast<size_t>(scale))), BigInt(1));
+    } else {
+        out = Rational(std::move(value), std::move(BigInt(1).shiftDigitsLeft(static_cast<size_t>(-scale))));
+    }
+    return true;
+}
+
+bool Rational::fromDouble(double value, Rational& out) {
+    if (!std::isfinite(value)) return false;
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), std::fabs(value));
+    if (!parse(std::string_view(buffer, static_cast<size_t>(result.ptr - buffer)), out)) return false;
+    if (value < 0) out = -out;
+    return true;
+}
+
+bool Rational::isInteger() const {
+    return wide ? wide->denominator == BigInt(1) : denominator == 1;
+}
+
+bool Rational::toInt64(long long& outNumerator, long long& outDenominator) const {
+    if (wide) return false;
+    outNumerator = numerator;
+    outDenominator = denominator;
+    return true;
+}
+
+double Rational::toDouble() const {
+    constexpr long long ExactInDouble = 1ll << 53;
+    if (!wide && numerator <= ExactInDouble && numerator >= -ExactInDouble && denominator <= ExactInDouble) {
+        return static_cast<double>(numerator) / static_cast<double>(denominator);
+    }
+    // Three limbs are more than double precision
+    return BigFloat::divide(BigFloat(getNumerator()), BigFloat(getDenominator()), 3).toDouble();
+}
+
+std::string Rational::toString() const {
+    if (!wide) {
+        if (denominator == 1) return std::to_string(numerator);
+
+        // 1/8 = 125/1000: denominators of only twos and fives terminate
+        std::uint64_t rest = static_cast<std::uint64_t>(denominator);
+        size_t twos = 0, fives = 0;
+        while ((rest & 1) == 0) { rest >>= 1; ++twos; }
+        while (rest % 5 == 0) { rest /= 5; ++fives; }
+        const size_t places = std::max(twos, fives);
+        long long scaled = 0;
+        if (rest == 1 && places <= 18 && checkedMultiply(numerator, PowersOfTen[places] / denominator, scaled)) {
+            const bool negative = scaled < 0;
+            return insertPoint(std::to_string(negative ? -scaled : scaled), places, negative);
+        }
+    }
+
+    const BigInt top = getNumerator();
+    const BigInt bottom = getDenominator();
+    if (bottom.digitCount() <= MaxDecimalPlaces + 1 && !(bottom == BigInt(1))) {
+        BigInt rest = bottom;
+        size_t twos = 0, fives = 0;
+        for (BigInt quotient = rest; quotient.divide(2) == 0; quotient = rest) { rest = quotient; ++twos; }
+        for (BigInt quotient = rest; quotient.divide(5) == 0; quotient = rest) { rest = quotient; ++fives; }
+        const size_t places = std::max(twos, fives);
+        if (rest == BigInt(1) && places <= MaxDecimalPlaces) {
+            BigInt scaled = top * BigInt(2).pow(places - twos) * BigInt(5).pow(places - fives);
+            const bool negative = scaled.isNegative();
+            return insertPoint((negative ? -scaled : scaled).toString(), places, negative);
+        }
+    }
+    if (bottom == BigInt(1)) return top.toString();
+    return top.toString() + "/" + bottom.toString();
+}
+
+Rational Rational::operator-() const {
+    if (!wide) return fromInt64(-numerator, denominator);
+    return fromParts(-wide->numerator, wide->denominator);
+}
+
+Rational Rational::sum(const Rational& a, const Rational& b, bool subtract) {
+    if (!a.wide && !b.wide) {
+        // Knuth's method: work with d = gcd(denominators) so intermediate
+        // products stay small, then reduce by gcd(t, d) only
+        const long long other = subtract ? -b.numerator : b.numerator;
+        const long long divisor = gcd(a.denominator, b.denominator);
+        long long left = 0, right = 0, total = 0, denominator = 0;
+        if (checkedMultiply(a.numerator, b.denominator / divisor, left) &&
+            checkedMultiply(other, a.denominator / divisor, right) && checkedAdd(left, right, total)) {
+            if (total == 0) return Rational();
+            const long long reduction = divisor == 1 ? 1 : gcd(total, divisor);
+            if (checkedMultiply(a.denominator / divisor, b.denominator / reduction, denominator)) {
+                return fromInt64(total / reduction, denominator);
+            }
+        }
+    }
+
+    const BigInt bNumerator = subtract ? -b.getNumerator() : b.getNumerator();
+    const BigInt aDenominator = a.getDenominator(), bDenominator = b.getDenominator();
+    return Rational(a.getNumerator() * bDenominator + bNumerator * aDenominator, aDenominator * bDenominator);
+}
+
+Rational operator*(const Rational& a, const Rational& b) {
+    if (!a.wide && !b.wide) {
+        // Cancel across first, so the result is already in lowest terms
+        const long long left = gcd(a.numerator, b.denominator);
+        const long long right = gcd(b.numerator, a.denominator);
+        long long numerator = 0, denominator = 0;
+        if (checkedMultiply(a.numerator / left, b.numerator / right, numerator) &&
+            checkedMultiply(a.denominator / right, b.denominator / left, denominator)) {
+            return Rational::fromInt64(numerator, denominator);
+        }
+    }
+    return Rational(a.getNumerator() * b.getNumerator(), a.getDenominator() * b.getDenominator());
+}
+
+Rational operator/(const Rational& a, const Rational& b) {
+    if (!b.wide) {
+        const long long sign = b.numerator < 0 ? -1 : 1;
+        return a * Rational::fromInt64(sign * b.denominator, sign * b.numerator);
+    }
+    const bool negative = b.wide->numerator.isNegative();
+    return a * Rational::fromParts(negative ? -b.wide->denominator : b.wide->denominator,
+                                   negative ? -b.wide->numerator : b.wide->numerator);
+}
+
+Rational operator%(const Rational& a, const Rational& b) {
+    return a - (a / b).truncated() * b;
+}
+
+bool operator==(const Rational& a, const Rational& b) {
+    // Values that fit 64 bits are never wide, so the forms are unique
+    if (!a.wide && !b.wide) return a.numerator == b.numerator && a.denominator == b.denominator;
+    if (!a.wide || !b.wide) return false;
+    return a.wide->numerator == b.wide->numerator && a.wide->denominator == b.wide->denominator;
+}
+
+Rational Rational::truncated() const {
+    if (!wide) return Rational(numerator / denominator);
+    return fromParts(exactQuotient(wide->numerator, wide->denominator), BigInt(1));
+}
+
+bool Rational::pow(long long exponent, std::uint64_t maxBits, Rational& out) const {
+    if (exponent == 0) {
+        out = Rational(1);
+        return true;
+    }
+    if (isZero()) {
+        if (exponent < 0) return false;
+        out = Rational();
+        return true;
+    }
+    if (!wide && denominator == 1 && (numerator == 1 || numerator == -1)) {
+        out = Rational((exponent & 1) ? numerator : 1);
+        return true;
+    }
+
+    const std::uint64_t magnitude = exponent < 0 ? 0 - static_cast<std::uint64_t>(exponent)
+                                                 : static_cast<std::uint64_t>(exponent);
+    const double bitsPerPower = wide
+        ? static_cast<double>(std::max(wide->numerator.digitCount(), wide->denominator.digitCount())) * 3.33
+        : std::log2(static_cast<double>(std::max(numerator < 0 ? -numerator : numerator, denominator)));
+    if (bitsPerPower * static_cast<double>(magnitude) > static_cast<double>(maxBits)) return false;
+
+    // Powers of a fraction in lowest terms stay in lowest terms
+    Rational raised;
+    bool done = false;
+    if (!wide && bitsPerPower * static_cast<double>(magnitude) < 62.0) {
+        long long top = 1, bottom = 1;
+        done = true;
+        for (std::uint64_t i = 0; i < magnitude && done; ++i) {
+            done = checkedMultiply(top, numerator, top) && checkedMultiply(bottom, denominator, bottom);
+        }
+        if (done) raised = fromInt64(top, bottom);
+    }
+    if (!done) raised = fromParts(getNumerator().pow(magnitude), getDenominator().pow(magnitude));
+
+    if (exponent > 0) {
+        out = std::move(raised);
+    } else {
+        out = Rational(1) / raised;
+    }
+    return true;
+}
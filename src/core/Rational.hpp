@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "BigInt.hpp"
+
+// Exact fraction in lowest terms with a positive denominator. Works on
+// 64-bit integers and moves to BigInt only when a result does not fit them,
+// and back as soon as it does again, so everyday keypad arithmetic never
+// allocates.
+class Rational {
+public:
+    Rational() = default;
+    Rational(long long integer);
+    Rational(BigInt numerator, BigInt denominator);  // denominator must not be zero
+    Rational(const Rational& other);
+    Rational(Rational&& other) noexcept = default;
+    Rational& operator=(const Rational& other);
+    Rational& operator=(Rational&& other) noexcept = default;
+
+    // Digits with an optional '.' and exponent, no sign ("12", ".5", "1.5e-9")
+    static bool parse(std::string_view literal, Rational& out);
+    // The shortest decimal that round-trips; false for inf and NaN
+    static bool fromDouble(double value, Rational& out);
+
+    bool isZero() const { return wide ? wide->numerator.isZero() : numerator == 0; }
+    bool isNegative() const { return wide ? wide->numerator.isNegative() : numerator < 0; }
+    bool isInteger() const;
+    BigInt getNumerator() const { return wide ? wide->numerator : BigInt(numerator); }
+    BigInt getDenominator() const { return wide ? wide->denominator : BigInt(denominator); }
+    // Whether both parts fit 64 bits, and the parts if they do
+    bool toInt64(long long& outNumerator, long long& outDenominator) const;
+    double toDouble() const;
+
+    // Integers as such, fractions with a power of two and five denominator
+    // as decimals ("0.3"), other fractions as "n/d"
+    std::string toString() const;
+
+    Rational operator-() const;
+    friend Rational operator+(const Rational& a, const Rational& b) { return sum(a, b, false); }
+    friend Rational operator-(const Rational& a, const Rational& b) { return sum(a, b, true); }
+    friend Rational operator*(const Rational& a, const Rational& b);
+    // b must not be zero
+    friend Rational operator/(const Rational& a, const Rational& b);
+    // a - trunc(a / b) * b, like fmod; b must not be zero
+    friend Rational operator%(const Rational& a, const Rational& b);
+    friend bool operator==(const Rational& a, const Rational& b);
+
+    // Integer part, truncated toward zero
+    Rational truncated() const;
+    // False for negative powers of zero and when the numerator or the
+    // denominator of the result would need more than 'maxBits' bits
+    bool pow(long long exponent, std::uint64_t maxBits, Rational& out) const;
+
+private:
+    struct Wide {
+        BigInt numerator;
+        BigInt denominator;
+    };
+
+    long long numerator = 0;    // never LLONG_MIN, so negation cannot overflow
+    long long denominator = 1;
+    std::unique_ptr<Wide> wide; // set while the value does not fit the fields above
+
+    // Parts already in lowest terms, with a positive denominator
+    static Rational fromInt64(long long numerator, long long denominator);
+    static Rational fromParts(BigInt numerator, BigInt denominator);
+    static Rational sum(const Rational& a, const Rational& b, bool subtract);
+};
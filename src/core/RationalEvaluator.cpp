@@ -0,0 +1,146 @@
+#include "RationalEvaluator.hpp"
+#include "Combinatorics.hpp"
+#include <cmath>
+
+namespace {
+
+// Below 2^53 the double kernels are exact
+constexpr double ExactInDouble = 9007199254740992.0;
+
+// Integer part as a long long; false if it does not fit
+bool toInteger(const Rational& value, long long& out) {
+    long long denominator = 0;
+    return value.truncated().toInt64(out, denominator);
+}
+
+} // namespace
+
+bool RationalEvaluator::evaluate(std::string_view source, const std::map<std::string, double>* definitions,
+                                 Rational& result) {
+    this->definitions = definitions;
+    return run(source, result);
+}
+
+bool RationalEvaluator::number(std::string_view literal, Value& out) {
+    return Rational::parse(literal, out) || fail(MathError::NotRational);
+}
+
+bool RationalEvaluator::constant(Constant, size_t at, Value&) {
+    return fail(MathError::NotRational, at);
+}
+
+bool RationalEvaluator::definition(double value, size_t at, Value& out) {
+    return Rational::fromDouble(value, out) || fail(MathError::NotRational, at);
+}
+
+bool RationalEvaluator::variable(size_t at, Value&) {
+    return fail(MathError::NotRational, at);
+}
+
+bool RationalEvaluator::function(const Builtins::Info& builtin, size_t at) {
+    switch (builtin.id) {
+        case FunctionId::Abs:
+        case FunctionId::Fact:
+        case FunctionId::Ncr:
+        case FunctionId::Npr:
+            return true;
+        default:
+            return fail(MathError::NotRational, at);
+    }
+}
+
+bool RationalEvaluator::negate(Value& value) {
+    value = -value;
+    return true;
+}
+
+bool RationalEvaluator::binary(Operator op, Value& a, Value& b, Value& out) {
+    switch (op) {
+        case Operator::Add:      out = a + b; return true;
+        case Operator::Subtract: out = a - b; return true;
+        case Operator::Multiply: out = a * b; return true;
+        case Operator::Divide:
+            if (b.isZero()) return fail(MathError::DivisionByZero);
+            out = a / b;
+            return true;
+        case Operator::Modulo:
+            if (b.isZero()) return fail(MathError::ModuloByZero);
+            out = a % b;
+            return true;
+        default:
+            return power(a, b, out);
+    }
+}
+
+bool RationalEvaluator::power(const Value& base, const Value& exponent, Value& out) {
+    // 2^(1/2) is irrational
+    if (!exponent.isInteger()) return fail(MathError::NotRational);
+    long long n = 0;
+    if (!toInteger(exponent, n)) return fail(MathError::ResultTooLarge);
+    if (n < 0 && base.isZero()) return fail(MathError::DivisionByZero);
+    return base.pow(n, MaxResultBits, out) || fail(MathError::ResultTooLarge);
+}
+
+bool RationalEvaluator::call(FunctionId function, Value* args, std::uint32_t count, Value& out) {
+    switch (function) {
+        case FunctionId::Abs:
+            out = args[0].isNegative() ? -args[0] : args[0];
+            return true;
+        case FunctionId::Fact:
+            return factorial(args[0], out);
+        default:
+            return choose(function, args, count, out);
+    }
+}
+
+bool RationalEvaluator::factorial(const Value& value, Value& out) {
+    // Truncated to an integer, like the double version
+    long long n = 0;
+    if (!toInteger(value, n)) {
+        return fail(value.isNegative() ? MathError::FactorialNegative : MathError::FactorialOverflow);
+    }
+    if (n < 0) return fail(MathError::FactorialNegative);
+    if (n <= 20) {
+        long long product = 1;
+        for (long long i = 2; i <= n; ++i) product *= i;
+        out = Rational(product);
+        return true;
+    }
+    if (std::lgamma(static_cast<double>(n) + 1.0) / std::log(2.0) > static_cast<double>(MaxResultBits)) {
+        return fail(MathError::FactorialOverflow);
+    }
+    out = Rational(BigInt::factorial(static_cast<std::uint32_t>(n)), BigInt(1));
+    return true;
+}
+
+bool RationalEvaluator::choose(FunctionId function, Value* args, std::uint32_t count, Value& out) {
+    const bool combination = function == FunctionId::Ncr;
+    long long n = 0, r = 0;
+    if (!toInteger(args[0], n) || !toInteger(args[1], r)) return fail(MathError::ResultTooLarge);
+    if (n < 0 || r < 0 || r > n) return fail(combination ? MathError::InvalidCombination : MathError::InvalidPermutation);
+    const double top = static_cast<double>(n), bottom = static_cast<double>(r);
+
+    if (count > 2 && !args[2].isZero()) {
+        long long p = 0;
+        if (!toInteger(args[2], p) || top >= ExactInDouble) return fail(MathError::InvalidModulus);
+        MathError error = Combinatorics::checkCombinationModulo(top, bottom, static_cast<double>(p));
+        if (error != MathError::None) return fail(error);
+        out = Rational(static_cast<long long>(Combinatorics::combinationModulo(top, bottom, static_cast<double>(p))));
+        return true;
+    }
+
+    // The 64-bit kernels are exact whenever their result is below 2^53
+    const double approximate = combination ? Combinatorics::combination(top, bottom)
+                                           : Combinatorics::permutation(top, bottom);
+    if (approximate < ExactInDouble) {
+        out = Rational(static_cast<long long>(approximate));
+        return true;
+    }
+
+    const double bits = (std::lgamma(top + 1.0) - std::lgamma(top - bottom + 1.0) -
+                         (combination ? std::lgamma(bottom + 1.0) : 0.0)) / std::log(2.0);
+    if (n > 0xffffffffll || bits > static_cast<double>(MaxResultBits)) return fail(MathError::ResultTooLarge);
+    const std::uint32_t a = static_cast<std::uint32_t>(n), b = static_cast<std::uint32_t>(r);
+    out = Rational(combination ? BigInt::combination(a, b) : BigInt::permutation(a, b), BigInt(1));
+    return true;
+}
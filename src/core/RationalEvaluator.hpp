@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <cstdint>
+#include "Rational.hpp"
+#include "TokenEvaluator.hpp"
+
+// Rational mode: evaluates an expression exactly as a fraction (see
+// Rational). Works on the lexer's tokens (see TokenEvaluator), so 0.1 is
+// 1/10 rather than the nearest double.
+//
+// +, -, *, /, %, integer powers, abs, fact, nCr and nPr are exact; user
+// definitions enter as the shortest decimal of their value. pi, e, x,
+// fractional powers and the other functions report MathError::NotRational,
+// after which callers evaluate in double instead.
+class RationalEvaluator : public TokenEvaluator<RationalEvaluator, Rational> {
+public:
+    // Powers, factorials, nCr and nPr needing more bits fail with ResultTooLarge
+    static constexpr std::uint64_t MaxResultBits = std::uint64_t(1) << 20;
+
+    // 'definitions' maps lower-case names to values and may be null. Returns
+    // false on error. Buffers are kept, so one evaluator is best reused.
+    bool evaluate(std::string_view source, const std::map<std::string, double>* definitions, Rational& result);
+
+private:
+    friend class TokenEvaluator<RationalEvaluator, Rational>;
+    using Value = Rational;
+
+    // TokenEvaluator hooks
+    bool number(std::string_view literal, Value& out);
+    bool constant(Constant constant, size_t at, Value& out);
+    bool definition(double value, size_t at, Value& out);
+    bool variable(size_t at, Value& out);
+    bool function(const Builtins::Info& builtin, size_t at);
+    bool negate(Value& value);
+    bool binary(Operator op, Value& a, Value& b, Value& out);
+    bool call(FunctionId function, Value* args, std::uint32_t count, Value& out);
+
+    bool power(const Value& base, const Value& exponent, Value& out);
+    bool factorial(const Value& n, Value& out);
+    bool choose(FunctionId function, Value* args, std::uint32_t count, Value& out);
+};
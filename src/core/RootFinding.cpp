@@ -0,0 +1,191 @@
+#include "RootFinding.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr double Epsilon = std::numeric_limits<double>::epsilon();
+
+// |f(root)| of a root at most, relative to f at the ends of its bracket;
+// rounding leaves far less, a pole or a jump far more
+constexpr double RootResidual = 1.5e-8;
+
+// Smallest bracket worth splitting around x. The absolute part lets roots
+// at 0 converge in a bounded number of steps.
+double tolerance(double x, double scale) {
+    return 2.0 * Epsilon * std::abs(x) + Epsilon * Epsilon * scale;
+}
+
+struct Evaluator {
+    RootFinding::Function f;
+    void* state;
+    RootFinding::Result& result;
+
+    bool operator()(double x, double* value, double* slope) {
+        result.evaluations++;
+        MathError error = f(state, x, value, slope);
+        if (error == MathError::None) return true;
+        result.failure = error;
+        return false;
+    }
+};
+
+// Brent's zeroin: b is the best estimate, a the previous one and c the other
+// end of the bracket [b, c]; d is the step just taken and e the one before
+RootFinding::Result brent(RootFinding::Function f, void* state, const RootFinding::Bracket& bracket) {
+    RootFinding::Result result;
+    Evaluator evaluate{ f, state, result };
+    const double scale = std::max(std::abs(bracket.lower), std::abs(bracket.upper));
+    double a = bracket.lower, b = bracket.upper, c = b;
+    double fa = bracket.fLower, fb = bracket.fUpper, fc = fb;
+    double d = b - a, e = d;
+    for (result.iterations = 0; result.iterations < RootFinding::MaxIterations; result.iterations++) {
+        if ((fb > 0.0) == (fc > 0.0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (std::abs(fc) < std::abs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        const double tol = 0.5 * tolerance(b, scale);
+        const double middle = 0.5 * (c - b);
+        if (std::abs(middle) <= tol || fb == 0.0) {
+            result.converged = true;
+            break;
+        }
+        if (std::abs(e) >= tol && std::abs(fa) > std::abs(fb)) {
+            // Secant through a and b, or inverse quadratic through a, b and c
+            const double s = fb / fa;
+            double p, q;
+            if (a == c) {
+                p = 2.0 * middle * s;
+                q = 1.0 - s;
+            } else {
+                const double t = fa / fc, r = fb / fc;
+                p = s * (2.0 * middle * t * (t - r) - (b - a) * (r - 1.0));
+                q = (t - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0) q = -q;
+            p = std::abs(p);
+            // Taken if it stays well inside the bracket and shrinks faster than bisection
+            if (2.0 * p < std::min(3.0 * middle * q - std::abs(tol * q), std::abs(e * q))) {
+                e = d;
+                d = p / q;
+            } else {
+                d = e = middle;
+            }
+        } else {
+            d = e = middle;
+        }
+        a = b;
+        fa = fb;
+        b += std::abs(d) > tol ? d : std::copysign(tol, middle);
+        if (!evaluate(b, &fb, nullptr)) break;
+    }
+    result.root = b;
+    result.value = fb;
+    return result;
+}
+
+// Newton's method safeguarded by bisection (rtsafe): f(negative) < 0 < f(positive)
+RootFinding::Result newton(RootFinding::Function f, void* state, const RootFinding::Bracket& bracket) {
+    RootFinding::Result result;
+    Evaluator evaluate{ f, state, result };
+    const double scale = std::max(std::abs(bracket.lower), std::abs(bracket.upper));
+    double negative = bracket.lower, positive = bracket.upper;
+    if (bracket.fLower > 0.0) std::swap(negative, positive);
+
+    // Far from the root Newton may wander; the secant point is a safer start
+    double x = bracket.lower - bracket.fLower * (bracket.upper - bracket.lower) / (bracket.fUpper - bracket.fLower);
+    if (!(x > std::min(negative, positive) && x < std::max(negative, positive))) {
+        x = 0.5 * (negative + positive);
+    }
+    double fx, slope;
+    double step = std::abs(bracket.upper - bracket.lower), previousStep = step;
+    if (evaluate(x, &fx, &slope)) {
+        for (result.iterations = 0; result.iterations < RootFinding::MaxIterations; result.iterations++) {
+            if (fx == 0.0) {
+                result.converged = true;
+                break;
+            }
+            if (fx < 0.0) negative = x;
+            else positive = x;
+            const double tol = tolerance(x, scale);
+            if (step <= tol || std::abs(positive - negative) <= tol) {
+                result.converged = true;
+                break;
+            }
+
+            // Done once Newton stays within rounding of x; next to the root it
+            // may land on an end of the bracket, which it must not step to
+            const double next = x - fx / slope;
+            const bool inside = std::isfinite(next) && (next - negative) * (next - positive) <= 0.0;
+            if (inside && std::abs(next - x) <= tol) {
+                result.converged = true;
+                break;
+            }
+
+            // Newton unless it leaves the bracket or shrinks slower than bisection would
+            previousStep = step;
+            if (inside && next != negative && next != positive &&
+                std::abs(2.0 * fx) <= std::abs(previousStep * slope)) {
+                step = std::abs(next - x);
+                x = next;
+            } else {
+                step = 0.5 * std::abs(positive - negative);
+                x = negative + 0.5 * (positive - negative);
+            }
+            if (!evaluate(x, &fx, &slope)) break;
+        }
+    }
+    result.root = x;
+    result.value = fx;
+    return result;
+}
+
+} // namespace
+
+namespace RootFinding {
+
+Result refine(Function f, void* state, const Bracket& bracket, Method method) {
+    if (bracket.lower == bracket.upper) {
+        Result result;
+        result.root = bracket.lower;
+        result.value = bracket.fLower;
+        result.converged = true;
+        return result;
+    }
+    return method == Method::Newton ? newton(f, state, bracket) : brent(f, state, bracket);
+}
+
+void findBrackets(const double* xs, const double* ys, size_t count, std::vector<Bracket>& out) {
+    out.clear();
+    size_t previous = count;    // last sample with a sign
+    for (size_t i = 0; i < count; i++) {
+        const double y = ys[i];
+        if (!std::isfinite(y)) {
+            previous = count;
+            continue;
+        }
+        if (y == 0.0) {
+            out.push_back({ xs[i], xs[i], 0.0, 0.0 });
+            previous = count;
+            continue;
+        }
+        if (previous < count && (ys[previous] < 0.0) != (y < 0.0)) {
+            out.push_back({ xs[previous], xs[i], ys[previous], y });
+        }
+        previous = i;
+    }
+}
+
+bool isRoot(const Result& result, const Bracket& bracket) {
+    if (!result.converged || result.failure != MathError::None) return false;
+    return std::abs(result.value) <= RootResidual * std::max(std::abs(bracket.fLower), std::abs(bracket.fUpper));
+}
+
+} // namespace RootFinding
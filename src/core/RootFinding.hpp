@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathError.hpp"
+
+// Roots of f in an interval, for solve(f, a, b) (MathEngine::findRoot,
+// MathEngine::findRoots). Both methods refine a bracket [a, b] over which f
+// changes sign, and keep a sign change inside it at every step:
+// - Brent's method needs values only. It takes inverse quadratic or secant
+//   steps while they close in fast enough and bisects otherwise, so it never
+//   needs many more steps than bisection, and usually far fewer.
+// - Newton's method also takes the exact slope (from a Taylor pass) and
+//   converges quadratically near a simple root. A step that would leave the
+//   bracket or does not shrink it fast enough is replaced by bisection.
+// A sign change may also be a pole or a jump, where f does not get small;
+// isRoot() tells the two apart.
+namespace RootFinding {
+
+enum class Method : std::uint8_t { Brent, Newton };
+
+struct Result {
+    double root = 0.0;
+    double value = 0.0;         // f(root)
+    size_t iterations = 0;      // steps of the method
+    size_t evaluations = 0;     // evaluations of f, with its slope for Newton
+    bool converged = false;     // the bracket shrank to a few ulps, or f(root) = 0
+    MathError failure = MathError::None; // first error of f
+};
+
+// Stores f(x) in 'value' and, unless 'slope' is null, f'(x) in 'slope';
+// returns the error of f at x, MathError::None if there is none
+using Function = MathError (*)(void* state, double x, double* value, double* slope);
+
+// [lower, upper] with f of opposite signs at the ends, or an exact root
+// when lower == upper
+struct Bracket {
+    double lower, upper;
+    double fLower, fUpper;
+};
+
+// Root in 'bracket' by the given method
+Result refine(Function f, void* state, const Bracket& bracket, Method method);
+
+// Brackets between successive samples ys[i] = f(xs[i]) with opposite signs,
+// and samples where f is 0, in order; NaN samples (points where f failed)
+// end a run of samples
+void findBrackets(const double* xs, const double* ys, size_t count, std::vector<Bracket>& out);
+
+// Whether the refined sign change is a root of f rather than a pole or a jump
+bool isRoot(const Result& result, const Bracket& bracket);
+
+// Steps of a method at most; bisection alone needs about 64 for doubles
+constexpr size_t MaxIterations = 200;
+// Samples of the scan for sign changes in MathEngine::findRoots
+constexpr size_t ScanPoints = 1025;
+
+} // namespace RootFinding
@@ -0,0 +1,558 @@
+#pragma once
+
+// Generic vector kernels behind SimdMath.hpp. Only included by the
+// per-instruction-set translation units (SimdMathSse2.cpp, SimdMathAvx2.cpp),
+// each of which defines an Isa traits struct in an anonymous namespace and
+// instantiates the kernels with it. Everything here is a template on that
+// struct, so no function compiled for AVX2 can be shared with other TUs.
+//
+// An Isa struct provides, for its vector type Double of Lanes doubles:
+//   load, store, set, setBits, add, sub, mul, div, sqrt,
+//   bitAnd, bitOr, bitXor, bitAndNot, lt, le, eq, select, movemask,
+//   addBits (64-bit integer add), shiftLeft<N>, shiftRight<N> (logical),
+//   HasFma and fms(a, b, c) = a * b - c rounded once (only if HasFma)
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "SimdMath.hpp"
+
+namespace SimdMath {
+
+// Function pointers exported by one instruction set, indexed by FunctionId
+struct KernelTable {
+    Kernel functions[FunctionCount];
+    PowKernel pow;
+};
+
+// nullptr when the translation unit was built without that instruction set
+const KernelTable* sse2Kernels();
+const KernelTable* avx2Kernels();
+
+namespace detail {
+
+template <class Isa>
+struct Vec {
+    typename Isa::Double v;
+
+    Vec(double value) : v(Isa::set(value)) {}
+    explicit Vec(typename Isa::Double raw) : v(raw) {}
+
+    static Vec load(const double* p) { return Vec(Isa::load(p)); }
+    static Vec bits(std::uint64_t pattern) { return Vec(Isa::setBits(pattern)); }
+    void store(double* p) const { Isa::store(p, v); }
+
+    friend Vec operator+(Vec a, Vec b) { return Vec(Isa::add(a.v, b.v)); }
+    friend Vec operator-(Vec a, Vec b) { return Vec(Isa::sub(a.v, b.v)); }
+    friend Vec operator*(Vec a, Vec b) { return Vec(Isa::mul(a.v, b.v)); }
+    friend Vec operator/(Vec a, Vec b) { return Vec(Isa::div(a.v, b.v)); }
+    friend Vec operator-(Vec a) { return Vec(Isa::bitXor(a.v, Isa::setBits(0x8000000000000000ull))); }
+
+    // Comparisons give lane masks (all bits set where true, false for NaN)
+    friend Vec operator<(Vec a, Vec b) { return Vec(Isa::lt(a.v, b.v)); }
+    friend Vec operator<=(Vec a, Vec b) { return Vec(Isa::le(a.v, b.v)); }
+    friend Vec operator>(Vec a, Vec b) { return Vec(Isa::lt(b.v, a.v)); }
+    friend Vec operator>=(Vec a, Vec b) { return Vec(Isa::le(b.v, a.v)); }
+    friend Vec operator==(Vec a, Vec b) { return Vec(Isa::eq(a.v, b.v)); }
+    friend Vec operator&(Vec a, Vec b) { return Vec(Isa::bitAnd(a.v, b.v)); }
+    friend Vec operator|(Vec a, Vec b) { return Vec(Isa::bitOr(a.v, b.v)); }
+    friend Vec operator^(Vec a, Vec b) { return Vec(Isa::bitXor(a.v, b.v)); }
+};
+
+template <class Isa> Vec<Isa> select(Vec<Isa> mask, Vec<Isa> a, Vec<Isa> b) { return Vec<Isa>(Isa::select(mask.v, a.v, b.v)); }
+template <class Isa> Vec<Isa> andNot(Vec<Isa> mask, Vec<Isa> a) { return Vec<Isa>(Isa::bitAndNot(mask.v, a.v)); }
+template <class Isa> Vec<Isa> sqrt(Vec<Isa> a) { return Vec<Isa>(Isa::sqrt(a.v)); }
+template <class Isa> int lanes(Vec<Isa> mask) { return Isa::movemask(mask.v); }
+
+template <class Isa> Vec<Isa> signBit() { return Vec<Isa>::bits(0x8000000000000000ull); }
+template <class Isa> Vec<Isa> abs(Vec<Isa> a) { return andNot(signBit<Isa>(), a); }
+// Lanes where the value is NaN
+template <class Isa> Vec<Isa> isNan(Vec<Isa> a) { return andNot(a == a, Vec<Isa>::bits(~0ull)); }
+
+// Round to the nearest integer (ties to even), exact for |a| < 2^51
+template <class Isa> Vec<Isa> roundNearest(Vec<Isa> a) {
+    const Vec<Isa> magic(6755399441055744.0); // 1.5 * 2^52
+    return (a + magic) - magic;
+}
+// floor(k / 2) for an integer valued k
+template <class Isa> Vec<Isa> halfFloor(Vec<Isa> k) { return roundNearest(k * 0.5 - 0.25); }
+
+// 2^k for an integer valued k in [-1022, 1023]
+template <class Isa> Vec<Isa> pow2(Vec<Isa> k) {
+    Vec<Isa> shifted = k + 6755399441055744.0; // k in the low mantissa bits
+    return Vec<Isa>(Isa::template shiftLeft<52>(Isa::addBits(shifted.v, Isa::setBits(1023))));
+}
+
+// Horner evaluation of c[first] + c[first + 1] z + ... + c[N-1] z^(N-1-first)
+template <class Isa, size_t N> Vec<Isa> polynomial(Vec<Isa> z, const double (&c)[N], size_t first = 0) {
+    Vec<Isa> result(c[N - 1]);
+    for (size_t i = N - 1; i-- > first;) result = result * z + c[i];
+    return result;
+}
+
+// Exact error of a sum: a + b - s where s = fl(a + b) (Knuth's two-sum)
+template <class Isa> Vec<Isa> sumError(Vec<Isa> a, Vec<Isa> b, Vec<Isa> s) {
+    Vec<Isa> bb = s - a;
+    return (a - (s - bb)) + (b - bb);
+}
+
+// Exact error of a product: a * b - p where p = fl(a * b)
+template <class Isa> Vec<Isa> productError(Vec<Isa> a, Vec<Isa> b, Vec<Isa> p) {
+    if constexpr (Isa::HasFma) {
+        return Vec<Isa>(Isa::fms(a.v, b.v, p.v));
+    } else {
+        // Dekker's split into 26-bit halves
+        const Vec<Isa> splitter(134217729.0); // 2^27 + 1
+        Vec<Isa> ca = a * splitter, cb = b * splitter;
+        Vec<Isa> ah = ca - (ca - a), bh = cb - (cb - b);
+        Vec<Isa> al = a - ah, bl = b - bh;
+        return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+    }
+}
+
+// Constants
+
+constexpr double Ln2Hi = 0.6931471805598903;            // 42 bits, k * Ln2Hi exact for |k| < 2^11
+constexpr double Ln2Lo = 5.497923018708371e-14;
+constexpr double InvLn2 = 1.4426950408889634;
+constexpr double Log10Of2Hi = 0.30102999566395283;     // 42 bits
+constexpr double Log10Of2Lo = 2.8363394551044964e-14;
+constexpr double InvLn10 = 0.4342944819032518;
+constexpr double TwoThirdsLo = 3.700743415417188e-17;  // 2/3 - LogCoefficients[0]
+constexpr double PiOver2Part1 = 1.5707963267341256;    // 33 bits each, so k * part is exact
+constexpr double PiOver2Part2 = 6.077100506303966e-11;
+constexpr double PiOver2Part3 = 2.0222662487959506e-21;
+constexpr double TwoOverPi = 0.6366197723675814;
+constexpr double PiOver2Hi = 1.5707963267948966;
+constexpr double PiOver2Lo = 6.123233995736766e-17;
+constexpr double PiOver4Hi = 0.7853981633974483;
+constexpr double PiOver4Lo = 3.061616997868383e-17;
+constexpr double TanPiOver8 = 0.41421356237309503;
+constexpr double Sqrt2 = 1.4142135623730951;
+constexpr double MinNormal = 2.2250738585072014e-308;
+constexpr double MaxFinite = 1.7976931348623157e+308;
+
+// Taylor coefficients (correctly rounded from exact rationals)
+constexpr double ExpCoefficients[] = {   // 1/n!, n = 2..13
+    0.5, 0.16666666666666666, 0.041666666666666664, 0.008333333333333333,
+    0.001388888888888889, 0.0001984126984126984, 2.48015873015873e-05, 2.7557319223985893e-06,
+    2.755731922398589e-07, 2.505210838544172e-08, 2.08767569878681e-09, 1.6059043836821613e-10
+};
+constexpr double SinCoefficients[] = {   // (-1)^i/(2i+1)!, i = 1..8
+    -0.16666666666666666, 0.008333333333333333, -0.0001984126984126984, 2.7557319223985893e-06,
+    -2.505210838544172e-08, 1.6059043836821613e-10, -7.647163731819816e-13, 2.8114572543455206e-15
+};
+constexpr double CosCoefficients[] = {   // (-1)^i/(2i)!, i = 2..9
+    0.041666666666666664, -0.001388888888888889, 2.48015873015873e-05, -2.755731922398589e-07,
+    2.08767569878681e-09, -1.1470745597729725e-11, 4.779477332387385e-14, -1.5619206968586225e-16
+};
+constexpr double LogCoefficients[] = {   // 2/(2i+1), i = 1..10
+    0.6666666666666666, 0.4, 0.2857142857142857, 0.2222222222222222, 0.18181818181818182,
+    0.15384615384615385, 0.13333333333333333, 0.11764705882352941, 0.10526315789473684, 0.09523809523809523
+};
+constexpr double AtanCoefficients[] = {  // (-1)^i/(2i+1), i = 1..20
+    -0.3333333333333333, 0.2, -0.14285714285714285, 0.1111111111111111, -0.09090909090909091,
+    0.07692307692307693, -0.06666666666666667, 0.058823529411764705, -0.05263157894736842, 0.047619047619047616,
+    -0.043478260869565216, 0.04, -0.037037037037037035, 0.034482758620689655, -0.03225806451612903,
+    0.030303030303030304, -0.02857142857142857, 0.02702702702702703, -0.02564102564102564, 0.024390243902439025
+};
+
+// Core approximations. Arguments are assumed to be inside the fast range
+// checked by the kernels below.
+
+// exp(x + xLow) for |x| <= 708
+template <class Isa> Vec<Isa> expCore(Vec<Isa> x, Vec<Isa> xLow = 0.0) {
+    Vec<Isa> k = roundNearest(x * InvLn2);
+    Vec<Isa> r = (x - k * Ln2Hi) - k * Ln2Lo + xLow;   // |r| <= ln2/2
+    Vec<Isa> p = 1.0 + r * (1.0 + r * polynomial(r, ExpCoefficients));
+    return p * pow2(k);
+}
+
+// exp(x) - 1, accurate near 0
+template <class Isa> Vec<Isa> expm1Core(Vec<Isa> x) {
+    Vec<Isa> series = x + x * x * polynomial(x, ExpCoefficients);
+    Vec<Isa> direct = expCore(x) - 1.0;
+    return select(abs(x) < 0.34657359027997264, series, direct);
+}
+
+// Splits a positive normal x into 2^e * m with m in [sqrt(1/2), sqrt(2))
+template <class Isa> void decompose(Vec<Isa> x, Vec<Isa>& e, Vec<Isa>& m) {
+    Vec<Isa> exponentBits(Isa::template shiftRight<52>(x.v));
+    e = (exponentBits | Vec<Isa>::bits(0x4330000000000000ull)) - (4503599627370496.0 + 1023.0);
+    m = (x & Vec<Isa>::bits(0x000FFFFFFFFFFFFFull)) | Vec<Isa>::bits(0x3FF0000000000000ull);
+    Vec<Isa> large = m > Sqrt2;
+    m = select(large, m * 0.5, m);
+    e = select(large, e + 1.0, e);
+}
+
+// log(m) for m in [sqrt(1/2), sqrt(2)), fdlibm style: f - (hfsq - s * (hfsq + R))
+template <class Isa> Vec<Isa> logMantissa(Vec<Isa> m) {
+    Vec<Isa> f = m - 1.0;
+    Vec<Isa> s = f / (2.0 + f);
+    Vec<Isa> z = s * s;
+    Vec<Isa> r = z * polynomial(z, LogCoefficients);
+    Vec<Isa> hfsq = 0.5 * f * f;
+    return f - (hfsq - s * (hfsq + r));
+}
+
+// log(x) for positive normal x
+template <class Isa> Vec<Isa> logCore(Vec<Isa> x) {
+    Vec<Isa> e(0.0), m(0.0);
+    decompose(x, e, m);
+    return e * Ln2Hi + (logMantissa(m) + e * Ln2Lo);
+}
+
+// log(1 + u) for u > -1 with 1 + u normal
+template <class Isa> Vec<Isa> log1pCore(Vec<Isa> u) {
+    Vec<Isa> w = 1.0 + u;
+    Vec<Isa> d = w - 1.0;
+    // log(w) * u / (w - 1) cancels the rounding of 1 + u
+    return select(d == 0.0, u, logCore(w) * (u / d));
+}
+
+// log(x) as hi + lo with about 2^-60 relative error, for pow
+template <class Isa> void logExtended(Vec<Isa> x, Vec<Isa>& hi, Vec<Isa>& lo) {
+    Vec<Isa> e(0.0), m(0.0);
+    decompose(x, e, m);
+    Vec<Isa> f = m - 1.0;                            // exact
+    Vec<Isa> d = 2.0 + f;
+    Vec<Isa> dLow = f - (d - 2.0);                   // 2 + f = d + dLow exactly
+    Vec<Isa> s = f / d;
+    Vec<Isa> product = s * d;
+    Vec<Isa> remainder = ((f - product) - productError(s, d, product)) - s * dLow;
+    Vec<Isa> sLow = remainder / d;                   // f / (2 + f) = s + sLow
+
+    // s r = s z (2/3 + q) with the rounding of every step kept in rLow
+    Vec<Isa> z = s * s;
+    Vec<Isa> zLow = productError(s, s, z);
+    Vec<Isa> q = z * polynomial(z, LogCoefficients, 1);
+    Vec<Isa> c = LogCoefficients[0] + q;
+    Vec<Isa> cLow = sumError(Vec<Isa>(LogCoefficients[0]), q, c) + TwoThirdsLo;
+    Vec<Isa> r = z * c;
+    Vec<Isa> rLow = productError(z, c, r) + (zLow * c + z * cLow);
+    Vec<Isa> sr = s * r;
+    Vec<Isa> srLow = productError(s, r, sr) + s * rLow;
+
+    // e * ln2 + 2s + s r with two-sums; the low parts are all tiny
+    Vec<Isa> a = e * Ln2Hi, b = s + s;
+    Vec<Isa> partial = a + b;
+    Vec<Isa> sum = partial + sr;
+    Vec<Isa> low = (sumError(a, b, partial) + sumError(partial, sr, sum)) +
+                   ((sLow + sLow) * (1.0 + z) + srLow + e * Ln2Lo); // d(s r)/ds ~ 2z
+    hi = sum + low;
+    lo = low - (hi - sum);
+}
+
+// Reduces x (|x| <= 1e6) to r + rLow in [-pi/4, pi/4] and the quadrant k
+template <class Isa> void reduceQuadrant(Vec<Isa> x, Vec<Isa>& k, Vec<Isa>& r, Vec<Isa>& rLow) {
+    k = roundNearest(x * TwoOverPi);
+    Vec<Isa> a = x - k * PiOver2Part1;              // exact
+    Vec<Isa> b = k * PiOver2Part2;                  // exact
+    Vec<Isa> hi = a - b;
+    Vec<Isa> low = ((a - hi) - b) - k * PiOver2Part3;
+    r = hi + low;
+    rLow = low - (r - hi);
+}
+
+template <class Isa> Vec<Isa> sinPolynomial(Vec<Isa> r, Vec<Isa> rLow) {
+    Vec<Isa> z = r * r;
+    return r + (r * z * polynomial(z, SinCoefficients) + rLow * (1.0 - 0.5 * z));
+}
+
+template <class Isa> Vec<Isa> cosPolynomial(Vec<Isa> r, Vec<Isa> rLow) {
+    Vec<Isa> z = r * r;
+    Vec<Isa> hz = 0.5 * z;
+    Vec<Isa> w = 1.0 - hz;
+    return w + (((1.0 - w) - hz) + (z * z * polynomial(z, CosCoefficients) - r * rLow));
+}
+
+// sin(x) for quadrant k (cos uses k + 1)
+template <class Isa> Vec<Isa> sinQuadrant(Vec<Isa> k, Vec<Isa> r, Vec<Isa> rLow) {
+    Vec<Isa> half = halfFloor(k);
+    Vec<Isa> odd = (k - (half + half)) == 1.0;
+    Vec<Isa> negative = (half - (halfFloor(half) * 2.0)) == 1.0;
+    Vec<Isa> result = select(odd, cosPolynomial(r, rLow), sinPolynomial(r, rLow));
+    return result ^ (negative & signBit<Isa>());
+}
+
+// atan(x) for any x but NaN
+template <class Isa> Vec<Isa> atanCore(Vec<Isa> x) {
+    Vec<Isa> a = abs(x);
+    Vec<Isa> inverted = a > 1.0;
+    Vec<Isa> t = select(inverted, 1.0 / a, a);                  // [0, 1]
+    Vec<Isa> shifted = t > TanPiOver8;
+    Vec<Isa> u = select(shifted, (t - 1.0) / (t + 1.0), t);     // |u| <= tan(pi/8)
+    Vec<Isa> z = u * u;
+    Vec<Isa> p = u + u * z * polynomial(z, AtanCoefficients);
+    p = select(shifted, PiOver4Hi + (p + PiOver4Lo), p);
+    p = select(inverted, (PiOver2Hi - p) + PiOver2Lo, p);
+    return p ^ (x & signBit<Isa>());
+}
+
+// Kernels: fast(x) for the lanes inside the fast range, slow(x) flags the
+// lanes the driver recomputes with scalar(x) from the C library
+
+template <class Isa> struct Sin {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot(abs(x) <= 1.0e6, Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> k(0.0), r(0.0), rLow(0.0);
+        reduceQuadrant(x, k, r, rLow);
+        return select(x == 0.0, x, sinQuadrant(k, r, rLow));  // keeps the sign of -0
+    }
+    static double scalar(double x) { return std::sin(x); }
+};
+
+template <class Isa> struct Cos {
+    static Vec<Isa> slow(Vec<Isa> x) { return Sin<Isa>::slow(x); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> k(0.0), r(0.0), rLow(0.0);
+        reduceQuadrant(x, k, r, rLow);
+        return sinQuadrant(k + 1.0, r, rLow);
+    }
+    static double scalar(double x) { return std::cos(x); }
+};
+
+template <class Isa> struct Tan {
+    static Vec<Isa> slow(Vec<Isa> x) { return Sin<Isa>::slow(x); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> k(0.0), r(0.0), rLow(0.0);
+        reduceQuadrant(x, k, r, rLow);
+        Vec<Isa> s = sinPolynomial(r, rLow), c = cosPolynomial(r, rLow);
+        Vec<Isa> odd = (k - halfFloor(k) * 2.0) == 1.0;
+        return select(x == 0.0, x, select(odd, -c / s, s / c));
+    }
+    static double scalar(double x) { return std::tan(x); }
+};
+
+template <class Isa> struct Asin {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot(abs(x) <= 1.0, Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) { return atanCore(x / sqrt((1.0 - x) * (1.0 + x))); }
+    static double scalar(double x) { return std::asin(x); }
+};
+
+template <class Isa> struct Acos {
+    static Vec<Isa> slow(Vec<Isa> x) { return Asin<Isa>::slow(x); }
+    static Vec<Isa> fast(Vec<Isa> x) { return 2.0 * atanCore(sqrt((1.0 - x) / (1.0 + x))); }
+    static double scalar(double x) { return std::acos(x); }
+};
+
+template <class Isa> struct Atan {
+    static Vec<Isa> slow(Vec<Isa> x) { return isNan(x); }
+    static Vec<Isa> fast(Vec<Isa> x) { return atanCore(x); }
+    static double scalar(double x) { return std::atan(x); }
+};
+
+template <class Isa> struct Ln {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot((x >= MinNormal) & (x <= MaxFinite), Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) { return logCore(x); }
+    static double scalar(double x) { return std::log(x); }
+};
+
+template <class Isa> struct Log10 {
+    static Vec<Isa> slow(Vec<Isa> x) { return Ln<Isa>::slow(x); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> e(0.0), m(0.0);
+        decompose(x, e, m);
+        return e * Log10Of2Hi + (e * Log10Of2Lo + logMantissa(m) * InvLn10);
+    }
+    static double scalar(double x) { return std::log10(x); }
+};
+
+template <class Isa> struct Sqrt {
+    static Vec<Isa> slow(Vec<Isa>) { return Vec<Isa>::bits(0); }
+    static Vec<Isa> fast(Vec<Isa> x) { return sqrt(x); }  // correctly rounded in hardware
+    static double scalar(double x) { return std::sqrt(x); }
+};
+
+template <class Isa> struct Cbrt {
+    static Vec<Isa> slow(Vec<Isa> x) { return Ln<Isa>::slow(abs(x)); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> a = abs(x);
+        Vec<Isa> y = expCore(logCore(a) * (1.0 / 3.0));
+        y = y - (y * y * y - a) / (3.0 * y * y);            // one Newton step
+        return y ^ (x & signBit<Isa>());
+    }
+    static double scalar(double x) { return std::cbrt(x); }
+};
+
+template <class Isa> struct Exp {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot(abs(x) <= 708.0, Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) { return expCore(x); }
+    static double scalar(double x) { return std::exp(x); }
+};
+
+template <class Isa> struct Abs {
+    static Vec<Isa> slow(Vec<Isa>) { return Vec<Isa>::bits(0); }
+    static Vec<Isa> fast(Vec<Isa> x) { return abs(x); }
+    static double scalar(double x) { return std::fabs(x); }
+};
+
+template <class Isa> struct Sinh {
+    static Vec<Isa> slow(Vec<Isa> x) { return Exp<Isa>::slow(x); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> t = expm1Core(abs(x));
+        Vec<Isa> result = 0.5 * (t + t / (t + 1.0));
+        return result ^ (x & signBit<Isa>());
+    }
+    static double scalar(double x) { return std::sinh(x); }
+};
+
+template <class Isa> struct Cosh {
+    static Vec<Isa> slow(Vec<Isa> x) { return Exp<Isa>::slow(x); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> e = expCore(abs(x));
+        return 0.5 * e + 0.5 / e;
+    }
+    static double scalar(double x) { return std::cosh(x); }
+};
+
+template <class Isa> struct Tanh {
+    static Vec<Isa> slow(Vec<Isa> x) { return isNan(x); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> a = abs(x);
+        Vec<Isa> saturated = a > 22.0;
+        Vec<Isa> t = expm1Core(select(saturated, Vec<Isa>(0.0), a + a));
+        Vec<Isa> result = select(saturated, Vec<Isa>(1.0), t / (t + 2.0));
+        return result ^ (x & signBit<Isa>());
+    }
+    static double scalar(double x) { return std::tanh(x); }
+};
+
+template <class Isa> struct Asinh {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot(abs(x) < 67108864.0, Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> a = abs(x);
+        Vec<Isa> t = a * a;
+        Vec<Isa> result = log1pCore(a + t / (1.0 + sqrt(1.0 + t)));
+        return result ^ (x & signBit<Isa>());
+    }
+    static double scalar(double x) { return std::asinh(x); }
+};
+
+template <class Isa> struct Acosh {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot((x >= 1.0) & (x < 67108864.0), Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> t = x - 1.0;
+        return log1pCore(t + sqrt(t + t + t * t));
+    }
+    static double scalar(double x) { return std::acosh(x); }
+};
+
+template <class Isa> struct Atanh {
+    static Vec<Isa> slow(Vec<Isa> x) { return andNot(abs(x) < 1.0, Vec<Isa>::bits(~0ull)); }
+    static Vec<Isa> fast(Vec<Isa> x) {
+        Vec<Isa> a = abs(x);
+        Vec<Isa> t = a + a;
+        Vec<Isa> u = select(a < 0.5, t + t * a / (1.0 - a), t / (1.0 - a));
+        return (0.5 * log1pCore(u)) ^ (x & signBit<Isa>());
+    }
+    static double scalar(double x) { return std::atanh(x); }
+};
+
+// Drivers: full vectors straight from the arrays, the tail through a padded buffer
+
+template <class Isa, template <class> class K>
+void applyBlock(const double* x, double* out, size_t count) {
+    using V = Vec<Isa>;
+    V a = V::load(x);
+    V result = K<Isa>::fast(a);
+    int slow = lanes(K<Isa>::slow(a));
+    if (slow == 0) {
+        result.store(out);
+        return;
+    }
+    double inputs[Isa::Lanes];
+    a.store(inputs); // out may alias x
+    result.store(out);
+    for (size_t l = 0; l < count; ++l) {
+        if (slow >> l & 1) out[l] = K<Isa>::scalar(inputs[l]);
+    }
+}
+
+template <class Isa, template <class> class K>
+void apply(const double* x, double* out, size_t count) {
+    constexpr size_t W = Isa::Lanes;
+    size_t i = 0;
+    for (; i + W <= count; i += W) applyBlock<Isa, K>(x + i, out + i, W);
+    if (i == count) return;
+
+    double xs[W], results[W];
+    for (size_t l = 0; l < W; ++l) xs[l] = i + l < count ? x[i + l] : 1.0;
+    applyBlock<Isa, K>(xs, results, count - i);
+    for (size_t l = 0; i + l < count; ++l) out[i + l] = results[l];
+}
+
+// pow(base, exponent) = exp(exponent * log(base)) with an extended log.
+// Integer exponents go to the C library, which is exact whenever the result
+// is representable (2^10, 3^4, ...), as do lanes with base <= 0,
+// non-finite operands or a result near the overflow or underflow range
+template <class Isa>
+void powBlock(const double* base, const double* exponent, double* out, size_t count) {
+    using V = Vec<Isa>;
+    V a = V::load(base), b = V::load(exponent);
+    V safeA = select((a >= MinNormal) & (a <= MaxFinite), a, V(1.0));
+    V hi(0.0), lo(0.0);
+    logExtended(safeA, hi, lo);
+    V y = b * hi;
+    V yLow = productError(b, hi, y) + b * lo;
+    V inRange = (a >= MinNormal) & (a <= MaxFinite) & (abs(y) <= 700.0) &
+                andNot(b == roundNearest(b), V::bits(~0ull));
+    V result = expCore(select(inRange, y, V(0.0)), select(inRange, yLow, V(0.0)));
+    int slow = lanes(andNot(inRange, V::bits(~0ull)));
+    if (slow == 0) {
+        result.store(out);
+        return;
+    }
+    double bases[Isa::Lanes], exponents[Isa::Lanes];
+    a.store(bases); // out may alias the operands
+    b.store(exponents);
+    result.store(out);
+    for (size_t l = 0; l < count; ++l) {
+        if (slow >> l & 1) out[l] = std::pow(bases[l], exponents[l]);
+    }
+}
+
+template <class Isa>
+void pow(const double* base, const double* exponent, double* out, size_t count) {
+    constexpr size_t W = Isa::Lanes;
+    size_t i = 0;
+    for (; i + W <= count; i += W) powBlock<Isa>(base + i, exponent + i, out + i, W);
+    if (i == count) return;
+
+    double as[W], bs[W], results[W];
+    for (size_t l = 0; l < W; ++l) {
+        as[l] = i + l < count ? base[i + l] : 1.0;
+        bs[l] = i + l < count ? exponent[i + l] : 1.0;
+    }
+    powBlock<Isa>(as, bs, results, count - i);
+    for (size_t l = 0; i + l < count; ++l) out[i + l] = results[l];
+}
+
+template <class Isa>
+KernelTable makeTable() {
+    KernelTable table{};
+    auto set = [&table](FunctionId id, Kernel kernel) { table.functions[static_cast<size_t>(id)] = kernel; };
+    set(FunctionId::Sin, &apply<Isa, Sin>);
+    set(FunctionId::Cos, &apply<Isa, Cos>);
+    set(FunctionId::Tan, &apply<Isa, Tan>);
+    set(FunctionId::Asin, &apply<Isa, Asin>);
+    set(FunctionId::Acos, &apply<Isa, Acos>);
+    set(FunctionId::Atan, &apply<Isa, Atan>);
+    set(FunctionId::Log, &apply<Isa, Log10>);
+    set(FunctionId::Ln, &apply<Isa, Ln>);
+    set(FunctionId::Sqrt, &apply<Isa, Sqrt>);
+    set(FunctionId::Cbrt, &apply<Isa, Cbrt>);
+    set(FunctionId::Exp, &apply<Isa, Exp>);
+    set(FunctionId::Abs, &apply<Isa, Abs>);
+    set(FunctionId::Sinh, &apply<Isa, Sinh>);
+    set(FunctionId::Cosh, &apply<Isa, Cosh>);
+    set(FunctionId::Tanh, &apply<Isa, Tanh>);
+    set(FunctionId::Asinh, &apply<Isa, Asinh>);
+    set(FunctionId::Acosh, &apply<Isa, Acosh>);
+    set(FunctionId::Atanh, &apply<Isa, Atanh>);
+    table.pow = &pow<Isa>;
+    return table;
+}
+
+} // namespace detail
+} // namespace SimdMath
@@ -0,0 +1,62 @@
+#include "SimdMath.hpp"
+#include "SimdKernels.hpp"
+#include <cmath>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+bool cpuSupportsAvx2() {
+#if defined(_MSC_VER) && defined(_M_X64)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osSavesYmm || !avx || !fma || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+struct Dispatch {
+    const SimdMath::KernelTable* table;
+    const char* name;
+};
+
+const Dispatch& dispatch() {
+    static const Dispatch selected = [] {
+        if (cpuSupportsAvx2()) {
+            if (const SimdMath::KernelTable* table = SimdMath::avx2Kernels()) return Dispatch{ table, "AVX2" };
+        }
+        if (const SimdMath::KernelTable* table = SimdMath::sse2Kernels()) return Dispatch{ table, "SSE2" };
+        return Dispatch{ nullptr, "none" };
+    }();
+    return selected;
+}
+
+} // namespace
+
+SimdMath::Kernel SimdMath::find(FunctionId function) {
+    const KernelTable* table = dispatch().table;
+    return table ? table->functions[static_cast<size_t>(function)] : nullptr;
+}
+
+void SimdMath::pow(const double* base, const double* exponent, double* out, size_t count) {
+    if (const KernelTable* table = dispatch().table) {
+        table->pow(base, exponent, out, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) out[i] = std::pow(base[i], exponent[i]);
+}
+
+const char* SimdMath::instructionSet() {
+    return dispatch().name;
+}
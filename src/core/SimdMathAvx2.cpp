@@ -0,0 +1,56 @@
+// Built with AVX2 and FMA code generation enabled (see CMakeLists.txt); only
+// called after SimdMath.cpp has checked that the CPU supports both
+#include "SimdKernels.hpp"
+
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__AVX2__)
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2 {
+    using Double = __m256d;
+    static constexpr size_t Lanes = 4;
+    static constexpr bool HasFma = true;
+
+    static Double load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Double v) { _mm256_storeu_pd(p, v); }
+    static Double set(double v) { return _mm256_set1_pd(v); }
+    static Double setBits(std::uint64_t bits) { return _mm256_castsi256_pd(_mm256_set1_epi64x(static_cast<long long>(bits))); }
+
+    static Double add(Double a, Double b) { return _mm256_add_pd(a, b); }
+    static Double sub(Double a, Double b) { return _mm256_sub_pd(a, b); }
+    static Double mul(Double a, Double b) { return _mm256_mul_pd(a, b); }
+    static Double div(Double a, Double b) { return _mm256_div_pd(a, b); }
+    static Double sqrt(Double a) { return _mm256_sqrt_pd(a); }
+    static Double fms(Double a, Double b, Double c) { return _mm256_fmsub_pd(a, b, c); }
+
+    static Double bitAnd(Double a, Double b) { return _mm256_and_pd(a, b); }
+    static Double bitOr(Double a, Double b) { return _mm256_or_pd(a, b); }
+    static Double bitXor(Double a, Double b) { return _mm256_xor_pd(a, b); }
+    static Double bitAndNot(Double mask, Double a) { return _mm256_andnot_pd(mask, a); }
+
+    static Double lt(Double a, Double b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Double le(Double a, Double b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    static Double eq(Double a, Double b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static Double select(Double mask, Double a, Double b) { return _mm256_blendv_pd(b, a, mask); }
+    static int movemask(Double mask) { return _mm256_movemask_pd(mask); }
+
+    static Double addBits(Double a, Double b) {
+        return _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(a), _mm256_castpd_si256(b)));
+    }
+    template <int N> static Double shiftLeft(Double a) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), N)); }
+    template <int N> static Double shiftRight(Double a) { return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(a), N)); }
+};
+
+} // namespace
+
+const SimdMath::KernelTable* SimdMath::avx2Kernels() {
+    static const KernelTable table = detail::makeTable<Avx2>();
+    return &table;
+}
+
+#else
+
+const SimdMath::KernelTable* SimdMath::avx2Kernels() { return nullptr; }
+
+#endif
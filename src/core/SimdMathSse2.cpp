@@ -0,0 +1,54 @@
+#include "SimdKernels.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+
+namespace {
+
+// SSE2 is part of x86-64, so this table needs no run time check
+struct Sse2 {
+    using Double = __m128d;
+    static constexpr size_t Lanes = 2;
+    static constexpr bool HasFma = false;
+
+    static Double load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, Double v) { _mm_storeu_pd(p, v); }
+    static Double set(double v) { return _mm_set1_pd(v); }
+    static Double setBits(std::uint64_t bits) { return _mm_castsi128_pd(_mm_set1_epi64x(static_cast<long long>(bits))); }
+
+    static Double add(Double a, Double b) { return _mm_add_pd(a, b); }
+    static Double sub(Double a, Double b) { return _mm_sub_pd(a, b); }
+    static Double mul(Double a, Double b) { return _mm_mul_pd(a, b); }
+    static Double div(Double a, Double b) { return _mm_div_pd(a, b); }
+    static Double sqrt(Double a) { return _mm_sqrt_pd(a); }
+
+    static Double bitAnd(Double a, Double b) { return _mm_and_pd(a, b); }
+    static Double bitOr(Double a, Double b) { return _mm_or_pd(a, b); }
+    static Double bitXor(Double a, Double b) { return _mm_xor_pd(a, b); }
+    static Double bitAndNot(Double mask, Double a) { return _mm_andnot_pd(mask, a); }
+
+    static Double lt(Double a, Double b) { return _mm_cmplt_pd(a, b); }
+    static Double le(Double a, Double b) { return _mm_cmple_pd(a, b); }
+    static Double eq(Double a, Double b) { return _mm_cmpeq_pd(a, b); }
+    static Double select(Double mask, Double a, Double b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+    static int movemask(Double mask) { return _mm_movemask_pd(mask); }
+
+    static Double addBits(Double a, Double b) {
+        return _mm_castsi128_pd(_mm_add_epi64(_mm_castpd_si128(a), _mm_castpd_si128(b)));
+    }
+    template <int N> static Double shiftLeft(Double a) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(a), N)); }
+    template <int N> static Double shiftRight(Double a) { return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(a), N)); }
+};
+
+} // namespace
+
+const SimdMath::KernelTable* SimdMath::sse2Kernels() {
+    static const KernelTable table = detail::makeTable<Sse2>();
+    return &table;
+}
+
+#else
+
+const SimdMath::KernelTable* SimdMath::sse2Kernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,300 @@
+#include "Taylor.hpp"
+#include "Builtins.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr size_t Capacity = TaylorMath::MaxOrder + 1;
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+constexpr double Ln10 = 2.30258509299404568402;
+
+using Kernel = double (*)(double base, double exponent);
+
+bool isConstant(const double* a, size_t order) {
+    for (size_t k = 1; k <= order; ++k) {
+        if (a[k] != 0.0) return false;
+    }
+    return true;
+}
+
+// a^r for a constant r, with a(t0)^r = kernel(a(t0), r). The recurrence
+// a p' = r a' p needs a(t0) != 0; at a zero of order m, a^r = t^(m r) * (a / t^m)^r
+// has a series only when m r is a whole number.
+void raise(const double* a, double r, Kernel kernel, double* out, size_t order) {
+    out[0] = kernel(a[0], r);
+    if (a[0] != 0.0) {
+        for (size_t k = 1; k <= order; ++k) {
+            double sum = 0.0;
+            for (size_t i = 1; i <= k; ++i) {
+                sum += ((r + 1.0) * static_cast<double>(i) - static_cast<double>(k)) * a[i] * out[k - i];
+            }
+            out[k] = sum / (static_cast<double>(k) * a[0]);
+        }
+        return;
+    }
+
+    size_t m = 1;
+    while (m <= order && a[m] == 0.0) ++m;
+    if (r == 0.0 || (m > order && r >= 1.0)) {
+        std::fill(out + 1, out + order + 1, 0.0);
+        return;
+    }
+    // A pole, or a zero of an order the series does not show (sqrt(x^2) at 0)
+    if (r < 0.0 || m > order) {
+        std::fill(out + 1, out + order + 1, NaN);
+        return;
+    }
+    const double shift = static_cast<double>(m) * r;
+    if (shift != std::floor(shift)) {
+        // Derivatives below the order of the zero vanish, the others are infinite
+        for (size_t k = 1; k <= order; ++k) out[k] = static_cast<double>(k) < shift ? 0.0 : NaN;
+        return;
+    }
+    const size_t e = static_cast<size_t>(shift);
+    double leading[Capacity];
+    raise(a + m, r, kernel, leading, order - m);
+    for (size_t k = 1; k <= order; ++k) {
+        if (k < e) out[k] = 0.0;
+        else if (k - e <= order - m) out[k] = leading[k - e];
+        else out[k] = NaN;     // needs coefficients of 'a' past 'order'
+    }
+}
+
+// e^a(t), with e^a(t0) = value
+void exponential(const double* a, double value, double* out, size_t order) {
+    out[0] = value;
+    for (size_t k = 1; k <= order; ++k) {
+        double sum = 0.0;
+        for (size_t i = 1; i <= k; ++i) sum += static_cast<double>(i) * a[i] * out[k - i];
+        out[k] = sum / static_cast<double>(k);
+    }
+}
+
+// sin/cos, or sinh/cosh for sign = 1: s' = c a', c' = -+ s a'. The caller
+// sets s[0] and c[0]
+void sineCosine(const double* a, double sign, double* s, double* c, size_t order) {
+    for (size_t k = 1; k <= order; ++k) {
+        double sumS = 0.0, sumC = 0.0;
+        for (size_t i = 1; i <= k; ++i) {
+            sumS += static_cast<double>(i) * a[i] * c[k - i];
+            sumC += static_cast<double>(i) * a[i] * s[k - i];
+        }
+        s[k] = sumS / static_cast<double>(k);
+        c[k] = sign * sumC / static_cast<double>(k);
+    }
+}
+
+// tan, or tanh for sign = -1: t' = (1 + sign t^2) a'
+void tangent(const double* a, double value, double sign, double* out, size_t order) {
+    double slope[Capacity];     // 1 + sign t^2
+    out[0] = value;
+    slope[0] = 1.0 + sign * value * value;
+    for (size_t k = 1; k <= order; ++k) {
+        double sum = 0.0;
+        for (size_t i = 1; i <= k; ++i) sum += static_cast<double>(i) * a[i] * slope[k - i];
+        out[k] = sum / static_cast<double>(k);
+
+        double square = 0.0;
+        for (size_t i = 0; i <= k; ++i) square += out[i] * out[k - i];
+        slope[k] = sign * square;
+    }
+}
+
+// 1 + sign a^2
+void shiftedSquare(const double* a, double sign, double* out, size_t order) {
+    TaylorMath::multiply(a, a, out, order);
+    for (size_t k = 0; k <= order; ++k) out[k] *= sign;
+    out[0] += 1.0;
+}
+
+// Inverse functions, y' = g(a) a'; 'g' is filled with order - 1 coefficients
+// by 'derivative'
+template <typename Derivative>
+void inverse(const double* a, double value, double* out, size_t order, Derivative derivative) {
+    double g[Capacity];
+    if (order > 0) derivative(g, order - 1);
+    TaylorMath::integrate(a, g, value, out, order);
+}
+
+} // namespace
+
+namespace TaylorMath {
+
+void add(const double* a, const double* b, double* out, size_t order) {
+    for (size_t k = 0; k <= order; ++k) out[k] = a[k] + b[k];
+}
+
+void subtract(const double* a, const double* b, double* out, size_t order) {
+    for (size_t k = 0; k <= order; ++k) out[k] = a[k] - b[k];
+}
+
+void multiply(const double* a, const double* b, double* out, size_t order) {
+    for (size_t k = 0; k <= order; ++k) {
+        double sum = 0.0;
+        for (size_t i = 0; i <= k; ++i) sum += a[i] * b[k - i];
+        out[k] = sum;
+    }
+}
+
+void divide(const double* a, const double* b, double* out, size_t order) {
+    out[0] = a[0] / b[0];
+    for (size_t k = 1; k <= order; ++k) {
+        double sum = a[k];
+        for (size_t i = 1; i <= k; ++i) sum -= b[i] * out[k - i];
+        out[k] = sum / b[0];
+    }
+}
+
+void modulo(const double* a, const double* b, double* out, size_t order) {
+    // fmod(a, b) = a - q b with q = trunc(a / b), fixed around t0
+    out[0] = std::fmod(a[0], b[0]);
+    const double q = std::round((a[0] - out[0]) / b[0]);
+    for (size_t k = 1; k <= order; ++k) out[k] = a[k] - q * b[k];
+}
+
+void power(const double* base, const double* exponent, double* out, size_t order) {
+    if (isConstant(exponent, order)) {
+        raise(base, exponent[0], [](double a, double r) { return std::pow(a, r); }, out, order);
+        return;
+    }
+    // a^b = e^(b ln a), defined around t0 only for a positive base
+    const double value = std::pow(base[0], exponent[0]);
+    if (!(base[0] > 0.0)) {
+        const bool zero = base[0] == 0.0 && isConstant(base, order) && exponent[0] > 0.0;
+        out[0] = value;
+        std::fill(out + 1, out + order + 1, zero ? 0.0 : NaN);
+        return;
+    }
+    double logarithm[Capacity], product[Capacity];
+    function(FunctionId::Ln, base, base, base, logarithm, order);
+    multiply(exponent, logarithm, product, order);
+    exponential(product, value, out, order);
+}
+
+void negate(const double* a, double* out, size_t order) {
+    for (size_t k = 0; k <= order; ++k) out[k] = -a[k];
+}
+
+void reciprocal(const double* a, double* out, size_t order) {
+    out[0] = 1.0 / a[0];
+    for (size_t k = 1; k <= order; ++k) {
+        double sum = 0.0;
+        for (size_t i = 1; i <= k; ++i) sum += a[i] * out[k - i];
+        out[k] = -sum / a[0];
+    }
+}
+
+void function(FunctionId function, const double* a, const double* b, const double* c, double* out, size_t order) {
+    const double value = Builtins::get(function).function(a[0], b[0], c[0]);
+    double other[Capacity];
+    switch (function) {
+        case FunctionId::Sin:
+            out[0] = value;
+            other[0] = std::cos(a[0]);
+            sineCosine(a, -1.0, out, other, order);
+            break;
+        case FunctionId::Cos:
+            out[0] = value;
+            other[0] = std::sin(a[0]);
+            sineCosine(a, -1.0, other, out, order);
+            break;
+        case FunctionId::Tan:  tangent(a, value, 1.0, out, order); break;
+        case FunctionId::Sinh:
+            out[0] = value;
+            other[0] = std::cosh(a[0]);
+            sineCosine(a, 1.0, out, other, order);
+            break;
+        case FunctionId::Cosh:
+            out[0] = value;
+            other[0] = std::sinh(a[0]);
+            sineCosine(a, 1.0, other, out, order);
+            break;
+        case FunctionId::Tanh: tangent(a, value, -1.0, out, order); break;
+        case FunctionId::Exp:  exponential(a, value, out, order); break;
+        case FunctionId::Sqrt:
+            raise(a, 0.5, [](double x, double) { return std::sqrt(x); }, out, order);
+            break;
+        case FunctionId::Cbrt:
+            raise(a, 1.0 / 3.0, [](double x, double) { return std::cbrt(x); }, out, order);
+            break;
+        case FunctionId::Ln:
+        case FunctionId::Log:
+            inverse(a, value, out, order, [&](double* g, size_t n) {
+                reciprocal(a, g, n);
+                if (function == FunctionId::Log) {
+                    for (size_t k = 0; k <= n; ++k) g[k] /= Ln10;
+                }
+            });
+            break;
+        case FunctionId::Asin:
+        case FunctionId::Acos:
+            // +-(1 - a^2)^(-1/2)
+            inverse(a, value, out, order, [&](double* g, size_t n) {
+                shiftedSquare(a, -1.0, other, n);
+                raise(other, -0.5, [](double x, double r) { return std::pow(x, r); }, g, n);
+                if (function == FunctionId::Acos) negate(g, g, n);
+            });
+            break;
+        case FunctionId::Atan:
+            inverse(a, value, out, order, [&](double* g, size_t n) {
+                shiftedSquare(a, 1.0, other, n);
+                reciprocal(other, g, n);
+            });
+            break;
+        case FunctionId::Asinh:
+        case FunctionId::Acosh:
+            // (a^2 +- 1)^(-1/2)
+            inverse(a, value, out, order, [&](double* g, size_t n) {
+                shiftedSquare(a, 1.0, other, n);
+                if (function == FunctionId::Acosh) other[0] -= 2.0;
+                raise(other, -0.5, [](double x, double r) { return std::pow(x, r); }, g, n);
+            });
+            break;
+        case FunctionId::Atanh:
+            inverse(a, value, out, order, [&](double* g, size_t n) {
+                shiftedSquare(a, -1.0, other, n);
+                reciprocal(other, g, n);
+            });
+            break;
+        case FunctionId::Abs: {
+            // At 0 the side that t > t0 moves a to, like most AD tools
+            size_t k = 0;
+            while (k < order && a[k] == 0.0) ++k;
+            if (a[k] < 0.0) negate(a, out, order);
+            else std::copy(a, a + order + 1, out);
+            break;
+        }
+        default:
+            // fact, nCr, nPr truncate their arguments: steps, flat between them
+            std::fill(out + 1, out + order + 1, 0.0);
+            break;
+    }
+    out[0] = value;
+}
+
+void integrate(const double* a, const double* g, double value, double* out, size_t order) {
+    out[0] = value;
+    for (size_t k = 1; k <= order; ++k) {
+        double sum = 0.0;
+        for (size_t i = 1; i <= k; ++i) sum += static_cast<double>(i) * a[i] * g[k - i];
+        out[k] = sum / static_cast<double>(k);
+    }
+}
+
+void compose(const double* f, const double* a, double* out, size_t order) {
+    // Horner's rule in d = a - a(t0), which has no constant term
+    double d[Capacity], product[Capacity];
+    d[0] = 0.0;
+    std::copy(a + 1, a + order + 1, d + 1);
+    out[0] = f[order];
+    std::fill(out + 1, out + order + 1, 0.0);
+    for (size_t k = order; k-- > 0;) {
+        multiply(out, d, product, order);
+        std::copy(product, product + order + 1, out);
+        out[0] += f[k];
+    }
+}
+
+} // namespace TaylorMath
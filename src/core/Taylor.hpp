@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include "CompiledExpression.hpp"
+
+// Truncated Taylor series in one variable t, for automatic differentiation
+// (MathEngine::derivative). A series of order n is stored as n + 1 doubles
+// where coefficient k is f^(k)(t0) / k!: the first is the value, the second
+// the derivative. Order 1 is the usual dual number; diff() nested inside
+// diff() needs one more order per level.
+//
+// Coefficient 0 is computed exactly like the interpreter does, and the others
+// follow from the operands' coefficients by the standard recurrences, so
+// derivatives are exact up to rounding instead of the half-precision of
+// finite differences. Domain errors are the caller's business: they depend
+// on coefficient 0 only. Where the derivative does not exist (sqrt(x) at 0)
+// the coefficients are NaN or infinite.
+//
+// Outputs must not overlap the inputs.
+namespace TaylorMath {
+
+// Highest order, i.e. the deepest nesting of diff()
+constexpr size_t MaxOrder = 24;
+
+void add(const double* a, const double* b, double* out, size_t order);
+void subtract(const double* a, const double* b, double* out, size_t order);
+void multiply(const double* a, const double* b, double* out, size_t order);
+void divide(const double* a, const double* b, double* out, size_t order);
+void modulo(const double* a, const double* b, double* out, size_t order);
+void power(const double* base, const double* exponent, double* out, size_t order);
+void negate(const double* a, double* out, size_t order);
+void reciprocal(const double* a, double* out, size_t order);
+
+// Built-in functions in radians, like Builtins; not the calculus operators
+void function(FunctionId function, const double* a, const double* b, const double* c, double* out, size_t order);
+
+// y(t) with y(t0) = value and y' = g a', i.e. y_k = (1/k) sum i a_i g_(k-i);
+// 'g' needs order - 1 coefficients
+void integrate(const double* a, const double* g, double value, double* out, size_t order);
+
+// f(a(t)) for the series f around a(t0), i.e. sum f_k (a(t) - a(t0))^k
+void compose(const double* f, const double* a, double* out, size_t order);
+
+} // namespace TaylorMath
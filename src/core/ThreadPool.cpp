@@ -0,0 +1,127 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace {
+
+// Set on workers, and on a caller while it runs a loop
+thread_local bool insideLoop = false;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) : threadCount(std::max<size_t>(threads, 1)) {}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::defaultThreadCount() {
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::setThreadCount(size_t threads) {
+    std::lock_guard<std::mutex> loop(loopMutex);
+    stop();
+    threadCount = std::max<size_t>(threads, 1);
+}
+
+void ThreadPool::run(size_t count, Task task, void* state) {
+    if (count == 0) return;
+    if (threadCount == 1 || count == 1 || insideLoop || !loopMutex.try_lock()) {
+        for (size_t i = 0; i < count; i++) task(state, i);
+        return;
+    }
+    std::lock_guard<std::mutex> loop(loopMutex, std::adopt_lock);
+    if (workers.empty()) start();
+
+    for (size_t t = 0; t < threadCount; t++) {
+        std::lock_guard<std::mutex> lock(ranges[t].mutex);
+        ranges[t].begin = count * t / threadCount;
+        ranges[t].end = count * (t + 1) / threadCount;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = task;
+        this->state = state;
+        busy = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    insideLoop = true;
+    work(0);
+    insideLoop = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy == 0; });
+}
+
+void ThreadPool::work(size_t thread) {
+    size_t index;
+    while (next(thread, index)) task(state, index);
+}
+
+bool ThreadPool::next(size_t thread, size_t& index) {
+    {
+        Range& own = ranges[thread];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+            index = own.begin++;
+            return true;
+        }
+    }
+    // Steal the back half of the first range with work left; one lock at a time
+    for (size_t i = 1; i < threadCount; i++) {
+        Range& victim = ranges[(thread + i) % threadCount];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) continue;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+        Range& own = ranges[thread];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        index = begin;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerMain(size_t thread, size_t seen) {
+    insideLoop = true;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        work(thread);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) done.notify_one();
+    }
+}
+
+void ThreadPool::start() {
+    ranges.reset(new Range[threadCount]);
+    stopping = false;
+    for (size_t t = 1; t < threadCount; t++) workers.emplace_back(&ThreadPool::workerMain, this, t, generation);
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+}
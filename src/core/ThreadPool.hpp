@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads for the data-parallel loops of int() and sum(). A loop of
+// 'count' indices is cut into one contiguous range per thread; each thread
+// takes indices from the front of its own range, and a thread that runs dry
+// steals the back half of another's, so uneven work (a slow region of an
+// integrand) still keeps every core busy. The calling thread works too.
+//
+// Which thread runs an index is left to chance: bodies must write their
+// results by index and reduce them afterwards in a fixed order, so results
+// do not depend on the number of threads.
+//
+// One loop runs at a time. Loops started from inside a body, or while
+// another thread's loop is running, run on the calling thread alone.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = defaultThreadCount());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool of the calculator's evaluations
+    static ThreadPool& shared();
+    static size_t defaultThreadCount();
+
+    // Threads including the caller; 1 runs loops serially. Waits for a
+    // running loop; not to be called from inside a body.
+    void setThreadCount(size_t threads);
+    size_t getThreadCount() const { return threadCount; }
+
+    // Calls body(index) for every index in [0, count) and returns when all
+    // calls are done
+    template <typename Body>
+    void forEach(size_t count, Body& body) {
+        run(count, [](void* state, size_t index) { (*static_cast<Body*>(state))(index); }, &body);
+    }
+
+private:
+    using Task = void (*)(void* state, size_t index);
+
+    // Indices [begin, end) left to one thread
+    struct alignas(64) Range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    size_t threadCount;
+    std::vector<std::thread> workers;       // started by the first parallel loop
+    std::unique_ptr<Range[]> ranges;        // per thread, the caller's first
+    std::mutex loopMutex;                   // held by the thread running a loop
+
+    // Current loop, guarded by 'mutex'
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Task task = nullptr;
+    void* state = nullptr;
+    size_t generation = 0;  // loops started so far
+    size_t busy = 0;        // workers not yet through the current loop
+    bool stopping = false;
+
+    void run(size_t count, Task task, void* state);
+    void work(size_t thread);
+    bool next(size_t thread, size_t& index);
+    void workerMain(size_t thread, size_t seen);   // 'seen': loops already done
+    void start();
+    void stop();
+};
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Builtins.hpp"
+#include "ExpressionLexer.hpp"
+#include "MathError.hpp"
+
+// Front end of the evaluators that compute directly on the lexer's tokens
+// instead of a compiled program (BigEvaluator, RationalEvaluator), so
+// literals reach them exactly as written. Same grammar, precedence and
+// parse errors as ExpressionParser; Derived supplies the arithmetic:
+//
+//   bool number(std::string_view literal, Value& out);
+//   bool constant(Constant constant, size_t at, Value& out);    // pi, e
+//   bool definition(double value, size_t at, Value& out);
+//   bool variable(size_t at, Value& out);                       // x
+//   bool function(const Builtins::Info& builtin, size_t at);    // whether it can be called
+//   bool negate(Value& value);
+//   bool binary(Operator op, Value& a, Value& b, Value& out);
+//   bool call(FunctionId function, Value* args, std::uint32_t count, Value& out);
+//
+// Each hook returns false after fail(), which ends the evaluation.
+template <class Derived, class Value>
+class TokenEvaluator {
+public:
+    MathError getErrorCode() const { return error; }
+    std::string getError() const { return formatError(error, source, errorPosition); }
+
+protected:
+    enum class Operator : std::uint8_t { Add, Subtract, Multiply, Divide, Modulo, Power, Negate, Group };
+    enum class Constant : std::uint8_t { Pi, E, Infinity };
+
+    // Maps lower-case names to values; may be null
+    const std::map<std::string, double>* definitions = nullptr;
+
+    // Buffers are kept between calls
+    bool run(std::string_view text, Value& result);
+
+    bool fail(MathError code) { return fail(code, token().start); }
+    bool fail(MathError code, size_t at) {
+        error = code;
+        errorPosition = at;
+        return false;
+    }
+
+private:
+    // An open '(' and the function it calls, nullptr for plain parentheses
+    struct Group {
+        const Builtins::Info* builtin;
+        std::uint32_t args;     // completed arguments, kept on the value stack
+        size_t valueBase;       // value stack height when the group opened
+    };
+
+    std::string_view source;
+    TokenList tokens;
+    size_t current = 0;
+
+    std::vector<Operator> operators;
+    std::vector<Value> values;
+    std::vector<Group> groups;
+
+    MathError error = MathError::None;
+    size_t errorPosition = 0;
+
+    Derived& derived() { return static_cast<Derived&>(*this); }
+    const Token& token() const { return tokens.tokens[current]; }
+
+    bool parseIdentifier(bool& opened);
+    bool closeArgument();
+    bool closeGroup();
+    bool pushOperator(Operator op);
+    bool reduce(Operator op);
+    bool reduceUntilGroup();
+
+    static bool equalsIgnoreCase(std::string_view text, std::string_view lowerName);
+    static int precedence(Operator op);
+};
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::run(std::string_view text, Value& result) {
+    source = text;
+    error = MathError::None;
+    operators.clear();
+    values.clear();
+    groups.clear();
+    ExpressionLexer::tokenize(source, tokens);
+    current = 0;
+    bool expectOperand = true;
+
+    while (token().kind != TokenKind::End) {
+        const TokenKind kind = token().kind;
+        if (expectOperand) {
+            switch (kind) {
+                case TokenKind::Number:
+                    values.emplace_back();
+                    if (!derived().number(source.substr(token().start, token().length), values.back())) return false;
+                    ++current;
+                    expectOperand = false;
+                    break;
+                case TokenKind::Identifier: {
+                    bool opened = false;
+                    if (!parseIdentifier(opened)) return false;
+                    expectOperand = opened;
+                    break;
+                }
+                case TokenKind::OpenParen:
+                    groups.push_back({ nullptr, 0, values.size() });
+                    operators.push_back(Operator::Group);
+                    ++current;
+                    break;
+                case TokenKind::Minus:
+                    pushOperator(Operator::Negate);
+                    ++current;
+                    break;
+                case TokenKind::Plus:
+                    ++current; // Unary plus changes nothing
+                    break;
+                case TokenKind::BadNumber:
+                    return fail(MathError::InvalidNumber);
+                case TokenKind::CloseParen:
+                case TokenKind::Comma:
+                    return fail(MathError::MissingOperand);
+                default:
+                    return fail(MathError::UnexpectedCharacter);
+            }
+        } else {
+            bool ok = true;
+            switch (kind) {
+                case TokenKind::Plus:       ok = pushOperator(Operator::Add); break;
+                case TokenKind::Minus:      ok = pushOperator(Operator::Subtract); break;
+                case TokenKind::Star:       ok = pushOperator(Operator::Multiply); break;
+                case TokenKind::Slash:      ok = pushOperator(Operator::Divide); break;
+                case TokenKind::Percent:    ok = pushOperator(Operator::Modulo); break;
+                case TokenKind::Caret:      ok = pushOperator(Operator::Power); break;
+                case TokenKind::Comma:      ok = closeArgument(); break;
+                case TokenKind::CloseParen: ok = closeGroup(); break;
+                default:                    return fail(MathError::UnexpectedCharacter);
+            }
+            if (!ok) return false;
+            ++current;
+            expectOperand = (kind != TokenKind::CloseParen);
+        }
+    }
+
+    if (expectOperand) {
+        return fail(values.empty() && operators.empty() ? MathError::EmptyExpression
+                                                        : MathError::UnexpectedEnd);
+    }
+
+    while (!operators.empty()) {
+        if (operators.back() == Operator::Group) return fail(MathError::ExpectedCloseParen);
+        if (!reduce(operators.back())) return false;
+        operators.pop_back();
+    }
+
+    result = std::move(values.back());
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::parseIdentifier(bool& opened) {
+    const size_t start = token().start;
+    std::string_view name = source.substr(start, token().length);
+    ++current;
+
+    if (equalsIgnoreCase(name, "x")) {
+        values.emplace_back();
+        return derived().variable(start, values.back());
+    }
+
+    if (token().kind != TokenKind::OpenParen) {
+        values.emplace_back();
+        if (equalsIgnoreCase(name, "pi")) return derived().constant(Constant::Pi, start, values.back());
+        if (equalsIgnoreCase(name, "e")) return derived().constant(Constant::E, start, values.back());
+        if (equalsIgnoreCase(name, "inf")) return derived().constant(Constant::Infinity, start, values.back());
+        if (definitions) {
+            std::string key(name);
+            for (char& c : key) c = Builtins::foldCase(c);
+            auto it = definitions->find(key);
+            if (it != definitions->end()) return derived().definition(it->second, start, values.back());
+        }
+        return fail(MathError::ExpectedOpenParen, start);
+    }
+
+    const Builtins::Info* builtin = Builtins::find(name);
+    if (!builtin) return fail(MathError::UnknownFunction, start);
+    if (!derived().function(*builtin, start)) return false;
+
+    groups.push_back({ builtin, 0, values.size() });
+    operators.push_back(Operator::Group);
+    ++current; // Skip '('
+    opened = true;
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::closeArgument() {
+    if (!reduceUntilGroup()) return false;
+    if (groups.empty() || !groups.back().builtin) return fail(MathError::UnexpectedComma);
+
+    Group& group = groups.back();
+    if (values.size() != group.valueBase + group.args + 1) return fail(MathError::MissingArgument);
+    if (group.args + 1 >= group.builtin->arity) return fail(MathError::TooManyArguments);
+    ++group.args;
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::closeGroup() {
+    if (!reduceUntilGroup()) return false;
+    if (groups.empty()) return fail(MathError::UnexpectedCloseParen);
+
+    Group group = groups.back();
+    if (values.size() != group.valueBase + group.args + 1) return fail(MathError::MissingOperand);
+
+    groups.pop_back();
+    operators.pop_back(); // Operator::Group
+
+    if (!group.builtin) return true;
+    const bool omittedLast = (group.builtin->flags & Builtins::OptionalLast) && group.args + 2 == group.builtin->arity;
+    if (group.args + 1 < group.builtin->arity && !omittedLast) return fail(MathError::ExpectedComma);
+
+    Value result;
+    if (!derived().call(group.builtin->id, &values[group.valueBase], group.args + 1, result)) return false;
+    values.resize(group.valueBase);
+    values.push_back(std::move(result));
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::pushOperator(Operator op) {
+    if (op != Operator::Negate) {
+        // Same precedence rules as ExpressionParser::pushOperator
+        while (!operators.empty() && operators.back() != Operator::Group) {
+            Operator top = operators.back();
+            if (precedence(top) < precedence(op)) break;
+            if (precedence(top) == precedence(op) && op == Operator::Power) break;
+            if (!reduce(top)) return false;
+            operators.pop_back();
+        }
+    }
+    operators.push_back(op);
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::reduceUntilGroup() {
+    while (!operators.empty() && operators.back() != Operator::Group) {
+        if (!reduce(operators.back())) return false;
+        operators.pop_back();
+    }
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::reduce(Operator op) {
+    const size_t floor = groups.empty() ? 0 : groups.back().valueBase + groups.back().args;
+    if (op == Operator::Negate) {
+        if (values.size() == floor) return fail(MathError::MissingOperand);
+        return derived().negate(values.back());
+    }
+
+    if (values.size() < floor + 2) return fail(MathError::MissingOperand);
+    Value& a = values[values.size() - 2];
+    Value& b = values.back();
+    Value result;
+    if (!derived().binary(op, a, b, result)) return false;
+    values.pop_back();
+    values.back() = std::move(result);
+    return true;
+}
+
+template <class Derived, class Value>
+bool TokenEvaluator<Derived, Value>::equalsIgnoreCase(std::string_view text, std::string_view lowerName) {
+    if (text.size() != lowerName.size()) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[i])) != lowerName[i]) return false;
+    }
+    return true;
+}
+
+template <class Derived, class Value>
+int TokenEvaluator<Derived, Value>::precedence(Operator op) {
+    switch (op) {
+        case Operator::Add:
+        case Operator::Subtract: return 1;
+        case Operator::Multiply:
+        case Operator::Divide:
+        case Operator::Modulo:   return 2;
+        case Operator::Negate:   return 3;
+        case Operator::Power:    return 4;
+        default:                 return 0;
+    }
+}
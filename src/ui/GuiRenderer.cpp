@@ -2,7 +2,9 @@
 #include "ImGuiWidgets.hpp"
 #include "../utils/ThemeManager.hpp"
 #include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstdlib>
 
 GuiRenderer::GuiRenderer() 
     : mathEngine(new MathEngine()), 
@@ -10,13 +12,22 @@ GuiRenderer::GuiRenderer()
       newCalculation(false),
       showHistory(false),
       currentMode(0), // Basic
+      bigNumbers(false),
+      showFullResult(false),
+      rationalNumbers(false),
       showGraph(false),
       showMathPalette(true), // Default to open for visibility
       graphExpression("sin(x)"),
       graphRangeX(10.0f),
       graphRangeY(5.0f),
       graphCenterX(0.0f),
-      graphCenterY(0.0f)
+      graphCenterY(0.0f),
+      odeX0(0.0),
+      odeY0(1.0),
+      odeSolvedX0(0.0),
+      odeSolvedY0(0.0),
+      odeSolvedAngles(AngleMode::Degrees),
+      odeSolvedDefinitions(0)
 {
     currentResult = "0";
 }
@@ -29,6 +40,28 @@ void GuiRenderer::renderMenuBar() {
             if (ImGui::MenuItem("Basic", NULL, currentMode == 0)) currentMode = 0;
             if (ImGui::MenuItem("Scientific", NULL, currentMode == 1)) currentMode = 1;
             if (ImGui::MenuItem("Professional", NULL, currentMode == 2)) currentMode = 2;
+            ImGui::Separator();
+            bool degrees = mathEngine->getAngleMode() == AngleMode::Degrees;
+            if (ImGui::MenuItem("Degrees", NULL, degrees)) mathEngine->setAngleMode(AngleMode::Degrees);
+            if (ImGui::MenuItem("Radians", NULL, !degrees)) mathEngine->setAngleMode(AngleMode::Radians);
+            ImGui::Separator();
+            if (ImGui::MenuItem("Rational", NULL, rationalNumbers)) rationalNumbers = !rationalNumbers;
+            if (ImGui::MenuItem("Big Numbers", NULL, bigNumbers)) bigNumbers = !bigNumbers;
+            if (bigNumbers) {
+                int digits = (int)mathEngine->getBigPrecision();
+                if (ImGui::DragInt("Digits", &digits, 1.0f, 1, 100000)) mathEngine->setBigPrecision((size_t)std::max(digits, 1));
+            }
+            ImGui::Separator();
+            Quadrature::Tolerance tolerance = mathEngine->getIntegralTolerance();
+            bool changed = ImGui::InputDouble("Integral rel. tol.", &tolerance.relative, 0.0, 0.0, "%.0e");
+            changed |= ImGui::InputDouble("Integral abs. tol.", &tolerance.absolute, 0.0, 0.0, "%.0e");
+            if (changed) mathEngine->setIntegralTolerance(tolerance.relative, tolerance.absolute);
+            Extrapolation::Tolerance limitTolerance = mathEngine->getExtrapolationTolerance();
+            changed = ImGui::InputDouble("Limit rel. tol.", &limitTolerance.relative, 0.0, 0.0, "%.0e");
+            changed |= ImGui::InputDouble("Limit abs. tol.", &limitTolerance.absolute, 0.0, 0.0, "%.0e");
+            if (changed) mathEngine->setExtrapolationTolerance(limitTolerance.relative, limitTolerance.absolute);
+            int threads = (int)mathEngine->getThreadCount();
+            if (ImGui::DragInt("Threads", &threads, 0.1f, 1, 256)) mathEngine->setThreadCount((size_t)std::max(threads, 1));
             ImGui::EndMenu();
         }
         
@@ -36,6 +69,7 @@ void GuiRenderer::renderMenuBar() {
             if (ImGui::MenuItem("History", NULL, showHistory)) showHistory = !showHistory;
             if (ImGui::MenuItem("Graph Mode", NULL, showGraph)) showGraph = !showGraph;
             if (ImGui::MenuItem("Math Palette", NULL, showMathPalette)) showMathPalette = !showMathPalette;
+            if (ImGui::MenuItem("Full Result", NULL, showFullResult)) showFullResult = !showFullResult;
             ImGui::EndMenu();
         }
         
@@ -64,6 +98,30 @@ void GuiRenderer::renderGraph(float width, float height) {
         ImGui::DragFloat("Range X", &graphRangeX, 0.1f, 1.0f, 100.0f);
         ImGui::DragFloat("Range Y", &graphRangeY, 0.1f, 1.0f, 100.0f);
         
+        // Initial value problem, drawn over the function
+        char odeBuffer[256];
+        strncpy(odeBuffer, odeExpression.c_str(), sizeof(odeBuffer));
+        if (ImGui::InputText("ODE y'=", odeBuffer, sizeof(odeBuffer))) {
+            odeExpression = odeBuffer;
+        }
+        if (!odeExpression.empty()) {
+            ImGui::InputDouble("x0", &odeX0, 0.1, 1.0, "%.4g");
+            ImGui::InputDouble("y0", &odeY0, 0.1, 1.0, "%.4g");
+            updateOdeCurve(graphCenterX - graphRangeX, graphCenterX + graphRangeX);
+            if (!odeError.empty()) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", odeError.c_str());
+            }
+            const Ode::Statistics& backward = odeSolutions[0].statistics;
+            const Ode::Statistics& forward = odeSolutions[1].statistics;
+            ImGui::Text("%zu steps (%zu rejected), %zu evaluations of y'",
+                        backward.steps + forward.steps, backward.rejected + forward.rejected,
+                        backward.evaluations + forward.evaluations);
+            if (backward.stiffSteps + forward.stiffSteps > 0) {
+                ImGui::SameLine();
+                ImGui::Text("- stiff: %zu implicit steps", backward.stiffSteps + forward.stiffSteps);
+            }
+        }
+        
         // Drawing area
         ImVec2 canvas_p0 = ImGui::GetCursorScreenPos();      // ImDrawList API uses screen coordinates!
         ImVec2 canvas_sz = ImGui::GetContentRegionAvail();   // Resize canvas to what's available
@@ -124,39 +182,89 @@ void GuiRenderer::renderGraph(float width, float height) {
 
         // Plot Function
         if (!graphExpression.empty()) {
-            const int steps = 1000; // Higher resolution
-            ImVec2 lastPoint;
-            bool first = true;
+            // Cached between frames; sampled adaptively down to one pixel,
+            // with gaps where the function has poles, jumps or domain errors
+            const CompiledExpression& graph = mathEngine->compileCached(graphExpression);
+            graphSampler.sample(*mathEngine, graph,
+                                graphCenterX - graphRangeX, graphCenterX + graphRangeX,
+                                graphCenterY - graphRangeY, graphCenterY + graphRangeY,
+                                canvas_sz.x, canvas_sz.y);
             
-            for (int i = 0; i <= steps; i++) {
-                double t = (double)i / steps;
-                // Calculate x based on visible range and center
-                double x = (graphCenterX - graphRangeX) + t * (2 * graphRangeX);
-                
-                double y = mathEngine->evaluate(graphExpression, x);
-                
-                if (!mathEngine->hasError()) {
-                    ImVec2 point(toScreenX(x), toScreenY(y));
-                    
-                    if (!first) {
-                        // Don't draw lines that jump too far (asymptotes)
-                        if (std::abs(point.y - lastPoint.y) < canvas_sz.y) {
-                            draw_list->AddLine(lastPoint, point, IM_COL32(0, 255, 0, 255), 2.0f);
-                        }
-                    }
-                    lastPoint = point;
-                    first = false;
-                } else {
-                    first = true; // Reset on error (gap in graph)
+            ImVec2 lastPoint;
+            for (const GraphSampler::Point& sample : graphSampler.getPoints()) {
+                ImVec2 point(toScreenX(sample.x), toScreenY(sample.y));
+                if (sample.connected) {
+                    draw_list->AddLine(lastPoint, point, IM_COL32(0, 255, 0, 255), 2.0f);
                 }
+                lastPoint = point;
             }
         }
 
+        // ODE solution, one point per pixel column; NaN past where it was solved
+        if (!odeExpression.empty()) {
+            const double lower = graphCenterX - graphRangeX, span = 2.0 * graphRangeX;
+            const double far = 4.0 * graphRangeY; // blow-ups are drawn off the canvas, not to float overflow
+            const int columns = std::max(1, (int)canvas_sz.x);
+            bool connected = false;
+            ImVec2 lastPoint;
+            for (int column = 0; column <= columns; ++column) {
+                const double x = lower + span * column / columns;
+                const double y = odeSolutions[x < odeX0 ? 0 : 1].at(x);
+                if (!std::isfinite(y)) {
+                    connected = false;
+                    continue;
+                }
+                ImVec2 point(toScreenX(x), toScreenY(std::clamp(y, graphCenterY - far, graphCenterY + far)));
+                if (connected) {
+                    draw_list->AddLine(lastPoint, point, IM_COL32(255, 160, 0, 255), 2.0f);
+                }
+                lastPoint = point;
+                connected = true;
+            }
+            const ImVec2 start(toScreenX(odeX0), toScreenY(odeY0));
+            draw_list->AddCircleFilled(start, 4.0f, IM_COL32(255, 160, 0, 255));
+        }
+
         draw_list->PopClipRect();
     }
     ImGui::End();
 }
 
+void GuiRenderer::updateOdeCurve(double lower, double upper) {
+    const bool sameProblem = odeSolvedExpression == odeExpression && odeSolvedX0 == odeX0 && odeSolvedY0 == odeY0
+                          && odeSolvedAngles == mathEngine->getAngleMode()
+                          && odeSolvedDefinitions == mathEngine->getDefinitionsGeneration();
+    if (!sameProblem) {
+        odeSolvedExpression = odeExpression;
+        odeSolvedX0 = odeX0;
+        odeSolvedY0 = odeY0;
+        odeSolvedAngles = mathEngine->getAngleMode();
+        odeSolvedDefinitions = mathEngine->getDefinitionsGeneration();
+        odeError.clear();
+    }
+    
+    // A half is solved again once the view goes past its end, to a view's
+    // width beyond, so panning does not integrate every frame. Halves that
+    // failed (y blows up, f has no value) stay as far as they got.
+    const double margin = upper - lower;
+    const double ends[2] = { std::min(lower, odeX0), std::max(upper, odeX0) };
+    for (int half = 0; half < 2; ++half) {
+        Ode::Solution& solution = odeSolutions[half];
+        const double end = ends[half];
+        if (sameProblem && (!solution.converged || (half == 0 ? solution.end <= end : solution.end >= end))) continue;
+        
+        // Plots need a fraction of a pixel; a loose tolerance takes far fewer steps
+        const CompiledExpression f = mathEngine->compile(odeExpression, { "x", "y" });
+        EvalContext context;
+        solution = mathEngine->solveOde(f, odeX0, odeY0, half == 0 ? end - margin : end + margin,
+                                        Ode::Tolerance{ 1e-6, 1e-9 }, context);
+        if (context.failed() && odeError.empty()) {
+            odeError = context.getError();
+            if (!solution.segments.empty()) odeError += " at x = " + std::to_string(solution.end);
+        }
+    }
+}
+
 GuiRenderer::~GuiRenderer() {
     delete mathEngine;
     delete historyManager;
@@ -217,6 +325,10 @@ void GuiRenderer::render(int width, int height) {
     if (showMathPalette) {
         renderMathPalette((float)width, (float)height);
     }
+    
+    if (showFullResult) {
+        renderFullResult((float)width, (float)height);
+    }
 
     ImGui::End();
     ImGui::PopStyleVar(2);
@@ -229,6 +341,18 @@ void GuiRenderer::renderDisplay(float width, float height) {
     CustomWidgets::DisplayScreen(currentExpression.c_str(), currentResult.c_str(), ImVec2(width, height), borderColor);
 }
 
+void GuiRenderer::renderFullResult(float width, float height) {
+    ImGui::SetNextWindowPos(ImVec2(width * 0.1f, height * 0.3f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(width * 0.8f, height * 0.4f), ImGuiCond_FirstUseEver);
+
+    if (ImGui::Begin("Full Result", &showFullResult)) {
+        // Results of thousands of digits wrap and scroll here instead of
+        // running off the display
+        ImGui::TextWrapped("%s", fullResult.empty() ? currentResult.c_str() : fullResult.c_str());
+    }
+    ImGui::End();
+}
+
 void GuiRenderer::renderBasicKeypad(float width, float height) {
     const char* labels[] = {
         "C", "<", "%", "/",
@@ -439,12 +563,16 @@ void GuiRenderer::handleInput(const std::string& input) {
         currentExpression += "sum(";
     } else if (input == "lim") {
         currentExpression += "lim(";
-    } else if (input == "lim") {
-        currentExpression += "lim(";
+    } else if (input == "solve") {
+        currentExpression += "solve(";
+    } else if (input == "ode") {
+        currentExpression += "ode(";
+    } else if (input == "nPr" || input == "nCr") {
+        currentExpression += input + "(";
     } else if (input == "Graph") {
         showGraph = !showGraph;
     } else if (input == "ans") {
-        // Placeholder for Ans
+        currentExpression += "ans";
     } else if (input == "sin" || input == "cos" || input == "tan" || 
                input == "asin" || input == "acos" || input == "atan" || 
                input == "log" || input == "ln" || input == "exp") {
@@ -461,6 +589,17 @@ void GuiRenderer::handleInput(const std::string& input) {
 void GuiRenderer::calculateResult() {
     if (currentExpression.empty()) return;
 
+    if (bigNumbers) {
+        calculateBigResult();
+        newCalculation = true;
+        return;
+    }
+    if (rationalNumbers && calculateRationalResult()) {
+        newCalculation = true;
+        return;
+    }
+    fullResult.clear();
+
     try {
         double result = mathEngine->evaluate(currentExpression);
         
@@ -475,6 +614,7 @@ void GuiRenderer::calculateResult() {
                 snprintf(buffer, sizeof(buffer), "%.10g", result);
             }
             currentResult = buffer;
+            mathEngine->define("ans", result);
             
             historyManager->addEntry(currentExpression, currentResult);
         }
@@ -484,16 +624,71 @@ void GuiRenderer::calculateResult() {
     newCalculation = true;
 }
 
+void GuiRenderer::calculateBigResult() {
+    std::string result = mathEngine->evaluateBig(currentExpression);
+    if (mathEngine->hasError()) {
+        currentResult = "Error";
+        fullResult.clear();
+        return;
+    }
+
+    showLongResult(result);
+    // from_chars, like the lexer, reads '.' whatever the C locale says
+    double ans = 0.0;
+    if (std::from_chars(result.data(), result.data() + result.size(), ans).ec == std::errc::result_out_of_range) {
+        // from_chars leaves the value alone; saturate like strtod
+        ans = std::copysign(result.find("e-") != std::string::npos ? 0.0 : HUGE_VAL, result[0] == '-' ? -1.0 : 1.0);
+    }
+    mathEngine->define("ans", ans);
+    historyManager->addEntry(currentExpression, result);
+}
+
+bool GuiRenderer::calculateRationalResult() {
+    // Anything irrational, and every error, goes through the double path
+    Rational exact;
+    if (!mathEngine->evaluateRational(currentExpression, exact)) return false;
+
+    std::string result = exact.toString();
+    showLongResult(result);
+    mathEngine->define("ans", exact.toDouble());
+    historyManager->addEntry(currentExpression, result);
+    return true;
+}
+
+void GuiRenderer::showLongResult(const std::string& result) {
+    // The display shows the leading digits; "Full Result" has all of them
+    const size_t displayLength = 40;
+    fullResult = result;
+    if (result.size() > displayLength) {
+        currentResult = result.substr(0, displayLength - 3) + "...";
+        showFullResult = true;
+    } else {
+        currentResult = result;
+    }
+}
+
 void GuiRenderer::clear() {
     currentExpression = "";
     currentResult = "0";
+    fullResult.clear();
     newCalculation = false;
 }
 
 void GuiRenderer::backspace() {
-    if (!currentExpression.empty()) {
-        currentExpression.pop_back();
+    if (currentExpression.empty()) return;
+
+    // "sin(" and friends are entered with one button, so they go as a unit
+    ExpressionLexer::tokenize(currentExpression, expressionTokens);
+    const std::vector<Token>& tokens = expressionTokens.tokens;
+    size_t count = tokens.size() - 1; // without the End token
+    if (count >= 2 && tokens[count - 1].kind == TokenKind::OpenParen &&
+        tokens[count - 2].kind == TokenKind::Identifier &&
+        tokens[count - 1].start + 1 == currentExpression.size() &&
+        tokens[count - 2].start + tokens[count - 2].length == tokens[count - 1].start) {
+        currentExpression.erase(tokens[count - 2].start);
+        return;
     }
+    currentExpression.pop_back();
 }
 
 
@@ -550,6 +745,8 @@ void GuiRenderer::renderMathPalette(float width, float height) {
                 if (ImGui::Button("Integral (S)")) handleInput("int");
                 if (ImGui::Button("Limit (lim)")) handleInput("lim");
                 if (ImGui::Button("Sum (Sigma)")) handleInput("sum");
+                if (ImGui::Button("Solve (f=0)")) handleInput("solve");
+                if (ImGui::Button("ODE (y')")) handleInput("ode");
                 ImGui::EndTabItem();
             }
             
@@ -3,6 +3,8 @@
 #include "imgui.h"
 #include "../core/MathEngine.hpp"
 #include "../core/HistoryManager.hpp"
+#include "../core/ExpressionLexer.hpp"
+#include "../core/GraphSampler.hpp"
 #include <string>
 #include <vector>
 
@@ -23,6 +25,14 @@ private:
     bool showHistory;
     int currentMode; // 0: Basic, 1: Scientific
 
+    // Big-number mode
+    bool bigNumbers;
+    bool showFullResult;
+    std::string fullResult; // every digit; currentResult may be shortened
+
+    // Rational mode: exact fractions where possible, double otherwise
+    bool rationalNumbers;
+
     // Graphing
     bool showGraph;
     bool showMathPalette;
@@ -31,6 +41,21 @@ private:
     float graphRangeY; // Y-axis range (+/-)
     float graphCenterX; // Center X coordinate
     float graphCenterY; // Center Y coordinate
+    GraphSampler graphSampler; // points of the current frame, reused between frames
+    // Solution of y' = odeExpression through (odeX0, odeY0), drawn from the
+    // dense output of its two halves (backward and forward from odeX0);
+    // integrated again only when the problem changes or the view goes past it
+    std::string odeExpression;
+    double odeX0;
+    double odeY0;
+    Ode::Solution odeSolutions[2];
+    std::string odeSolvedExpression; // problem the solutions belong to
+    double odeSolvedX0;
+    double odeSolvedY0;
+    AngleMode odeSolvedAngles;
+    size_t odeSolvedDefinitions; // MathEngine::getDefinitionsGeneration()
+    std::string odeError;
+    TokenList expressionTokens; // reused by backspace()
 
     void renderMenuBar();
     void renderDisplay(float width, float height);
@@ -40,10 +65,15 @@ private:
     void renderMathPalette(float width, float height);
     void renderHistory(float width, float height);
     void renderGraph(float width, float height);
+    void updateOdeCurve(double lower, double upper);
+    void renderFullResult(float width, float height);
     
     void handleInput(const std::string& input);
     void handleKeyboardInput();
     void calculateResult();
+    void calculateBigResult();
+    bool calculateRationalResult();
+    void showLongResult(const std::string& result);
     void clear();
     void backspace();
 };
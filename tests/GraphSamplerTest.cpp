@@ -0,0 +1,58 @@
+#include "core/GraphSampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Interval evaluation overestimates expressions that use x more than once:
+// (x+1)*(x+1)-x*x-2*x encloses [-120, 141] over [-10, 10] although it is 1.
+// Such enclosures must not turn into vertical bars where the curve is flat,
+// while a spike narrower than a pixel must still be drawn.
+
+namespace {
+
+constexpr double XMin = -10.0, XMax = 10.0, YMin = -5.0, YMax = 5.0;
+constexpr double Columns = 800.0, Rows = 600.0;
+
+// Fails when a point of the sampled curve is more than a pixel row away from
+// 'expected'
+int checkFlat(MathEngine& engine, const char* expression, double expected) {
+    const CompiledExpression compiled = engine.compile(expression);
+    GraphSampler sampler;
+    sampler.sample(engine, compiled, XMin, XMax, YMin, YMax, Columns, Rows);
+    const double pixelHeight = (YMax - YMin) / Rows;
+    double worst = 0.0;
+    for (const GraphSampler::Point& point : sampler.getPoints()) worst = std::max(worst, std::fabs(point.y - expected));
+    const bool ok = !sampler.getPoints().empty() && worst <= pixelHeight;
+    std::printf("%-24s %5zu points, %6.1f px off%s\n", expression, sampler.getPoints().size(), worst / pixelHeight,
+                ok ? "" : "  FAILED");
+    return ok ? 0 : 1;
+}
+
+// Fails when the highest point drawn is not within a pixel row of 'peak'
+int checkPeak(MathEngine& engine, const char* expression, double peak) {
+    const CompiledExpression compiled = engine.compile(expression);
+    GraphSampler sampler;
+    sampler.sample(engine, compiled, XMin, XMax, YMin, YMax, Columns, Rows);
+    const double pixelHeight = (YMax - YMin) / Rows;
+    double highest = -HUGE_VAL;
+    for (const GraphSampler::Point& point : sampler.getPoints()) highest = std::max(highest, point.y);
+    const bool ok = std::fabs(highest - peak) <= pixelHeight;
+    std::printf("%-24s peak %.3f (expected %.3f)%s\n", expression, highest, peak, ok ? "" : "  FAILED");
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main() {
+    MathEngine engine;
+    engine.setAngleMode(AngleMode::Radians);
+    int failures = 0;
+    failures += checkFlat(engine, "x^2-x^2+0.5", 0.5);
+    failures += checkFlat(engine, "(x+1)*(x+1)-x*x-2*x", 1.0);
+    failures += checkFlat(engine, "x*sin(x)-x*sin(x)", 0.0);
+    failures += checkFlat(engine, "x/x", 1.0);
+    // 0.001 wide, a twentieth of a pixel column
+    failures += checkPeak(engine, "1/(1+1000000*(x-0.123)^2)", 1.0);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
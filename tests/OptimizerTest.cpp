@@ -0,0 +1,45 @@
+#include "core/MathEngine.hpp"
+#include <cmath>
+#include <cstdio>
+
+// The optimizer rewrites programs into cheaper ones, but must not hide an
+// error the written expression reports: x^0 is 1 only where x cannot fail.
+
+namespace {
+
+const char* describe(MathError error) { return error == MathError::None ? "no error" : errorMessage(error); }
+
+// Fails unless 'expression' reports 'expected' at x = 2
+int checkError(MathEngine& engine, const char* expression, MathError expected) {
+    engine.evaluate(expression, 2.0);
+    const MathError error = engine.getLastErrorCode();
+    const bool ok = error == expected;
+    std::printf("%-16s %s%s\n", expression, describe(error), ok ? "" : "  FAILED");
+    return ok ? 0 : 1;
+}
+
+// Fails unless 'expression' gives 'expected' at x = 2, without an error
+int checkValue(MathEngine& engine, const char* expression, double expected) {
+    const double value = engine.evaluate(expression, 2.0);
+    const MathError error = engine.getLastErrorCode();
+    const bool ok = error == MathError::None && value == expected;
+    std::printf("%-16s %.17g %s%s\n", expression, value, describe(error), ok ? "" : "  FAILED");
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+int main() {
+    MathEngine engine;
+    engine.setAngleMode(AngleMode::Radians);
+    int failures = 0;
+    failures += checkError(engine, "sqrt(-1)^0", MathError::SqrtDomain);
+    failures += checkError(engine, "ln(-x)^0", MathError::LnDomain);
+    failures += checkError(engine, "(1/(x-2))^0", MathError::DivisionByZero);
+    failures += checkValue(engine, "x^0", 1.0);
+    failures += checkValue(engine, "(x*x-3)^0", 1.0);
+    failures += checkValue(engine, "(x*3)/4", 1.5);
+    failures += checkValue(engine, "x/0.5", 4.0);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+#include "core/SimdKernels.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Accuracy of the vector kernels of both instruction sets against a long
+// double reference, over the ranges the error table in SimdMath.hpp was
+// measured on. Fails when a kernel is worse than the table says, or when a
+// non-finite, zero or overflowing argument does not give what libm gives.
+// The AVX2 table is skipped on CPUs without AVX2 and FMA.
+
+namespace {
+
+constexpr size_t Samples = 200000;
+constexpr int Skipped = 77; // SKIP_RETURN_CODE in tests/CMakeLists.txt
+
+using Reference = long double (*)(long double);
+
+struct Range {
+    FunctionId function;
+    const char* name;
+    Reference reference;
+    double (*libm)(double);
+    double lo, hi;
+    bool logarithmic;   // uniform in log(x) instead of x
+    double maxUlps;     // from SimdMath.hpp
+};
+
+long double log10Reference(long double x) { return log10l(x); }
+
+// Error of 'value' in units in the last place of the rounded reference
+double ulps(double value, long double reference) {
+    const double rounded = static_cast<double>(reference);
+    if (std::isnan(rounded) || std::isnan(value)) return std::isnan(rounded) && std::isnan(value) ? 0.0 : HUGE_VAL;
+    if (std::isinf(rounded) || std::isinf(value)) return value == rounded ? 0.0 : HUGE_VAL;
+    double ulp = std::nextafter(std::fabs(rounded), HUGE_VAL) - std::fabs(rounded);
+    if (rounded == 0.0) ulp = std::numeric_limits<double>::denorm_min();
+    return static_cast<double>(std::fabs(static_cast<long double>(value) - reference) / ulp);
+}
+
+const Range ranges[] = {
+    { FunctionId::Sin,   "sin",   sinl,   std::sin,   -10.0,   10.0,   false, 0.78 },
+    { FunctionId::Sin,   "sin",   sinl,   std::sin,   -1e6,    1e6,    false, 0.78 },
+    { FunctionId::Sin,   "sin",   sinl,   std::sin,   1e-10,   1.0,    true,  0.78 },
+    { FunctionId::Cos,   "cos",   cosl,   std::cos,   -10.0,   10.0,   false, 0.78 },
+    { FunctionId::Cos,   "cos",   cosl,   std::cos,   -1e6,    1e6,    false, 0.78 },
+    { FunctionId::Tan,   "tan",   tanl,   std::tan,   -10.0,   10.0,   false, 2.21 },
+    { FunctionId::Tan,   "tan",   tanl,   std::tan,   -1e6,    1e6,    false, 2.21 },
+    { FunctionId::Asin,  "asin",  asinl,  std::asin,  -1.0,    1.0,    false, 3.08 },
+    { FunctionId::Acos,  "acos",  acosl,  std::acos,  -1.0,    1.0,    false, 2.76 },
+    { FunctionId::Atan,  "atan",  atanl,  std::atan,  -10.0,   10.0,   false, 1.90 },
+    { FunctionId::Atan,  "atan",  atanl,  std::atan,  1e-300,  1e300,  true,  1.90 },
+    { FunctionId::Exp,   "exp",   expl,   std::exp,   -708.0,  708.0,  false, 1.10 },
+    { FunctionId::Exp,   "exp",   expl,   std::exp,   -1.0,    1.0,    false, 1.10 },
+    { FunctionId::Ln,    "ln",    logl,   std::log,   1e-300,  1e300,  true,  1.21 },
+    { FunctionId::Ln,    "ln",    logl,   std::log,   0.5,     2.0,    false, 1.21 },
+    { FunctionId::Log,   "log",   log10Reference, std::log10, 1e-300, 1e300, true, 1.78 },
+    { FunctionId::Log,   "log",   log10Reference, std::log10, 0.5, 2.0, false, 1.78 },
+    { FunctionId::Sqrt,  "sqrt",  sqrtl,  std::sqrt,  0.0,     1e6,    false, 0.50 },
+    { FunctionId::Cbrt,  "cbrt",  cbrtl,  std::cbrt,  -1e6,    1e6,    false, 0.96 },
+    { FunctionId::Cbrt,  "cbrt",  cbrtl,  std::cbrt,  1e-300,  1e300,  true,  0.96 },
+    { FunctionId::Abs,   "abs",   fabsl,  std::fabs,  -10.0,   10.0,   false, 0.0 },
+    { FunctionId::Sinh,  "sinh",  sinhl,  std::sinh,  -1.0,    1.0,    false, 3.85 },
+    { FunctionId::Sinh,  "sinh",  sinhl,  std::sinh,  -710.0,  710.0,  false, 3.85 },
+    { FunctionId::Cosh,  "cosh",  coshl,  std::cosh,  -10.0,   10.0,   false, 1.56 },
+    { FunctionId::Cosh,  "cosh",  coshl,  std::cosh,  -710.0,  710.0,  false, 1.56 },
+    { FunctionId::Tanh,  "tanh",  tanhl,  std::tanh,  -1.0,    1.0,    false, 3.38 },
+    { FunctionId::Tanh,  "tanh",  tanhl,  std::tanh,  -25.0,   25.0,   false, 3.38 },
+    { FunctionId::Asinh, "asinh", asinhl, std::asinh, -10.0,   10.0,   false, 2.42 },
+    { FunctionId::Asinh, "asinh", asinhl, std::asinh, 1e-300,  1e300,  true,  2.42 },
+    { FunctionId::Acosh, "acosh", acoshl, std::acosh, 1.0,     10.0,   false, 2.74 },
+    { FunctionId::Acosh, "acosh", acoshl, std::acosh, 1.0,     1e300,  true,  2.74 },
+    { FunctionId::Atanh, "atanh", atanhl, std::atanh, -1.0,    1.0,    false, 2.68 },
+    { FunctionId::Atanh, "atanh", atanhl, std::atanh, 1e-10,   0.01,   true,  2.68 },
+};
+
+struct PowRange {
+    double baseLo, baseHi, exponentLo, exponentHi; // bases log-uniform, exponents uniform
+};
+
+constexpr double PowMaxUlps = 1.93;
+
+const PowRange powRanges[] = {
+    { 0.01,   100.0, -10.0,  10.0 },
+    { 1e-300, 1e300, -1.0,   1.0 },
+    { 0.5,    2.0,   -600.0, 600.0 },
+    { 1e-5,   1e5,   -60.0,  60.0 },
+};
+
+double sample(std::mt19937_64& random, double lo, double hi, bool logarithmic) {
+    const double t = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    if (logarithmic) return std::exp(std::log(lo) + t * (std::log(hi) - std::log(lo)));
+    return lo + t * (hi - lo);
+}
+
+// Non-finite, zero, subnormal and overflowing results must match libm bit for
+// bit (NaN only as NaN), finite ones within a few ulps
+bool matchesLibm(double value, double expected) {
+    if (std::isnan(expected)) return std::isnan(value);
+    if (!std::isfinite(expected) || std::fabs(expected) < DBL_MIN) return std::memcmp(&value, &expected, sizeof value) == 0;
+    return std::signbit(value) == std::signbit(expected) && ulps(value, expected) <= 4.0;
+}
+
+int checkTable(const char* isa, const SimdMath::KernelTable& table) {
+    int failures = 0;
+    std::vector<double> x(Samples), y(Samples);
+    for (const Range& range : ranges) {
+        std::mt19937_64 random(42);
+        for (double& value : x) value = sample(random, range.lo, range.hi, range.logarithmic);
+        table.functions[static_cast<size_t>(range.function)](x.data(), y.data(), Samples);
+        double worst = 0.0, worstAt = 0.0;
+        for (size_t i = 0; i < Samples; ++i) {
+            const double error = ulps(y[i], range.reference(x[i]));
+            if (error > worst) worst = error, worstAt = x[i];
+        }
+        const bool ok = worst <= range.maxUlps;
+        failures += !ok;
+        std::printf("%s %-5s [%g, %g]  %.3f ulp (limit %.2f)%s\n", isa, range.name, range.lo, range.hi, worst,
+                    range.maxUlps, ok ? "" : "  FAILED");
+        if (!ok) std::printf("    worst at x = %.17g\n", worstAt);
+    }
+
+    std::vector<double> exponent(Samples);
+    for (const PowRange& range : powRanges) {
+        std::mt19937_64 random(7);
+        for (size_t i = 0; i < Samples; ++i) {
+            x[i] = sample(random, range.baseLo, range.baseHi, true);
+            exponent[i] = sample(random, range.exponentLo, range.exponentHi, false);
+        }
+        table.pow(x.data(), exponent.data(), y.data(), Samples);
+        double worst = 0.0;
+        for (size_t i = 0; i < Samples; ++i) {
+            const long double reference = powl(x[i], exponent[i]);
+            if (std::fabs(static_cast<double>(reference)) < DBL_MIN) continue; // subnormal results come from libm
+            worst = std::max(worst, ulps(y[i], reference));
+        }
+        const bool ok = worst <= PowMaxUlps;
+        failures += !ok;
+        std::printf("%s pow   [%g, %g]^[%g, %g]  %.3f ulp (limit %.2f)%s\n", isa, range.baseLo, range.baseHi,
+                    range.exponentLo, range.exponentHi, worst, PowMaxUlps, ok ? "" : "  FAILED");
+    }
+
+    const double inf = HUGE_VAL, nan = std::numeric_limits<double>::quiet_NaN();
+    const double edges[] = { 0.0, -0.0, inf, -inf, nan, std::numeric_limits<double>::denorm_min(), DBL_MIN, -DBL_MIN,
+                             1e-310, 1.0, -1.0, 1e6, 1e6 + 1.0, 1e22, DBL_MAX, -DBL_MAX, 708.0, 709.79, 710.0, -745.0,
+                             -746.0, 22.0, 25.0, 67108864.0 };
+    constexpr size_t EdgeCount = sizeof edges / sizeof edges[0];
+    for (const Range& range : ranges) {
+        if (&range != ranges && range.function == (&range - 1)->function) continue;
+        double out[EdgeCount];
+        table.functions[static_cast<size_t>(range.function)](edges, out, EdgeCount);
+        for (size_t i = 0; i < EdgeCount; ++i) {
+            const double expected = range.libm(edges[i]);
+            if (matchesLibm(out[i], expected)) continue;
+            ++failures;
+            std::printf("%s %s(%.17g) = %.17g, libm %.17g  FAILED\n", isa, range.name, edges[i], out[i], expected);
+        }
+    }
+    const double bases[] = { 0.0, -0.0, 1.0, -1.0, 2.0, -2.0, 0.5, 1e-300, 1e300, inf, -inf, nan, 2.5 };
+    const double exponents[] = { 0.0, -0.0, 1.0, -1.0, 2.0, 3.0, 0.5, -0.5, 2.7, 700.5, -700.5, 1e10, inf, -inf, nan };
+    for (double base : bases) {
+        for (double e : exponents) {
+            double result;
+            table.pow(&base, &e, &result, 1);
+            const double expected = std::pow(base, e);
+            if (matchesLibm(result, expected)) continue;
+            ++failures;
+            std::printf("%s pow(%.17g, %.17g) = %.17g, libm %.17g  FAILED\n", isa, base, e, result, expected);
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main() {
+    if (std::numeric_limits<long double>::digits <= std::numeric_limits<double>::digits) {
+        std::printf("long double is no wider than double; no reference to measure against\n");
+        return Skipped;
+    }
+    const SimdMath::KernelTable* sse2 = SimdMath::sse2Kernels();
+    const SimdMath::KernelTable* avx2 = SimdMath::avx2Kernels();
+    if (!sse2 && !avx2) {
+        std::printf("no vector kernels on this target\n");
+        return Skipped;
+    }
+    int failures = 0;
+    if (sse2) failures += checkTable("SSE2", *sse2);
+    if (avx2 && std::strcmp(SimdMath::instructionSet(), "AVX2") == 0) {
+        failures += checkTable("AVX2", *avx2);
+    } else {
+        std::printf("AVX2 skipped: %s\n", avx2 ? "not supported by this CPU" : "not built");
+    }
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}